@@ -0,0 +1,20 @@
+#ifndef INC_AL_APP_H_
+#define INC_AL_APP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "al_tuning.h"
+
+typedef struct
+{
+    uint32_t cycle;
+    OPTIM2D_result result;
+    TUNING_telemetry telemetry;
+    bool is_tracked; // APP_TRACKING: the notch was followed, no search
+} APP_report;
+
+void APP_init();
+void APP_cycle(APP_report *report);
+void APP_idle(uint32_t duration_ms);
+
+#endif /* INC_AL_APP_H_ */
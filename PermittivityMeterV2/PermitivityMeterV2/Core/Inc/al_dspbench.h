@@ -0,0 +1,24 @@
+#ifndef INC_AL_DSPBENCH_H_
+#define INC_AL_DSPBENCH_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    // CPU cycles per ACQ_BLOCK_SIZE block, fastest of DSPBENCH_RUNS runs
+    uint32_t goertzel;          // DSP_goertzel_process()
+    uint32_t lockin;            // DSP_lockin_process()
+    uint32_t q15_tone;          // DSP_q15_tone(), rectangular
+    uint32_t q15_tone_hann;     // DSP_q15_tone(), Hann
+    uint32_t f32_spectrum;      // DSP_fft_spectrum(): float conversion, rfft_f32, magnitudes
+    uint32_t q15_spectrum;      // DSP_q15_spectrum(): offset, window, rfft_q15, magnitudes
+    // the same block through the single bin detectors [LSB]
+    float goertzel_amplitude;
+    float q15_amplitude;
+    uint32_t runs;              // 0: not run yet
+} DSPBENCH_result;
+
+void DSPBENCH_run(const uint16_t *samples);
+void DSPBENCH_get_result(DSPBENCH_result *result);
+
+#endif /* INC_AL_DSPBENCH_H_ */
@@ -0,0 +1,25 @@
+#ifndef INC_AL_MINIMIZER_H_
+#define INC_AL_MINIMIZER_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+    MINIMIZER_GOLDEN_SECTION, //
+    MINIMIZER_BRENT
+} MINIMIZER_method;
+
+// measures the notch amplitude with the DAC set to code, context is passed through
+typedef float (*MINIMIZER_measure_callback)(uint16_t code, void *context);
+
+typedef struct
+{
+    uint16_t code;          // DAC code with the smallest measured amplitude
+    float amplitude;        // amplitude measured at code
+    uint16_t evaluations;   // number of calls of the measure callback
+} MINIMIZER_result;
+
+void MINIMIZER_search(MINIMIZER_method method, uint16_t lower, uint16_t upper, uint16_t tolerance_lsb,
+                      MINIMIZER_measure_callback measure, void *context, MINIMIZER_result *result);
+
+#endif /* INC_AL_MINIMIZER_H_ */
@@ -0,0 +1,52 @@
+#ifndef INC_AL_OPTIM2D_H_
+#define INC_AL_OPTIM2D_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+    OPTIM2D_SEQUENTIAL,         // D1 to convergence, then D2 (reference procedure of the flowchart)
+    OPTIM2D_COORDINATE_DESCENT, // alternating line searches in a shrinking window
+    OPTIM2D_NELDER_MEAD
+} OPTIM2D_method;
+
+// measures the notch amplitude with both DACs set, context is passed through
+typedef float (*OPTIM2D_measure_callback)(uint16_t code_d1, uint16_t code_d2, void *context);
+
+typedef struct
+{
+    uint16_t code_d1;
+    uint16_t code_d2;
+    float amplitude;
+} OPTIM2D_evaluation;
+
+typedef struct
+{
+    OPTIM2D_evaluation *entries; // storage provided by the caller, may be NULL
+    uint16_t capacity;
+    uint16_t length;             // evaluations stored (stops growing at capacity)
+} OPTIM2D_trace;
+
+typedef struct
+{
+    uint16_t lower_d1;
+    uint16_t upper_d1;
+    uint16_t lower_d2;
+    uint16_t upper_d2;
+    uint16_t start_d1;
+    uint16_t start_d2;
+    uint16_t tolerance_lsb;
+} OPTIM2D_params;
+
+typedef struct
+{
+    uint16_t code_d1;
+    uint16_t code_d2;
+    float amplitude;
+    uint16_t evaluations;
+} OPTIM2D_result;
+
+void OPTIM2D_search(OPTIM2D_method method, const OPTIM2D_params *params, OPTIM2D_measure_callback measure,
+                    void *context, OPTIM2D_trace *trace, OPTIM2D_result *result);
+
+#endif /* INC_AL_OPTIM2D_H_ */
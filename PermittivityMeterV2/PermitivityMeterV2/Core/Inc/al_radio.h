@@ -0,0 +1,60 @@
+#ifndef INC_AL_RADIO_H_
+#define INC_AL_RADIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    RADIO_STATE_OFF,          // module in reset and low-power mode, results go to the outbox
+    RADIO_STATE_BOOTING,      // power on -> RF_is_booted()
+    RADIO_STATE_CONNECTING,   // connectable, waiting for a peer
+    RADIO_STATE_TRANSMITTING, // draining the outbox
+    RADIO_STATE_LINGERING     // outbox empty, the module gets its buffer out
+} RADIO_state;
+
+typedef enum
+{
+    RADIO_WAKE_BY_RECORDS, // RADIO_WAKE_RECORDS results pending
+    RADIO_WAKE_BY_AGE,     // oldest pending result waits RADIO_WAKE_AGE_S
+    RADIO_WAKE_BY_BUTTON   // B1
+} RADIO_wake_reason;
+
+typedef enum
+{
+    RADIO_END_DONE,       // outbox empty
+    RADIO_END_NO_PEER,    // nobody connected within RADIO_CONNECT_TIMEOUT_S
+    RADIO_END_PEER_LOST,  // peer gone before the outbox was empty
+    RADIO_END_BOOT_FAILED // no +STARTUP after RF_MAX_REBOOTS resets
+} RADIO_end_reason;
+
+typedef struct
+{
+    RADIO_wake_reason wake_reason;
+    RADIO_end_reason end_reason;
+    uint32_t boot_ms;     // power on -> booted (+STARTUP and baud rate upgrade)
+    uint32_t connect_ms;  // booted -> peer connected, 0 without a peer
+    uint32_t transmit_ms; // peer connected -> outbox empty
+    uint32_t on_ms;       // power on -> power off
+    uint32_t records;     // sent from the outbox
+    float energy_mj;      // estimate from RADIO_CURRENT_ON_MA / RADIO_CURRENT_TX_MA
+} RADIO_session;
+
+typedef struct
+{
+    uint32_t sessions;
+    uint32_t failed_sessions; // booted, ended without a peer
+    uint32_t boot_failures;   // ended before the module booted
+    uint32_t on_ms;
+    uint32_t boot_ms;    // sum over the sessions that booted
+    uint32_t connect_ms; // sum over the sessions with a peer
+    float energy_mj;
+    RADIO_session last;
+} RADIO_statistics;
+
+void RADIO_init();
+void RADIO_cyclic();
+RADIO_state RADIO_get_state();
+void RADIO_get_statistics(RADIO_statistics *statistics);
+
+#endif /* INC_AL_RADIO_H_ */
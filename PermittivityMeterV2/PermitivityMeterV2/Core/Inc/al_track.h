@@ -0,0 +1,21 @@
+#ifndef INC_AL_TRACK_H_
+#define INC_AL_TRACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "al_optim2d.h"
+
+typedef struct
+{
+    uint32_t updates;         // controller steps since the last TRACK_start()
+    uint16_t identifications; // slope probes, one per TRACK_start()
+    uint16_t losses;          // lock lost
+    float slope_determinant;  // of the last probe [LSB^2 per code^2]
+} TRACK_statistics;
+
+bool TRACK_start(const OPTIM2D_result *start);
+bool TRACK_update(OPTIM2D_result *result);
+bool TRACK_is_locked();
+void TRACK_get_statistics(TRACK_statistics *statistics);
+
+#endif /* INC_AL_TRACK_H_ */
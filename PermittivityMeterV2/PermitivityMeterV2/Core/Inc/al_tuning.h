@@ -0,0 +1,53 @@
+#ifndef INC_AL_TUNING_H_
+#define INC_AL_TUNING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "al_minimizer.h"
+#include "al_optim2d.h"
+#include "dsp_tone.h"
+#include "meas_config.h"
+
+typedef enum
+{
+    TUNING_VARACTOR_D1, // FRQ_TN (PA4, DAC1 channel 1), real part
+    TUNING_VARACTOR_D2  // Q_FACT_TN (PA5, DAC1 channel 2), imaginary part
+} TUNING_varactor;
+
+typedef struct
+{
+    bool warm_start;      // search started from the stored codes
+    uint8_t widenings;    // how often the warm search box had to be enlarged
+    uint16_t evaluations; // DAC settle + acquisition cycles used
+    uint16_t overwritten; // evaluations measured on an overwritten block
+    uint32_t duration_ms; // wall time of the whole search
+} TUNING_telemetry;
+
+// coarse amplitude over DAC code curve of one varactor (hardware sweep)
+typedef struct
+{
+    uint16_t code_start;
+    uint16_t code_step;
+    uint8_t length;
+    uint8_t min_index;
+    float amplitudes[TUNING_SWEEP_POINTS]; // amplitude at code_start + i * code_step
+} TUNING_curve;
+
+void TUNING_init();
+void TUNING_set_dac(TUNING_varactor varactor, uint16_t code);
+uint16_t TUNING_get_dac(TUNING_varactor varactor);
+float TUNING_measure_amplitude(uint16_t code, void *context);
+float TUNING_measure_amplitude_2d(uint16_t code_d1, uint16_t code_d2, void *context);
+bool TUNING_measure_tone_2d(uint16_t code_d1, uint16_t code_d2, DSP_tone *tone);
+uint16_t TUNING_get_overwritten_count();
+void TUNING_reset_overwritten_count();
+
+void TUNING_search(TUNING_varactor varactor, MINIMIZER_method method, uint16_t lower, uint16_t upper,
+                   MINIMIZER_result *result);
+void TUNING_search_phase(TUNING_varactor varactor, uint16_t lower, uint16_t upper, MINIMIZER_result *result);
+void TUNING_search_2d(OPTIM2D_method method, OPTIM2D_trace *trace, OPTIM2D_result *result);
+bool TUNING_sweep(TUNING_varactor varactor, uint16_t lower, uint16_t upper, TUNING_curve *curve);
+void TUNING_curve_bracket(const TUNING_curve *curve, uint16_t *lower, uint16_t *upper);
+void TUNING_search_auto(uint32_t timestamp_s, OPTIM2D_result *result, TUNING_telemetry *telemetry);
+
+#endif /* INC_AL_TUNING_H_ */
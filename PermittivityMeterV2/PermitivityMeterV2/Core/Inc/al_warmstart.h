@@ -0,0 +1,20 @@
+#ifndef INC_AL_WARMSTART_H_
+#define INC_AL_WARMSTART_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint16_t code_d1;
+    uint16_t code_d2;
+    uint8_t gain;          // GAIN_setting
+    float amplitude;       // notch amplitude at convergence in LSB
+    uint32_t timestamp_s;  // time of the measurement [s since power on], ages the point
+} WARMSTART_point;
+
+void WARMSTART_save(const WARMSTART_point *point);
+bool WARMSTART_load(WARMSTART_point *point, uint32_t now_s);
+void WARMSTART_invalidate();
+
+#endif /* INC_AL_WARMSTART_H_ */
@@ -0,0 +1,13 @@
+#ifndef INC_DSP_FFT_H_
+#define INC_DSP_FFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dsp_tone.h"
+#include "dsp_peak.h"
+
+bool DSP_fft_spectrum(const uint16_t *samples, uint16_t length, float magnitudes[]);
+bool DSP_fft_tone(const uint16_t *samples, uint16_t length, uint16_t bin, DSP_tone *result);
+bool DSP_fft_peak(const uint16_t *samples, uint16_t length, DSP_peak_method method, DSP_peak *peak);
+
+#endif /* INC_DSP_FFT_H_ */
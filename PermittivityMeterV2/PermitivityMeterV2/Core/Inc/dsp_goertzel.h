@@ -0,0 +1,20 @@
+#ifndef INC_DSP_GOERTZEL_H_
+#define INC_DSP_GOERTZEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dsp_tone.h"
+
+typedef struct
+{
+    uint16_t length;
+    uint16_t bin;
+    int32_t coeff_q30; // 2 * cos(w) in Q30
+    float cos_w;
+    float sin_w;
+} DSP_goertzel;
+
+bool DSP_goertzel_init(DSP_goertzel *goertzel, uint16_t bin, uint16_t length);
+void DSP_goertzel_process(const DSP_goertzel *goertzel, const uint16_t *samples, DSP_tone *result);
+
+#endif /* INC_DSP_GOERTZEL_H_ */
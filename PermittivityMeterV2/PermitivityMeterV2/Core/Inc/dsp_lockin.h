@@ -0,0 +1,34 @@
+#ifndef INC_DSP_LOCKIN_H_
+#define INC_DSP_LOCKIN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "meas_config.h"
+#include "dsp_tone.h"
+
+typedef struct
+{
+    uint16_t period;                    // samples per period of the reference
+    int16_t cos_q15[LOCKIN_MAX_PERIOD];
+    int16_t sin_q15[LOCKIN_MAX_PERIOD];
+    uint8_t smoothing_shift;            // averaging over 2^shift blocks, 0 = off
+    float phase_reference;              // phase at the notch centre, see DSP_lockin_set_reference()
+    int64_t i_filtered;
+    int64_t q_filtered;
+    bool has_filtered_value;
+} DSP_lockin;
+
+typedef struct
+{
+    float magnitude;    // peak amplitude in ADC LSB
+    float phase;        // raw phase in rad
+    float signed_phase; // phase relative to phase_reference, -pi..pi
+} DSP_lockin_result;
+
+bool DSP_lockin_init(DSP_lockin *lockin, uint16_t cycles_per_block, uint16_t length, uint8_t smoothing_shift);
+void DSP_lockin_reset(DSP_lockin *lockin);
+void DSP_lockin_set_reference(DSP_lockin *lockin, float phase_at_notch);
+void DSP_lockin_process(DSP_lockin *lockin, const uint16_t *samples, uint16_t length, DSP_lockin_result *result);
+int8_t DSP_lockin_notch_side(const DSP_lockin_result *result);
+
+#endif /* INC_DSP_LOCKIN_H_ */
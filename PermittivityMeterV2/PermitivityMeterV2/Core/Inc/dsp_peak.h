@@ -0,0 +1,25 @@
+#ifndef INC_DSP_PEAK_H_
+#define INC_DSP_PEAK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    DSP_PEAK_BIN,           // highest bin, no interpolation (reference)
+    DSP_PEAK_QUADRATIC,     // parabola through the three magnitudes, Hann window
+    DSP_PEAK_JACOBSEN,      // ratio of the three complex bins, no window
+    DSP_PEAK_JACOBSEN_HANN  // ratio of the three complex bins, Hann window
+} DSP_peak_method;
+
+typedef struct
+{
+    float bin;       // frequency in bins (cycles per block), between two bins if interpolated
+    float amplitude; // peak amplitude of the tone, corrected for the offset from the bin
+    float error;     // estimated standard deviation of bin from the noise floor of the spectrum
+} DSP_peak;
+
+bool DSP_peak_is_windowed(DSP_peak_method method);
+bool DSP_peak_estimate(DSP_peak_method method, const float *spectrum, uint16_t length, DSP_peak *peak);
+
+#endif /* INC_DSP_PEAK_H_ */
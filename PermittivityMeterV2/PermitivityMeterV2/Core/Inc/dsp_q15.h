@@ -0,0 +1,31 @@
+#ifndef INC_DSP_Q15_H_
+#define INC_DSP_Q15_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "meas_config.h"
+#include "dsp_rfft.h"
+#include "dsp_tone.h"
+
+typedef struct
+{
+    uint16_t length;
+    uint16_t bin;
+    float window_sum;                   // sum of the window in q15, scales the amplitudes
+    int16_t window_q15[ACQ_BLOCK_SIZE]; // Hann, or 32767 (rectangular)
+    int16_t cos_q15[ACQ_BLOCK_SIZE];    // window * cos(w n), single bin reference
+    int16_t sin_q15[ACQ_BLOCK_SIZE];    // window * -sin(w n)
+    int32_t cos_sum;                    // sums of the references, for the offset
+    int32_t sin_sum;
+    DSP_rfft rfft;
+    bool has_spectrum;                  // the real FFT supports the length (DSP_rfft_init())
+} DSP_q15;
+
+void DSP_q15_init(DSP_q15 *q15, uint16_t bin, uint16_t length, bool is_windowed);
+uint16_t DSP_q15_get_offset(const DSP_q15 *q15, const uint16_t *samples);
+void DSP_q15_load(const DSP_q15 *q15, const uint16_t *samples, int16_t *out);
+void DSP_q15_tone(const DSP_q15 *q15, const uint16_t *samples, DSP_tone *result);
+bool DSP_q15_spectrum(DSP_q15 *q15, const uint16_t *samples, int16_t magnitudes[]);
+float DSP_q15_get_lsb_per_magnitude(const DSP_q15 *q15);
+
+#endif /* INC_DSP_Q15_H_ */
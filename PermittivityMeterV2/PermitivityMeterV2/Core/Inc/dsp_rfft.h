@@ -0,0 +1,42 @@
+#ifndef INC_DSP_RFFT_H_
+#define INC_DSP_RFFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "meas_config.h"
+
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+#include "arm_math.h"
+#endif
+
+/*
+ * Real FFT and complex magnitude, the interface of the CMSIS-DSP functions
+ * arm_rfft_fast_f32, arm_rfft_q15 and arm_cmplx_mag_f32/q15 (DSP_BACKEND).
+ *
+ * f32 spectrum, length values (packed like arm_rfft_fast_f32):
+ *   [0] X(0), [1] X(length/2) (both real), [2k] [2k+1] re, im of X(k), k = 1..length/2-1
+ *   unscaled, X(k) = sum x(n) e^(-j 2pi k n / length)
+ *
+ * q15 spectrum, length + 2 values: re, im of X(k) / length, k = 0..length/2
+ */
+
+// ###### typedefs
+
+typedef struct
+{
+    uint16_t length;
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    arm_rfft_fast_instance_f32 fast;
+    arm_rfft_instance_q15 q15;
+#endif
+} DSP_rfft;
+
+// ###### functions
+
+bool DSP_rfft_init(DSP_rfft *rfft, uint16_t length);
+void DSP_rfft_f32(DSP_rfft *rfft, float *samples, float *spectrum);
+void DSP_rfft_q15(DSP_rfft *rfft, int16_t *samples, int16_t *spectrum);
+void DSP_cmplx_mag_f32(const float *spectrum, float *magnitudes, uint16_t count);
+void DSP_cmplx_mag_q15(const int16_t *spectrum, int16_t *magnitudes, uint16_t count);
+
+#endif /* INC_DSP_RFFT_H_ */
@@ -0,0 +1,30 @@
+#ifndef INC_DSP_SDFT_H_
+#define INC_DSP_SDFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "meas_config.h"
+#include "dsp_tone.h"
+
+typedef struct
+{
+    uint16_t window;                         // samples the bin is summed over
+    uint16_t period;                         // samples per period of the reference
+    uint16_t phase;                          // reference index of the next sample
+    uint16_t position;                       // next slot of history[]
+    uint16_t filled;                         // samples in the window, valid once == window
+    int64_t re;                              // sum x(m) cos(w m), m in the window
+    int64_t im;                              // sum x(m) -sin(w m)
+    uint32_t samples;                        // pushed since the last reset
+    uint16_t history[SDFT_WINDOW_LENGTH];    // the window, x(n - window) is the oldest
+    int16_t cos_q15[SDFT_WINDOW_LENGTH];     // one period of the reference
+    int16_t sin_q15[SDFT_WINDOW_LENGTH];
+} DSP_sdft;
+
+bool DSP_sdft_init(DSP_sdft *sdft, uint16_t cycles_per_block, uint16_t block_length, uint16_t window);
+void DSP_sdft_reset(DSP_sdft *sdft);
+void DSP_sdft_push(DSP_sdft *sdft, const uint16_t *samples, uint16_t count);
+bool DSP_sdft_is_valid(const DSP_sdft *sdft);
+void DSP_sdft_get_tone(const DSP_sdft *sdft, DSP_tone *result);
+
+#endif /* INC_DSP_SDFT_H_ */
@@ -0,0 +1,16 @@
+#ifndef INC_DSP_TONE_H_
+#define INC_DSP_TONE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    float amplitude; // peak amplitude of the tone in ADC LSB
+    float phase;     // phase of the tone relative to the first sample in rad (-pi..pi)
+} DSP_tone;
+
+bool DSP_tone_init();
+void DSP_tone_measure(const uint16_t *samples, uint16_t length, DSP_tone *result);
+
+#endif /* INC_DSP_TONE_H_ */
@@ -0,0 +1,33 @@
+#ifndef INC_HAL_ACQ_H_
+#define INC_HAL_ACQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+
+typedef struct
+{
+    const uint16_t *samples; // ACQ_BLOCK_SIZE raw 12-bit samples of ADC1
+    uint16_t length;
+    uint32_t sequence;       // increments with every block the DMA completes
+} ACQ_block;
+
+void ACQ_init();
+void ACQ_arm();
+void ACQ_start();
+void ACQ_stop();
+bool ACQ_is_running();
+
+bool ACQ_get_block(ACQ_block *block);
+bool ACQ_wait_block(ACQ_block *block, uint32_t timeout_ms);
+bool ACQ_release_block();
+uint32_t ACQ_get_sample_index();
+
+uint32_t ACQ_get_overrun_count();
+void ACQ_reset_overrun_count();
+
+// called from the DMA half/full transfer interrupt
+void ACQ_on_dma_block_complete(uint8_t half);
+
+#endif /* INC_HAL_ACQ_H_ */
@@ -0,0 +1,6 @@
+#ifndef INC_HAL_CLOCK_H_
+#define INC_HAL_CLOCK_H_
+
+void CLOCK_config_coherent();
+
+#endif /* INC_HAL_CLOCK_H_ */
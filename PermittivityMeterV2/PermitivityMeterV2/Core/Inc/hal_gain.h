@@ -0,0 +1,17 @@
+#ifndef INC_HAL_GAIN_H_
+#define INC_HAL_GAIN_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+    GAIN_1X,  //
+    GAIN_10X, //
+    GAIN_100X
+} GAIN_setting;
+
+void GAIN_set(GAIN_setting gain);
+GAIN_setting GAIN_get();
+float GAIN_get_factor();
+
+#endif /* INC_HAL_GAIN_H_ */
@@ -0,0 +1,28 @@
+#ifndef INC_HAL_NINA_H_
+#define INC_HAL_NINA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mw_at_parser.h"
+
+void NINA_init();
+
+bool NINA_send_string(const char *string);
+bool NINA_send_bytes(const char *buffer, uint16_t length);
+
+bool NINA_get_token(AT_token *token);
+void NINA_set_data_mode(bool data_mode);
+
+void NINA_power_off();
+void NINA_power_on();
+bool NINA_is_powered_on();
+void NINA_reset();
+
+void NINA_start_dtr_pulse(uint16_t duration_ms);
+bool NINA_is_dtr_pulse_done();
+
+bool NINA_is_led_red_on();
+bool NINA_is_led_blue_on();
+
+#endif /* INC_HAL_NINA_H_ */
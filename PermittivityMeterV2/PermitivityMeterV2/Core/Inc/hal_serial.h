@@ -0,0 +1,34 @@
+#ifndef INC_HAL_SERIAL_H_
+#define INC_HAL_SERIAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+
+// called from the UART interrupt once the last byte of a write has been sent
+typedef void (*SERIAL_tx_callback)(void *context);
+
+void SERIAL_init();
+
+bool SERIAL_write(const uint8_t *data, uint16_t length);
+bool SERIAL_write_with_callback(const uint8_t *data, uint16_t length, SERIAL_tx_callback callback, void *context);
+uint16_t SERIAL_get_tx_free();
+bool SERIAL_is_tx_idle();
+bool SERIAL_flush(uint32_t timeout_ms);
+uint32_t SERIAL_get_tx_dropped();
+bool SERIAL_set_baud_rate(uint32_t baud_rate);
+uint32_t SERIAL_get_baud_rate();
+
+uint16_t SERIAL_read(uint8_t *data, uint16_t max_length);
+uint16_t SERIAL_get_rx_available();
+uint32_t SERIAL_get_rx_overruns();
+
+// called by the platform when a transfer started with PLATFORM_uart_transmit_start() is done
+void SERIAL_on_tx_complete();
+// called by the platform on half/full transfer and idle line, position = next byte the DMA writes
+void SERIAL_on_rx_event(uint16_t position);
+// called by the platform after a line error stopped the reception
+void SERIAL_on_rx_error();
+
+#endif /* INC_HAL_SERIAL_H_ */
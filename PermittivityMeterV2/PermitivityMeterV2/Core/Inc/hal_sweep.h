@@ -0,0 +1,12 @@
+#ifndef INC_HAL_SWEEP_H_
+#define INC_HAL_SWEEP_H_
+
+#include <stdint.h>
+
+#include "meas_config.h"
+
+void SWEEP_init();
+void SWEEP_start(uint8_t dac_output, const uint16_t *codes, uint16_t length);
+void SWEEP_stop();
+
+#endif /* INC_HAL_SWEEP_H_ */
@@ -0,0 +1,261 @@
+#ifndef INC_MEAS_CONFIG_H_
+#define INC_MEAS_CONFIG_H_
+
+/*
+ * Build-time configuration of the measurement chain.
+ * Everything that changes the signal path or the processing is switched here,
+ * so the hardware layer and the application layer agree on the same numbers.
+ */
+
+// ###### excitation
+
+// frequency of the reference driving the LC filter / Twin-T notch (MCO1, HSE crystal)
+#define MEAS_EXCITATION_HZ 20000000UL
+
+// ###### acquisition
+
+// number of ADC samples per processing block (one half of the ping-pong DMA buffer)
+#define ACQ_BLOCK_SIZE 512
+
+/*
+ * Coherent sampling: ADC1 is triggered by TIM6 instead of free running, and
+ * TIM6 runs from the HSE-locked PLL (see hal_clock.c). Sample rate and
+ * excitation then share one crystal and the aliased excitation tone always
+ * lands exactly on ACQ_ALIAS_BIN - no leakage, no window needed.
+ *
+ * 80 MHz / 653 = 122.51 kHz sample rate
+ * 20 MHz = 163.25 * fs -> alias at fs / 4 = 30.63 kHz -> bin ACQ_BLOCK_SIZE / 4
+ *
+ * Since the alias sits at fs / 4, every ACQ_BLOCK_SIZE that is a multiple of 4
+ * stays coherent, so shorter blocks can be used without losing accuracy.
+ */
+#define ACQ_COHERENT_SAMPLING 1
+
+#define ACQ_TRIGGER_CLOCK_HZ 80000000UL
+#define ACQ_TRIGGER_DIVIDER 653
+
+#define ACQ_SAMPLE_RATE_HZ ((float)ACQ_TRIGGER_CLOCK_HZ / ACQ_TRIGGER_DIVIDER)
+
+// cycles of the aliased excitation tone per block (before folding)
+#define ACQ_ALIAS_CYCLES_PER_BLOCK \
+    ((((unsigned long long)MEAS_EXCITATION_HZ * ACQ_TRIGGER_DIVIDER) % ACQ_TRIGGER_CLOCK_HZ) \
+     * ACQ_BLOCK_SIZE / ACQ_TRIGGER_CLOCK_HZ)
+
+// FFT bin of the aliased excitation tone (folded into the first Nyquist zone)
+#define ACQ_ALIAS_BIN \
+    (ACQ_ALIAS_CYCLES_PER_BLOCK > ACQ_BLOCK_SIZE / 2 ? ACQ_BLOCK_SIZE - ACQ_ALIAS_CYCLES_PER_BLOCK \
+                                                     : ACQ_ALIAS_CYCLES_PER_BLOCK)
+
+// ###### tuning
+
+// settling time of the varactor bias after a DAC step, before its samples are used
+#define TUNING_DAC_SETTLE_MS 1
+
+/*
+ * Window of the sliding DFT (dsp_sdft.h) that measures the tone after a DAC
+ * step: it starts TUNING_DAC_SETTLE_MS after the step wherever that falls in
+ * a DMA block, instead of with the first whole block after it. Whole periods
+ * of the alias, at most SDFT_WINDOW_LENGTH. 0 = whole blocks (DSP_tone_measure()).
+ */
+#define TUNING_SDFT_WINDOW 256
+
+// DAC code range searched for the notch (12 bit DAC)
+#define TUNING_DAC_CODE_MIN 0
+#define TUNING_DAC_CODE_MAX 4095
+
+// the D1 search stops once the notch is bracketed within this many LSB
+#define TUNING_TOLERANCE_LSB 2
+
+// warm start: half width of the first search box around the last converged codes
+#define TUNING_WARM_BRACKET_LSB 64
+// the box is doubled this many times before falling back to a full (cold) search
+#define TUNING_WARM_MAX_WIDENINGS 3
+// amplitude at the old codes above this multiple of the stored minimum = notch has moved
+#define TUNING_WARM_MOVED_RATIO 4.0f
+// a stored point older than this is not used, the notch can be anywhere by then (0 = no limit)
+#define TUNING_WARM_MAX_AGE_S 600
+
+/*
+ * Hardware sweep (coherent sampling only): TIM7 steps the DAC through a table
+ * every TUNING_SWEEP_SAMPLES_PER_STEP ADC samples. The first
+ * TUNING_SWEEP_SETTLE_SAMPLES of a step are dropped, the rest is measured.
+ * 256 samples = 2.09 ms per step, 32 steps = 67 ms for the whole curve.
+ * A cold search takes one curve per varactor to locate the notch coarsely.
+ */
+#define TUNING_SWEEP_POINTS 32
+#define TUNING_SWEEP_SAMPLES_PER_STEP 256
+#define TUNING_SWEEP_SETTLE_SAMPLES 128
+
+// ###### tracking
+
+/*
+ * Closed-loop notch tracking (APP_TRACKING, al_track.h): the varactor codes
+ * follow the notch block by block after the search. D1 and D2 are probed
+ * with a step of TRACK_PROBE_LSB, then every block is turned into a code
+ * correction that a PI controller applies, at most TRACK_MAX_STEP_LSB per
+ * block. One result goes out per 1 / TRACK_OUTPUT_HZ (up to about 200 Hz,
+ * a controller step takes one block, two with TUNING_SDFT_WINDOW 0). The lock counts as lost when the
+ * amplitude stays above TRACK_LOST_RATIO times the amplitude at lock (at
+ * least TRACK_LOST_MIN_LSB) for TRACK_LOST_UPDATES blocks, then a warm
+ * started search runs again.
+ */
+#define TRACK_OUTPUT_HZ 20
+#define TRACK_PROBE_LSB 16
+#define TRACK_KP 0.2f
+#define TRACK_KI 0.5f
+#define TRACK_MAX_STEP_LSB 64.0f
+#define TRACK_LOST_RATIO 4.0f
+#define TRACK_LOST_MIN_LSB 1.0f
+#define TRACK_LOST_UPDATES 8
+
+// ###### signal processing
+
+/*
+ * Detector used to measure the aliased excitation tone per block.
+ * GOERTZEL evaluates only ACQ_ALIAS_BIN in fixed point (default, used for tuning).
+ * FFT computes the full spectrum, slower, meant for diagnostics.
+ * Q15 correlates with ACQ_ALIAS_BIN two samples per instruction (dsp_q15.h),
+ * with the Hann window if DSP_Q15_WINDOWED.
+ */
+#define DSP_TONE_DETECTOR_GOERTZEL 0
+#define DSP_TONE_DETECTOR_FFT 1
+#define DSP_TONE_DETECTOR_Q15 2
+
+#define DSP_TONE_DETECTOR DSP_TONE_DETECTOR_GOERTZEL
+#define DSP_Q15_WINDOWED 0
+
+/*
+ * Longest reference period of the lock-in (dsp_lockin.h) in samples, its
+ * tables hold one period. The alias at fs / 4 needs 4.
+ */
+#define LOCKIN_MAX_PERIOD 16
+
+/*
+ * Window of the sliding DFT at ACQ_ALIAS_BIN (dsp_sdft.h), which updates the
+ * tone with every pushed sample instead of once per block. Must hold whole
+ * periods of the alias tone (4 samples at fs / 4); 512 = 4.18 ms.
+ */
+#define SDFT_WINDOW_LENGTH 512
+
+/*
+ * Implementation behind dsp_rfft.h (real FFT, complex magnitude).
+ * PORTABLE is plain C, used on the host and as long as the CMSIS-DSP library
+ * is not part of the build. CMSIS calls arm_rfft_fast_f32 / arm_rfft_q15 /
+ * arm_cmplx_mag_x of the Cortex-M4 FPU build (libarm_cortexM4lf_math.a): it
+ * needs Drivers/CMSIS/DSP/Include on the include path, the library in the
+ * linker settings and ARM_MATH_CM4 in the preprocessor symbols. The CMSIS
+ * branch has not been built or checked yet (dsp_rfft.c).
+ */
+#define DSP_BACKEND_PORTABLE 0
+#define DSP_BACKEND_CMSIS 1
+
+#define DSP_BACKEND DSP_BACKEND_PORTABLE
+
+// ###### NINA link
+
+// baud rate of MX_UART4_Init() and of the module after reset
+#define SERIAL_BAUD_RATE_DEFAULT 115200
+
+// UART4 transmit ring buffer, a write that does not fit is dropped as a whole
+#define SERIAL_TX_BUFFER_SIZE 1024
+// writes with a completion callback that can be pending at the same time
+#define SERIAL_TX_CALLBACK_SLOTS 8
+// UART4 circular receive buffer, must hold what arrives between two NINA_get_token() polls
+#define SERIAL_RX_BUFFER_SIZE 512
+// longest AT response/URC line, longer lines are dropped (data mode: split)
+#define AT_LINE_MAX_LENGTH 128
+
+// +STARTUP expected within this time after reset, the module is reset RF_MAX_REBOOTS times before giving up
+// (fatal error with the module always on, the session ends with APP_RADIO_DUTY_CYCLE)
+#define RF_BOOT_TIMEOUT_MS 3000
+#define RF_MAX_REBOOTS 10
+// time for the answer to an AT command, longer for the first one after +STARTUP
+#define RF_CMD_TIMEOUT_MS 400
+#define RF_CMD_TIMEOUT_BOOT_MS 1000
+// configuration commands and ATO1 are sent again after ERROR or timeout, the pause doubles every retry
+#define RF_CMD_RETRIES 2
+#define RF_CMD_BACKOFF_MS 50
+// AT command pipeline (mw_at_pipeline.h): commands queued at the same time, bytes of their text
+#define ATP_QUEUE_LENGTH 12
+#define ATP_ARENA_SIZE 256
+// DTR pulse that switches the module from data to command mode, OK expected within the timeout after it
+#define RF_DTR_PULSE_MS 2
+#define RF_MODE_SWITCH_TIMEOUT_MS 50
+// DTR pulses without OK until the module is taken to be in command mode already
+#define RF_ESCAPE_ATTEMPTS 3
+// negotiated with AT+UMRS after +STARTUP, 0 = stay at SERIAL_BAUD_RATE_DEFAULT
+#define RF_BAUD_RATE_FAST 921600
+// time the module needs to switch after its OK, attempts of the AT echo check at the new rate
+#define RF_BAUD_SWITCH_SETTLE_MS 20
+#define RF_BAUD_VERIFY_ATTEMPTS 3
+// longest message for RF_send_string()/RF_send_buffer(), holds a full result frame (FRAME_SIZE(FRAME_MAX_RECORDS))
+#define RF_MESSAGE_MAX_LENGTH 448
+#define RF_BT_LOCAL_NAME "Permittivity Meter"
+
+// peers connected to the module at the same time (mw_peer.h), longest address in +UUDPC
+#define PEER_MAX_COUNT 3
+#define PEER_ADDRESS_MAX_LENGTH 40
+
+// records per binary result frame (mw_frame.h) at most
+#define FRAME_MAX_RECORDS 16
+
+// ###### application
+
+// pause between two measure-and-transmit cycles
+#define APP_CYCLE_PAUSE_MS 500
+
+/*
+ * Streaming mode: 1 = search once, then follow the notch (al_track.h) and
+ * send a result every 1 / TRACK_OUTPUT_HZ instead of a search every
+ * APP_CYCLE_PAUSE_MS. Meant with a connected peer: without one the results
+ * fill the outbox quickly.
+ */
+#define APP_TRACKING 0
+
+// cycle count of the block detectors on the first ADC block after start (al_dspbench.h), 0: off
+#define APP_DSP_BENCHMARK 0
+
+/*
+ * Result output to the peer.
+ * TEXT sends one "MEAS ..." line per cycle (readable in a terminal).
+ * FRAME collects APP_FRAME_BATCH_RECORDS results into one binary frame with
+ * CRC (mw_frame.h, decoder in Tools/frame_decoder), 26 bytes per result.
+ */
+#define APP_OUTPUT_TEXT 0
+#define APP_OUTPUT_FRAME 1
+
+#define APP_OUTPUT_FORMAT APP_OUTPUT_FRAME
+#define APP_FRAME_BATCH_RECORDS 8
+
+/*
+ * Store and forward (FRAME output only): results of cycles without a peer go
+ * to the outbox in internal flash (mw_outbox.h) and are sent in frames of
+ * FRAME_MAX_RECORDS once a peer connects, also after a reset in between.
+ * The outbox uses the last OUTBOX_FLASH_PAGES pages of bank 2, kept out of
+ * the FLASH region in STM32L476RGTX_FLASH.ld (51 results per page).
+ */
+#define APP_OUTBOX 1
+#define OUTBOX_FLASH_ADDRESS 0x080C0000
+#define OUTBOX_FLASH_PAGES 128
+// sequence numbers reserved in flash at a time: a reset skips at most this many, none is used twice
+#define OUTBOX_SEQUENCE_BLOCK 1024
+
+/*
+ * Radio duty cycle (al_radio.h, needs APP_OUTBOX): the NINA module stays off
+ * until the outbox holds RADIO_WAKE_RECORDS results, its oldest result is
+ * RADIO_WAKE_AGE_S old or B1 is pressed, then sends everything and goes off
+ * RADIO_LINGER_MS after the outbox is empty. 0: module always on.
+ */
+#define APP_RADIO_DUTY_CYCLE 1
+#define RADIO_WAKE_RECORDS 128
+#define RADIO_WAKE_AGE_S 3600
+// a session without a peer ends after RADIO_CONNECT_TIMEOUT_S, the next one waits RADIO_RETRY_PAUSE_S
+#define RADIO_CONNECT_TIMEOUT_S 60
+#define RADIO_RETRY_PAUSE_S 600
+#define RADIO_LINGER_MS 500
+// energy estimate per session: supply [V], module current on / while sending [mA], to be replaced by measurements
+#define RADIO_SUPPLY_V 3.3f
+#define RADIO_CURRENT_ON_MA 30.0f
+#define RADIO_CURRENT_TX_MA 80.0f
+
+#endif /* INC_MEAS_CONFIG_H_ */
@@ -0,0 +1,43 @@
+#ifndef INC_MW_AT_PARSER_H_
+#define INC_MW_AT_PARSER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+
+// ###### typedefs
+
+typedef enum
+{
+    AT_TOKEN_OK,
+    AT_TOKEN_ERROR,
+    AT_TOKEN_STARTUP,           // +STARTUP, module has booted
+    AT_TOKEN_PEER_CONNECTED,    // +UUDPC:<peer handle>,...
+    AT_TOKEN_PEER_DISCONNECTED, // +UUDPD:<peer handle>,...
+    AT_TOKEN_LINE,              // any other line in command mode (information response, echo)
+    AT_TOKEN_DATA               // line received from the peer in data mode
+} AT_token_type;
+
+typedef struct
+{
+    AT_token_type type;
+    const char *text; // whole line without CR/LF, zero terminated, valid until the next AT_parser_feed()
+    uint16_t length;
+} AT_token;
+
+typedef struct
+{
+    char line[AT_LINE_MAX_LENGTH + 1];
+    uint16_t length;
+    bool data_mode;
+    bool discarding; // command mode line longer than AT_LINE_MAX_LENGTH, skipped up to its end
+} AT_parser;
+
+// ###### functions
+
+void AT_parser_init(AT_parser *parser);
+void AT_parser_set_data_mode(AT_parser *parser, bool data_mode);
+bool AT_parser_feed(AT_parser *parser, uint8_t byte, AT_token *token);
+
+#endif /* INC_MW_AT_PARSER_H_ */
@@ -0,0 +1,92 @@
+#ifndef INC_MW_AT_PIPELINE_H_
+#define INC_MW_AT_PIPELINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+#include "mw_at_parser.h"
+
+/*
+ * Queue of AT commands to the NINA module. One command is on the line at a
+ * time, each one carries its policy (timeout, retries, backoff, expected
+ * response) and a completion callback. The command text is formatted into
+ * the arena of the pipeline when it is queued.
+ *
+ * Commands queued between ATP_begin_sequence() and ATP_end_sequence() belong
+ * together: if one of them finally fails, the rest of the sequence is
+ * cancelled instead of being sent.
+ */
+
+// ###### typedefs
+
+typedef enum
+{
+    ATP_RESULT_OK,
+    ATP_RESULT_ERROR,      // ERROR after the last attempt
+    ATP_RESULT_TIMEOUT,    // no answer to the last attempt
+    ATP_RESULT_UNEXPECTED, // OK without the expected response
+    ATP_RESULT_CANCELLED   // an earlier command of the sequence failed
+} ATP_result;
+
+/**
+ * @param response: last line that matched ATP_policy.expect_prefix, NULL if none expected
+ */
+typedef void (*ATP_callback)(ATP_result result, const char *response, void *context);
+
+typedef struct
+{
+    uint16_t timeout_ms;
+    uint8_t retries;           // attempts after the first one on ERROR or timeout
+    uint16_t backoff_ms;       // pause before the first retry, doubled for every further one
+    const char *expect_prefix; // response line required before the OK, NULL: OK alone completes
+} ATP_policy;
+
+typedef struct
+{
+    uint16_t offset; // command text in the arena
+    uint16_t length;
+    const ATP_policy *policy;
+    ATP_callback callback;
+    void *context;
+    uint8_t sequence; // 0: not part of a sequence
+} ATP_entry;
+
+typedef enum
+{
+    ATP_STATE_READY,   // head not sent yet
+    ATP_STATE_WAITING, // head sent, waiting for its answer
+    ATP_STATE_BACKOFF  // head failed, waiting before it is sent again
+} ATP_state;
+
+typedef struct
+{
+    char arena[ATP_ARENA_SIZE];
+    uint16_t arena_used;
+    ATP_entry entries[ATP_QUEUE_LENGTH]; // entries[0] is the head
+    uint8_t count;
+
+    ATP_state state;
+    uint8_t attempts; // of the head
+    uint32_t deadline_ms;
+    bool has_response;
+    char response[AT_LINE_MAX_LENGTH + 1];
+
+    uint8_t sequence;      // assigned to commands queued now
+    uint8_t last_sequence; // last one handed out
+    bool sequence_failed;  // a command of the open sequence did not fit
+} ATP_pipeline;
+
+// ###### functions
+
+void ATP_init(ATP_pipeline *pipeline);
+bool ATP_enqueue(ATP_pipeline *pipeline, const ATP_policy *policy, ATP_callback callback, void *context,
+                 const char *format, ...);
+void ATP_begin_sequence(ATP_pipeline *pipeline);
+bool ATP_end_sequence(ATP_pipeline *pipeline);
+bool ATP_on_token(ATP_pipeline *pipeline, const AT_token *token);
+void ATP_cyclic(ATP_pipeline *pipeline, bool can_send);
+void ATP_clear(ATP_pipeline *pipeline);
+bool ATP_is_idle(const ATP_pipeline *pipeline);
+
+#endif /* INC_MW_AT_PIPELINE_H_ */
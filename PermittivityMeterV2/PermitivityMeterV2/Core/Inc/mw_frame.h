@@ -0,0 +1,89 @@
+#ifndef INC_MW_FRAME_H_
+#define INC_MW_FRAME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+
+/*
+ * Binary result frame, version 2, all fields little endian:
+ *
+ *   offset  size  field
+ *   0       1     FRAME_MAGIC
+ *   1       1     FRAME_VERSION
+ *   2       1     number of records n
+ *   3       1     record size (FRAME_RECORD_SIZE, later versions may append fields)
+ *   4       n*26  records
+ *   4+26n   2     CRC-16/CCITT-FALSE over everything before it
+ *
+ * Record:
+ *   0   uint32  sequence number, continues after a reset (with a gap, mw_outbox.h)
+ *   4   uint32  timestamp [s since power on]
+ *   8   uint16  eps'  [1/1000]
+ *   10  uint16  eps'' [1/10000]
+ *   12  uint16  DAC code D1
+ *   14  uint16  DAC code D2
+ *   16  uint16  notch amplitude [1/100 LSB], saturates at 65535
+ *   18  int16   temperature [1/100 degC]
+ *   20  uint8   gain (GAIN_setting)
+ *   21  uint8   FRAME_FLAG_x
+ *   22  uint16  duration of the search (tracking: of the period) [ms], saturates at 65535
+ *   24  uint16  evaluations = DAC settle + acquisition cycles (tracking: controller steps)
+ *
+ * Version 1 records end after the flags (22 bytes).
+ * The decoder is Tools/frame_decoder.
+ */
+
+// ###### defines
+
+#define FRAME_MAGIC 0xA5
+#define FRAME_VERSION 2
+#define FRAME_HEADER_SIZE 4
+#define FRAME_RECORD_SIZE 26
+#define FRAME_CRC_SIZE 2
+#define FRAME_SIZE(records) (FRAME_HEADER_SIZE + (records) * FRAME_RECORD_SIZE + FRAME_CRC_SIZE)
+
+#define FRAME_FLAG_EPS_VALID 0x01         // eps' / eps'' computed
+#define FRAME_FLAG_TEMPERATURE_VALID 0x02 // temperature measured
+#define FRAME_FLAG_WARM_START 0x04        // search started from the last codes
+#define FRAME_FLAG_WIDENED 0x08           // warm start box had to be widened
+#define FRAME_FLAG_COLD_FALLBACK 0x10     // warm start failed, cold search (sweep and phase refinement)
+#define FRAME_FLAG_TRACKING 0x20         // codes followed by the tracking loop, no search
+#define FRAME_FLAG_OVERWRITTEN 0x40      // a measurement only got blocks overwritten by the DMA
+
+// ###### typedefs
+
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t timestamp_s;
+    float permittivity_real;
+    float permittivity_imag;
+    uint16_t code_d1;
+    uint16_t code_d2;
+    float amplitude;
+    float temperature_c;
+    uint8_t gain;
+    uint8_t flags;
+    uint32_t duration_ms;
+    uint16_t evaluations;
+} FRAME_record;
+
+typedef struct
+{
+    uint8_t buffer[FRAME_SIZE(FRAME_MAX_RECORDS)];
+    uint16_t length;
+    uint8_t count;
+} FRAME_builder;
+
+// ###### functions
+
+void FRAME_begin(FRAME_builder *builder);
+bool FRAME_add(FRAME_builder *builder, const FRAME_record *record);
+bool FRAME_add_encoded(FRAME_builder *builder, const uint8_t *encoded);
+void FRAME_encode_record(const FRAME_record *record, uint8_t *out);
+uint16_t FRAME_finish(FRAME_builder *builder);
+uint16_t FRAME_crc16(const uint8_t *data, uint16_t length, uint16_t crc);
+
+#endif /* INC_MW_FRAME_H_ */
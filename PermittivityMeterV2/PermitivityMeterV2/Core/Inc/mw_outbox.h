@@ -0,0 +1,65 @@
+#ifndef INC_MW_OUTBOX_H_
+#define INC_MW_OUTBOX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+#include "mw_frame.h"
+#include "platform.h"
+
+/*
+ * Persistent queue of encoded result records (mw_frame.h) in internal flash,
+ * for the time no peer is connected. Records are appended one by one and
+ * taken out in frames: OUTBOX_peek_frame() fills a frame with the oldest
+ * pending records, OUTBOX_mark_sent() removes them once the frame has gone
+ * out. A reset between the two sends the frame again: delivery is at least
+ * once.
+ *
+ * Flash layout, OUTBOX_FLASH_PAGES pages used as a ring:
+ *   page:  uint32 OUTBOX_PAGE_MAGIC, uint32 page sequence, OUTBOX_SLOTS_PER_PAGE slots
+ *   slot:  26 byte record, uint16 CRC-16 of the record, 4 bytes erased,
+ *          8 byte sent marker (erased = pending, zero = sent)
+ * Pages of another magic (e.g. 32 byte slots of version 1 records) count
+ * as erased and are erased before they are used.
+ * A reset while programming leaves a slot with a wrong CRC or a double word
+ * with a double ECC error. The board reports the latter as NMI,
+ * PLATFORM_on_nmi() clears it and the outbox zeroes the slot (mw_outbox.c).
+ * When the ring is full the oldest page is erased, pending records on it
+ * are lost (counted in OUTBOX_statistics.dropped).
+ * The record sequence numbers continue after a reset: OUTBOX_init() returns
+ * the number after the highest one in flash. Results sent right away never
+ * reach the outbox, the application reserves their numbers in blocks of
+ * OUTBOX_SEQUENCE_BLOCK with OUTBOX_reserve_sequence().
+ */
+
+// ###### defines
+
+#define OUTBOX_PAGE_MAGIC 0x32584254u // "TBX2"
+#define OUTBOX_PAGE_HEADER_SIZE 8
+#define OUTBOX_SLOT_SIZE 40
+#define OUTBOX_SLOTS_PER_PAGE ((PLATFORM_FLASH_PAGE_SIZE - OUTBOX_PAGE_HEADER_SIZE) / OUTBOX_SLOT_SIZE)
+#define OUTBOX_CAPACITY ((uint32_t)OUTBOX_FLASH_PAGES * OUTBOX_SLOTS_PER_PAGE)
+
+// ###### typedefs
+
+typedef struct
+{
+    uint32_t pending;  // in flash, not sent yet
+    uint32_t appended; // since OUTBOX_init()
+    uint32_t sent;
+    uint32_t dropped; // overwritten before they were sent
+    uint32_t corrupt; // slots with a wrong CRC or a double ECC error (reset while programming), skipped
+} OUTBOX_statistics;
+
+// ###### functions
+
+uint32_t OUTBOX_init();
+bool OUTBOX_append(const uint8_t *encoded);
+bool OUTBOX_reserve_sequence(uint32_t sequence);
+uint8_t OUTBOX_peek_frame(FRAME_builder *builder, uint8_t max);
+void OUTBOX_mark_sent();
+uint32_t OUTBOX_get_pending();
+void OUTBOX_get_statistics(OUTBOX_statistics *statistics);
+
+#endif /* INC_MW_OUTBOX_H_ */
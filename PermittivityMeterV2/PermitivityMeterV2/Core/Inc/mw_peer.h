@@ -0,0 +1,52 @@
+#ifndef INC_MW_PEER_H_
+#define INC_MW_PEER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+
+/*
+ * Registry of the peers connected to the NINA module, filled from the
+ * +UUDPC / +UUDPD URCs (u-connectXpress):
+ *
+ *   +UUDPC:<peer handle>,<type>,<profile>,<address>,<frame size>
+ *   +UUDPD:<peer handle>,<type>
+ */
+
+// ###### defines
+
+#define PEER_HANDLE_UNKNOWN 0 // connection only seen on the blue LED (data mode, no URC)
+
+// ###### typedefs
+
+typedef enum
+{
+    PEER_TYPE_UNKNOWN = 0,
+    PEER_TYPE_BLUETOOTH = 1,
+    PEER_TYPE_IPV4 = 2,
+    PEER_TYPE_IPV6 = 3
+} PEER_type;
+
+typedef struct
+{
+    uint8_t handle;
+    uint8_t type;    // PEER_type
+    uint8_t profile; // as in the URC
+    char address[PEER_ADDRESS_MAX_LENGTH + 1];
+    uint16_t frame_size;
+} PEER_info;
+
+// ###### functions
+
+bool PEER_parse_connected(const char *urc, PEER_info *peer);
+bool PEER_parse_disconnected(const char *urc, uint8_t *handle);
+
+void PEER_clear();
+bool PEER_add(const PEER_info *peer);
+bool PEER_remove(uint8_t handle, PEER_info *removed);
+uint8_t PEER_get_count();
+const PEER_info *PEER_get(uint8_t index);
+const PEER_info *PEER_find(uint8_t handle);
+
+#endif /* INC_MW_PEER_H_ */
@@ -0,0 +1,57 @@
+#ifndef INC_MW_RF_HANDLER_H_
+#define INC_MW_RF_HANDLER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "meas_config.h"
+#include "mw_peer.h"
+
+// ###### typedefs
+
+typedef enum
+{
+    RF_STATUS_ERROR,
+    RF_STATUS_UNINITIALIZED,
+    RF_STATUS_BT_INITIALIZED
+} RF_status;
+
+typedef enum
+{
+    RF_DATA_MODE,
+    RF_CMD_MODE
+} RF_mode;
+
+typedef void (*RF_peer_callback)(const PEER_info *peer);
+
+// ###### functions
+
+void RF_init();
+void RF_cyclic();
+
+bool RF_fetch_BT_cmd(char *buffer, uint16_t size);
+
+bool RF_send_string(const char *string, bool override_last_transmission);
+bool RF_send_buffer(const uint8_t *data, uint16_t length, bool override_last_transmission);
+bool RF_send_bytes(const char *buffer, uint16_t length);
+
+// general
+void RF_NINA_power_off();
+void RF_NINA_power_on();
+bool RF_is_NINA_powered_on();
+bool RF_is_in_command_mode();
+bool RF_is_in_data_mode();
+bool RF_was_last_message_transmission_successful();
+bool RF_is_transmitting_message_through_nina();
+bool RF_is_booted();
+bool RF_has_boot_failed();
+bool RF_is_peer_connected();
+void RF_set_peer_callbacks(RF_peer_callback on_connected, RF_peer_callback on_disconnected);
+
+// BT
+bool RF_BT_is_enabled();
+bool RF_BT_is_initialized();
+void RF_BT_disable();
+void RF_BT_enable();
+
+#endif /* INC_MW_RF_HANDLER_H_ */
@@ -0,0 +1,88 @@
+#ifndef INC_PLATFORM_H_
+#define INC_PLATFORM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Thin interface between the application code and the hardware.
+ * platform_stm32.c implements it with the STM32L4 HAL, Simulation/host
+ * implements it on Linux with a virtual clock, the front end model feeding the
+ * ADC "DMA" and a pty as UART4. Code above this interface must not include
+ * main.h or the HAL.
+ */
+
+// ###### defines
+
+#define PLATFORM_FLASH_PAGE_SIZE 2048
+
+// ###### typedefs
+
+typedef enum
+{
+    PLATFORM_PIN_STATUS_LED,
+    PLATFORM_PIN_MEAS_LED,
+    PLATFORM_PIN_ERR_LED,
+    PLATFORM_PIN_GAIN_SLCT_1,
+    PLATFORM_PIN_GAIN_SLCT_2,
+    PLATFORM_PIN_NINA_RST,
+    PLATFORM_PIN_NINA_STOP,
+    PLATFORM_PIN_NINA_DTR,
+    PLATFORM_PIN_NINA_LED_RED, // input, status LED of the module
+    PLATFORM_PIN_NINA_LED_BLUE, // input, status LED of the module
+    PLATFORM_PIN_COUNT
+} PLATFORM_pin;
+
+typedef void (*PLATFORM_timer_callback)();
+
+// ###### functions
+
+// time and CPU
+uint32_t PLATFORM_get_tick_ms();
+void PLATFORM_delay_ms(uint32_t delay_ms);
+void PLATFORM_wait_for_interrupt();
+void PLATFORM_irq_disable();
+void PLATFORM_irq_enable();
+void PLATFORM_fatal_error();
+uint32_t PLATFORM_get_cycle_count(); // CPU clock cycles (DWT CYCCNT), wraps after 53 s at 80 MHz
+
+// GPIO
+void PLATFORM_pin_write(PLATFORM_pin pin, bool level);
+void PLATFORM_pin_toggle(PLATFORM_pin pin);
+bool PLATFORM_pin_read(PLATFORM_pin pin);
+
+// one shot timer (TIM15), the callback runs in its interrupt
+void PLATFORM_timer_start(uint16_t duration_ms, PLATFORM_timer_callback callback);
+void PLATFORM_timer_stop();
+
+// DAC1, channel 0 = OUT1 (FRQ_TN), 1 = OUT2 (Q_FACT_TN)
+void PLATFORM_dac_write(uint8_t channel, uint16_t code);
+
+// ADC1 circular capture, completion of each half calls ACQ_on_dma_block_complete()
+void PLATFORM_adc_init();
+void PLATFORM_adc_arm(uint16_t *buffer, uint32_t length);
+void PLATFORM_adc_trigger_start();
+void PLATFORM_adc_stop();
+// index in the buffer of PLATFORM_adc_arm() the DMA writes next
+uint32_t PLATFORM_adc_get_position();
+
+// UART4 to the NINA module, end of a transfer calls SERIAL_on_tx_complete()
+void PLATFORM_uart_init();
+void PLATFORM_uart_transmit_start(const uint8_t *data, uint16_t length);
+// only while no transfer is running, stops the reception (restart with PLATFORM_uart_receive_start())
+void PLATFORM_uart_set_baud_rate(uint32_t baud_rate);
+// circular reception, half/full/idle line call SERIAL_on_rx_event(), errors SERIAL_on_rx_error()
+void PLATFORM_uart_receive_start(uint8_t *buffer, uint16_t length);
+
+// user button B1 (EXTI, falling edge)
+void PLATFORM_button_init();
+bool PLATFORM_button_fetch_press(); // true once per press since the last call
+
+// internal flash of the outbox (OUTBOX_FLASH_PAGES pages at OUTBOX_FLASH_ADDRESS), offsets within that region
+// erased bytes read 0xFF, false if a double word of the range has a double ECC error (reset while programming)
+bool PLATFORM_flash_read(uint32_t offset, void *data, uint16_t length);
+bool PLATFORM_flash_erase_page(uint16_t page);
+// double words, each one erased before or written to zero (the only change the ECC allows, also clears an ECC error)
+bool PLATFORM_flash_program(uint32_t offset, const uint64_t *data, uint16_t count);
+
+#endif /* INC_PLATFORM_H_ */
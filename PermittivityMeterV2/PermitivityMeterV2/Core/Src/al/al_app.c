@@ -0,0 +1,361 @@
+#include "al_app.h"
+#include <stdio.h>
+#include "platform.h"
+#include "meas_config.h"
+#include "hal_acq.h"
+#include "hal_gain.h"
+#include "hal_sweep.h"
+#include "hal_serial.h"
+#include "mw_rf_handler.h"
+#include "mw_frame.h"
+#include "mw_outbox.h"
+#include "al_radio.h"
+#include "al_dspbench.h"
+#include "al_track.h"
+#include "al_warmstart.h"
+#include "dsp_tone.h"
+
+/*
+ * Measure-and-transmit cycle. Only uses platform.h below the application
+ * layer, so the same cycle runs on the board (main.c) and on the host
+ * (Simulation/host). The NINA module is served between the cycles
+ * (APP_idle()), a result goes out once a peer is connected. A peer that
+ * connects gets the results collected so far right away, not with the next
+ * full frame. Without a peer the results wait in the flash outbox (APP_OUTBOX)
+ * and are sent in full frames once one is connected. With APP_RADIO_DUTY_CYCLE
+ * the module is only switched on to empty the outbox (al_radio.c).
+ * With APP_TRACKING a cycle follows the notch for 1 / TRACK_OUTPUT_HZ
+ * (al_track.c) and only searches when the lock is lost.
+ */
+
+// ###### defines
+
+#define APP_BENCHMARK_BLOCK_TIMEOUT_MS 50
+
+_Static_assert(FRAME_SIZE(FRAME_MAX_RECORDS) <= RF_MESSAGE_MAX_LENGTH, "a full result frame must fit RF_send_buffer()");
+
+// ###### global variables
+
+static uint32_t app_cycle_count = 0; // sequence number of the result, continues after a reset with APP_OUTBOX
+#if !(APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX && APP_RADIO_DUTY_CYCLE)
+static bool app_bt_enable_requested = false;
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME
+static FRAME_builder app_frame;
+static bool app_is_frame_flush_requested = false;
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX
+static FRAME_builder app_outbox_frame;
+static bool app_is_outbox_frame_in_flight = false;
+static bool app_is_peer_lost = false;
+static uint32_t app_sequence_reserved = 0; // numbers below are stored as used in the outbox
+#endif
+
+// ###### private functions
+
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME
+static void APP_send_frame()
+{
+    uint16_t length = FRAME_finish(&app_frame);
+
+    RF_send_buffer(app_frame.buffer, length, true); // an older frame not sent yet is replaced
+    FRAME_begin(&app_frame);
+}
+
+/**
+ * Called inside RF_cyclic(), the frame goes out from APP_idle().
+ */
+static void APP_on_peer_connected(const PEER_info *peer)
+{
+    (void)peer;
+    app_is_frame_flush_requested = true;
+}
+
+#if APP_OUTBOX
+/**
+ * Called inside RF_cyclic(), the open frame goes to the outbox from APP_idle().
+ */
+static void APP_on_peer_disconnected(const PEER_info *peer)
+{
+    (void)peer;
+    app_is_peer_lost = !RF_is_peer_connected();
+}
+
+/**
+ * Results of the open frame to the outbox, in front of everything that
+ * follows while no peer is connected.
+ */
+static void APP_move_frame_to_outbox()
+{
+    uint8_t i;
+
+    for (i = 0; i < app_frame.count; i++)
+        OUTBOX_append(&app_frame.buffer[FRAME_HEADER_SIZE + (uint16_t)i * FRAME_RECORD_SIZE]);
+    FRAME_begin(&app_frame);
+}
+
+/**
+ * One outbox frame at a time: the records are marked sent once the frame has
+ * left UART4, a frame replaced or dropped before is read again. Bytes the
+ * module takes and loses are not noticed (no acknowledge from the peer).
+ */
+static void APP_drain_outbox()
+{
+    if (app_is_outbox_frame_in_flight)
+    {
+        if (RF_is_transmitting_message_through_nina())
+            return;
+        if (RF_was_last_message_transmission_successful())
+        {
+            if (!SERIAL_is_tx_idle())
+                return; // a reset now would lose it in the transmit buffer
+            OUTBOX_mark_sent();
+        }
+        app_is_outbox_frame_in_flight = false;
+    }
+    if (!RF_is_peer_connected() || RF_is_transmitting_message_through_nina() || OUTBOX_get_pending() == 0)
+        return;
+
+    FRAME_begin(&app_outbox_frame);
+    if (OUTBOX_peek_frame(&app_outbox_frame, FRAME_MAX_RECORDS) == 0)
+        return;
+    app_is_outbox_frame_in_flight =
+        RF_send_buffer(app_outbox_frame.buffer, FRAME_finish(&app_outbox_frame), false);
+}
+#endif
+
+/**
+ * Adds the result to the open frame, sends the frame once it holds
+ * APP_FRAME_BATCH_RECORDS results.
+ */
+static void APP_output_result(const OPTIM2D_result *result, const TUNING_telemetry *telemetry, bool is_tracked)
+{
+    FRAME_record record;
+
+    record.sequence = app_cycle_count;
+    record.timestamp_s = PLATFORM_get_tick_ms() / 1000;
+    // no calibration to eps and no temperature sensor yet: zero, not flagged valid
+    record.permittivity_real = 0.0f;
+    record.permittivity_imag = 0.0f;
+    record.temperature_c = 0.0f;
+    record.code_d1 = result->code_d1;
+    record.code_d2 = result->code_d2;
+    record.amplitude = result->amplitude;
+    record.gain = (uint8_t)GAIN_get();
+    record.duration_ms = telemetry->duration_ms;
+    record.evaluations = telemetry->evaluations;
+    record.flags = 0;
+    if (telemetry->warm_start)
+        record.flags |= FRAME_FLAG_WARM_START;
+    if (telemetry->widenings > 0)
+        record.flags |= FRAME_FLAG_WIDENED;
+    if (telemetry->widenings > TUNING_WARM_MAX_WIDENINGS)
+        record.flags |= FRAME_FLAG_COLD_FALLBACK;
+    if (is_tracked)
+        record.flags |= FRAME_FLAG_TRACKING;
+    if (telemetry->overwritten > 0)
+        record.flags |= FRAME_FLAG_OVERWRITTEN;
+
+#if APP_OUTBOX
+    // a result sent right away leaves no trace in flash, its number has to be reserved before
+    if (app_cycle_count >= app_sequence_reserved &&
+        OUTBOX_reserve_sequence(app_cycle_count + OUTBOX_SEQUENCE_BLOCK - 1))
+        app_sequence_reserved = app_cycle_count + OUTBOX_SEQUENCE_BLOCK;
+    // behind the older results that are still waiting, the peer gets them in order
+    if (!RF_is_peer_connected() || OUTBOX_get_pending() > 0)
+    {
+        uint8_t encoded[FRAME_RECORD_SIZE];
+
+        FRAME_encode_record(&record, encoded);
+        OUTBOX_append(encoded);
+        return;
+    }
+#endif
+    FRAME_add(&app_frame, &record);
+    if (app_frame.count >= APP_FRAME_BATCH_RECORDS)
+        APP_send_frame();
+}
+#else
+/**
+ * Sends the result as one text line.
+ */
+static void APP_output_result(const OPTIM2D_result *result, const TUNING_telemetry *telemetry, bool is_tracked)
+{
+    char line[96];
+    int length;
+
+    // amplitude in 1/100 LSB, no float printf needed
+    length = snprintf(line, sizeof(line), "MEAS %lu D1=%u D2=%u A=%lu N=%u T=%lu%s%s%s\r\n",
+                      (unsigned long)app_cycle_count, result->code_d1, result->code_d2,
+                      (unsigned long)(result->amplitude * 100.0f), telemetry->evaluations,
+                      (unsigned long)telemetry->duration_ms, telemetry->warm_start ? " W" : "", is_tracked ? " K" : "",
+                      telemetry->overwritten > 0 ? " O" : "");
+    if (length > 0)
+        RF_send_string(line, true); // an older result not sent yet is replaced
+}
+#endif
+
+#if APP_TRACKING
+/**
+ * Follows the notch for one output period. The tracked codes are stored as
+ * warm start point, a search after a lost lock starts there.
+ * @param telemetry: evaluations = controller steps of the period
+ * @return false once the lock is lost
+ */
+static bool APP_track(OPTIM2D_result *result, TUNING_telemetry *telemetry)
+{
+    uint32_t start_tick = PLATFORM_get_tick_ms();
+    WARMSTART_point point;
+
+    telemetry->warm_start = false;
+    telemetry->widenings = 0;
+    telemetry->evaluations = 0;
+    TUNING_reset_overwritten_count();
+    do
+    {
+        if (!TRACK_update(result))
+            return false;
+        telemetry->evaluations++;
+    } while (PLATFORM_get_tick_ms() - start_tick < 1000 / TRACK_OUTPUT_HZ);
+    telemetry->overwritten = TUNING_get_overwritten_count();
+    telemetry->duration_ms = PLATFORM_get_tick_ms() - start_tick;
+    result->evaluations = telemetry->evaluations;
+
+    point.code_d1 = result->code_d1;
+    point.code_d2 = result->code_d2;
+    point.gain = (uint8_t)GAIN_get();
+    point.amplitude = result->amplitude;
+    point.timestamp_s = PLATFORM_get_tick_ms() / 1000;
+    WARMSTART_save(&point);
+    return true;
+}
+#endif
+
+#if APP_DSP_BENCHMARK
+static void APP_run_dsp_benchmark()
+{
+    ACQ_block block;
+
+    ACQ_start();
+    if (!ACQ_wait_block(&block, APP_BENCHMARK_BLOCK_TIMEOUT_MS))
+        PLATFORM_fatal_error();
+    DSPBENCH_run(block.samples);
+    ACQ_release_block();
+    ACQ_stop();
+}
+#endif
+
+// ###### functions
+
+void APP_init()
+{
+    ACQ_init();
+    RF_init();
+#if ACQ_COHERENT_SAMPLING
+    SWEEP_init();
+#endif
+    if (!DSP_tone_init())
+        PLATFORM_fatal_error();
+    TUNING_init();
+    // the notch output is in the mV range, 10x keeps the minimum above the ADC noise
+    GAIN_set(GAIN_10X);
+#if APP_DSP_BENCHMARK
+    APP_run_dsp_benchmark();
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME
+    FRAME_begin(&app_frame);
+#if APP_OUTBOX
+    // results of an earlier run still waiting are sent first, the sequence goes on behind them
+    app_cycle_count = OUTBOX_init();
+    app_sequence_reserved = app_cycle_count;
+    RF_set_peer_callbacks(APP_on_peer_connected, APP_on_peer_disconnected);
+#if APP_RADIO_DUTY_CYCLE
+    RADIO_init(); // module off until there is something to send
+#endif
+#else
+    RF_set_peer_callbacks(APP_on_peer_connected, NULL);
+#endif
+#endif
+}
+
+/**
+ * One measurement: warm started notch search, result on UART4 (APP_OUTPUT_FORMAT).
+ * With APP_TRACKING one output period of tracking, searching only without lock.
+ * @param report: optional, receives result and telemetry of the cycle
+ */
+void APP_cycle(APP_report *report)
+{
+    OPTIM2D_result result;
+    TUNING_telemetry telemetry;
+    bool is_tracked = false;
+
+    PLATFORM_pin_write(PLATFORM_PIN_MEAS_LED, true);
+#if APP_TRACKING
+    if (TRACK_is_locked())
+        is_tracked = APP_track(&result, &telemetry);
+    if (!is_tracked)
+    {
+        TUNING_search_auto(PLATFORM_get_tick_ms() / 1000, &result, &telemetry);
+        TRACK_start(&result); // without lock the next cycle searches again
+    }
+#else
+    TUNING_search_auto(PLATFORM_get_tick_ms() / 1000, &result, &telemetry);
+#endif
+    PLATFORM_pin_write(PLATFORM_PIN_MEAS_LED, false);
+
+    APP_output_result(&result, &telemetry, is_tracked);
+
+    PLATFORM_pin_toggle(PLATFORM_PIN_STATUS_LED);
+
+    if (report != NULL)
+    {
+        report->cycle = app_cycle_count;
+        report->result = result;
+        report->telemetry = telemetry;
+        report->is_tracked = is_tracked;
+    }
+    app_cycle_count++;
+}
+
+/**
+ * Pause between two cycles, serves the NINA module every millisecond (SysTick)
+ * instead of sleeping through it.
+ */
+void APP_idle(uint32_t duration_ms)
+{
+    uint32_t start = PLATFORM_get_tick_ms();
+
+    do
+    {
+        RF_cyclic();
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX && APP_RADIO_DUTY_CYCLE
+        RADIO_cyclic(); // enables BT after every power on
+#else
+        if (RF_has_boot_failed())
+            PLATFORM_fatal_error(); // the module is needed all the time
+        if (RF_is_booted() && !app_bt_enable_requested)
+        {
+            RF_BT_enable(); // connectable and discoverable for the PC
+            app_bt_enable_requested = true;
+        }
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX
+        if (app_is_peer_lost)
+        {
+            app_is_peer_lost = false;
+            APP_move_frame_to_outbox();
+        }
+        APP_drain_outbox();
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME
+        if (app_is_frame_flush_requested)
+        {
+            // partial frame for the new peer, unless a full one is still waiting for it
+            app_is_frame_flush_requested = false;
+            if (app_frame.count > 0 && !RF_is_transmitting_message_through_nina())
+                APP_send_frame();
+        }
+#endif
+        PLATFORM_wait_for_interrupt();
+    } while (PLATFORM_get_tick_ms() - start < duration_ms);
+}
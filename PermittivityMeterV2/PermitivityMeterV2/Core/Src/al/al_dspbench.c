@@ -0,0 +1,110 @@
+#include "al_dspbench.h"
+#include "platform.h"
+#include "meas_config.h"
+#include "dsp_fft.h"
+#include "dsp_goertzel.h"
+#include "dsp_lockin.h"
+#include "dsp_q15.h"
+
+/*
+ * Cycle count of the block detectors on one real ADC block (APP_DSP_BENCHMARK).
+ * Every detector runs DSPBENCH_RUNS times and the fastest run counts, so an
+ * interrupt in between does not show up. On the host the "cycles" are host
+ * time (PLATFORM_get_cycle_count()).
+ */
+
+// ###### defines
+
+#define DSPBENCH_RUNS 8
+
+// ###### typedefs
+
+typedef enum
+{
+    DSPBENCH_GOERTZEL,
+    DSPBENCH_LOCKIN,
+    DSPBENCH_Q15_TONE,
+    DSPBENCH_Q15_TONE_HANN,
+    DSPBENCH_F32_SPECTRUM,
+    DSPBENCH_Q15_SPECTRUM,
+    DSPBENCH_DETECTOR_COUNT
+} DSPBENCH_detector;
+
+// ###### global variables
+
+static DSPBENCH_result dspbench_result;
+static DSP_goertzel dspbench_goertzel;
+static DSP_lockin dspbench_lockin;
+static DSP_q15 dspbench_q15;
+static DSP_q15 dspbench_q15_hann;
+static float dspbench_magnitudes[ACQ_BLOCK_SIZE / 2];
+static int16_t dspbench_magnitudes_q15[ACQ_BLOCK_SIZE / 2 + 1];
+
+// ###### functions
+
+/**
+ * @param samples: ACQ_BLOCK_SIZE raw ADC samples
+ */
+void DSPBENCH_run(const uint16_t *samples)
+{
+    uint32_t best[DSPBENCH_DETECTOR_COUNT];
+    uint32_t run, start, cycles;
+    DSPBENCH_detector detector;
+    DSP_tone tone;
+    DSP_lockin_result lockin;
+
+    if (!DSP_goertzel_init(&dspbench_goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE))
+        PLATFORM_fatal_error();
+    if (!DSP_lockin_init(&dspbench_lockin, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, 0))
+        PLATFORM_fatal_error();
+    DSP_q15_init(&dspbench_q15, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, false);
+    DSP_q15_init(&dspbench_q15_hann, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, true);
+
+    for (detector = 0; detector < DSPBENCH_DETECTOR_COUNT; detector++)
+    {
+        best[detector] = UINT32_MAX;
+        for (run = 0; run < DSPBENCH_RUNS; run++)
+        {
+            start = PLATFORM_get_cycle_count();
+            switch (detector)
+            {
+            case DSPBENCH_GOERTZEL:
+                DSP_goertzel_process(&dspbench_goertzel, samples, &tone);
+                dspbench_result.goertzel_amplitude = tone.amplitude;
+                break;
+            case DSPBENCH_LOCKIN:
+                DSP_lockin_process(&dspbench_lockin, samples, ACQ_BLOCK_SIZE, &lockin);
+                break;
+            case DSPBENCH_Q15_TONE:
+                DSP_q15_tone(&dspbench_q15, samples, &tone);
+                dspbench_result.q15_amplitude = tone.amplitude;
+                break;
+            case DSPBENCH_Q15_TONE_HANN:
+                DSP_q15_tone(&dspbench_q15_hann, samples, &tone);
+                break;
+            case DSPBENCH_F32_SPECTRUM:
+                DSP_fft_spectrum(samples, ACQ_BLOCK_SIZE, dspbench_magnitudes);
+                break;
+            default: // DSPBENCH_Q15_SPECTRUM
+                DSP_q15_spectrum(&dspbench_q15, samples, dspbench_magnitudes_q15);
+                break;
+            }
+            cycles = PLATFORM_get_cycle_count() - start;
+            if (cycles < best[detector])
+                best[detector] = cycles;
+        }
+    }
+
+    dspbench_result.goertzel = best[DSPBENCH_GOERTZEL];
+    dspbench_result.lockin = best[DSPBENCH_LOCKIN];
+    dspbench_result.q15_tone = best[DSPBENCH_Q15_TONE];
+    dspbench_result.q15_tone_hann = best[DSPBENCH_Q15_TONE_HANN];
+    dspbench_result.f32_spectrum = best[DSPBENCH_F32_SPECTRUM];
+    dspbench_result.q15_spectrum = best[DSPBENCH_Q15_SPECTRUM];
+    dspbench_result.runs = DSPBENCH_RUNS;
+}
+
+void DSPBENCH_get_result(DSPBENCH_result *result)
+{
+    *result = dspbench_result;
+}
@@ -0,0 +1,244 @@
+#include "al_minimizer.h"
+#include <math.h>
+
+/*
+ * 1-D minimizers for the varactor DAC search.
+ * Every evaluation costs a DAC settle plus one acquisition, so the searches
+ * work on the integer DAC codes directly and never measure a code twice.
+ * Both methods assume the amplitude is unimodal between lower and upper,
+ * which holds around the notch once the rough position is known.
+ */
+
+// ###### defines
+
+#define MINIMIZER_CACHE_SIZE 32
+#define MINIMIZER_MAX_ITERATIONS 64
+
+#define MINIMIZER_GOLDEN 0.381966011f // (3 - sqrt(5)) / 2
+
+// ###### typedefs
+
+typedef struct
+{
+    MINIMIZER_measure_callback measure;
+    void *context;
+    uint16_t lower;
+    uint16_t upper;
+    uint16_t codes[MINIMIZER_CACHE_SIZE];
+    float amplitudes[MINIMIZER_CACHE_SIZE];
+    uint8_t cache_count;
+    uint8_t cache_next;
+    MINIMIZER_result *result;
+} MINIMIZER_state;
+
+// ###### private functions
+
+/**
+ * Measures at the code closest to x. Codes that were already measured are
+ * answered from the cache, so rounding never costs an extra evaluation.
+ */
+static float MINIMIZER_evaluate(MINIMIZER_state *state, float x)
+{
+    uint16_t code;
+    uint8_t i;
+    float amplitude;
+
+    if (x < (float)state->lower)
+        x = (float)state->lower;
+    if (x > (float)state->upper)
+        x = (float)state->upper;
+    code = (uint16_t)lroundf(x);
+
+    for (i = 0; i < state->cache_count; i++)
+    {
+        if (state->codes[i] == code)
+            return state->amplitudes[i];
+    }
+
+    amplitude = state->measure(code, state->context);
+    state->result->evaluations++;
+
+    state->codes[state->cache_next] = code;
+    state->amplitudes[state->cache_next] = amplitude;
+    state->cache_next = (state->cache_next + 1) % MINIMIZER_CACHE_SIZE;
+    if (state->cache_count < MINIMIZER_CACHE_SIZE)
+        state->cache_count++;
+
+    if (state->result->evaluations == 1 || amplitude < state->result->amplitude)
+    {
+        state->result->code = code;
+        state->result->amplitude = amplitude;
+    }
+    return amplitude;
+}
+
+static void MINIMIZER_golden_section(MINIMIZER_state *state, float tolerance)
+{
+    float a = (float)state->lower;
+    float b = (float)state->upper;
+    float c = a + MINIMIZER_GOLDEN * (b - a);
+    float d = b - MINIMIZER_GOLDEN * (b - a);
+    float fc = MINIMIZER_evaluate(state, c);
+    float fd = MINIMIZER_evaluate(state, d);
+    uint8_t iteration;
+
+    for (iteration = 0; iteration < MINIMIZER_MAX_ITERATIONS && (b - a) > tolerance; iteration++)
+    {
+        if (fc < fd)
+        {
+            b = d;
+            d = c;
+            fd = fc;
+            c = a + MINIMIZER_GOLDEN * (b - a);
+            fc = MINIMIZER_evaluate(state, c);
+        }
+        else
+        {
+            a = c;
+            c = d;
+            fc = fd;
+            d = b - MINIMIZER_GOLDEN * (b - a);
+            fd = MINIMIZER_evaluate(state, d);
+        }
+    }
+}
+
+/**
+ * Brent's method: parabolic interpolation through the three best points,
+ * falling back to a golden section step whenever the parabola is not trusted.
+ */
+static void MINIMIZER_brent(MINIMIZER_state *state, float tolerance)
+{
+    float a = (float)state->lower;
+    float b = (float)state->upper;
+    float x = a + MINIMIZER_GOLDEN * (b - a);
+    float w = x;
+    float v = x;
+    float fx = MINIMIZER_evaluate(state, x);
+    float fw = fx;
+    float fv = fx;
+    float d = 0.0f;
+    float e = 0.0f;
+    // steps below half a code can not be resolved by the DAC
+    float tol1 = fmaxf(tolerance * 0.5f, 0.5f);
+    float tol2 = 2.0f * tol1;
+    uint8_t iteration;
+
+    for (iteration = 0; iteration < MINIMIZER_MAX_ITERATIONS; iteration++)
+    {
+        float xm = 0.5f * (a + b);
+        float u, fu;
+
+        if (fabsf(x - xm) <= tol2 - 0.5f * (b - a))
+            break;
+
+        if (fabsf(e) > tol1)
+        {
+            float r = (x - w) * (fx - fv);
+            float q = (x - v) * (fx - fw);
+            float p = (x - v) * q - (x - w) * r;
+            float e_previous = e;
+
+            q = 2.0f * (q - r);
+            if (q > 0.0f)
+                p = -p;
+            q = fabsf(q);
+            e = d;
+
+            if (fabsf(p) >= fabsf(0.5f * q * e_previous) || p <= q * (a - x) || p >= q * (b - x))
+            {
+                // parabola not acceptable -> golden section step
+                e = (x >= xm) ? a - x : b - x;
+                d = MINIMIZER_GOLDEN * e;
+            }
+            else
+            {
+                d = p / q;
+                u = x + d;
+                if (u - a < tol2 || b - u < tol2)
+                    d = (xm - x >= 0.0f) ? tol1 : -tol1;
+            }
+        }
+        else
+        {
+            e = (x >= xm) ? a - x : b - x;
+            d = MINIMIZER_GOLDEN * e;
+        }
+
+        if (fabsf(d) >= tol1)
+            u = x + d;
+        else
+            u = x + ((d >= 0.0f) ? tol1 : -tol1);
+        fu = MINIMIZER_evaluate(state, u);
+
+        if (fu <= fx)
+        {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w;
+            fv = fw;
+            w = x;
+            fw = fx;
+            x = u;
+            fx = fu;
+        }
+        else
+        {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x)
+            {
+                v = w;
+                fv = fw;
+                w = u;
+                fw = fu;
+            }
+            else if (fu <= fv || v == x || v == w)
+            {
+                v = u;
+                fv = fu;
+            }
+        }
+    }
+}
+
+// ###### functions
+
+/**
+ * Searches the DAC code with the minimum amplitude between lower and upper.
+ * @param method: golden section (robust) or Brent (fewer evaluations on a smooth notch)
+ * @param tolerance_lsb: the search stops once the minimum is bracketed this tight
+ * @param measure: sets the DAC, waits for it to settle and returns the amplitude
+ * @param result: best code found, its amplitude and the number of evaluations
+ */
+void MINIMIZER_search(MINIMIZER_method method, uint16_t lower, uint16_t upper, uint16_t tolerance_lsb,
+                      MINIMIZER_measure_callback measure, void *context, MINIMIZER_result *result)
+{
+    MINIMIZER_state state = {0};
+    float tolerance = (tolerance_lsb > 0) ? (float)tolerance_lsb : 1.0f;
+
+    state.measure = measure;
+    state.context = context;
+    state.lower = lower;
+    state.upper = upper;
+    state.result = result;
+
+    result->code = lower;
+    result->amplitude = 0.0f;
+    result->evaluations = 0;
+
+    if (upper <= lower)
+    {
+        MINIMIZER_evaluate(&state, (float)lower);
+        return;
+    }
+
+    if (method == MINIMIZER_BRENT)
+        MINIMIZER_brent(&state, tolerance);
+    else
+        MINIMIZER_golden_section(&state, tolerance);
+}
@@ -0,0 +1,362 @@
+#include "al_optim2d.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "al_minimizer.h"
+
+/*
+ * Joint search over both varactor DACs.
+ * In the Twin-T notch D1 and D2 interact: moving D2 shifts the frequency of
+ * the minimum a little, so tuning D1 to convergence first and D2 afterwards
+ * wastes evaluations on a D1 optimum that moves again. The methods here search
+ * both codes together. Every evaluation is recorded in the optional trace so
+ * the methods can be compared in evaluations-to-converge.
+ */
+
+// ###### defines
+
+#define OPTIM2D_CACHE_SIZE 16
+#define OPTIM2D_MAX_SWEEPS 8
+#define OPTIM2D_MAX_EVALUATIONS 120
+#define OPTIM2D_MAX_RESTARTS 4
+#define OPTIM2D_COLLAPSED_RATIO 0.01f // simplex area / size^2 below which it is a line
+#define OPTIM2D_RESTART_STEP 0.125f   // simplex of a restart relative to the previous one
+
+// ###### typedefs
+
+typedef struct
+{
+    const OPTIM2D_params *params;
+    OPTIM2D_measure_callback measure;
+    void *context;
+    OPTIM2D_trace *trace;
+    OPTIM2D_result *result;
+    OPTIM2D_evaluation cache[OPTIM2D_CACHE_SIZE];
+    uint8_t cache_count;
+    uint8_t cache_next;
+    // line search state
+    uint16_t fixed_code;
+    uint8_t line_axis; // 0 = D1 is searched, 1 = D2 is searched
+} OPTIM2D_state;
+
+// ###### private functions
+
+static uint16_t OPTIM2D_clamp(float x, uint16_t lower, uint16_t upper)
+{
+    if (x < (float)lower)
+        return lower;
+    if (x > (float)upper)
+        return upper;
+    return (uint16_t)lroundf(x);
+}
+
+static float OPTIM2D_evaluate(OPTIM2D_state *state, float x_d1, float x_d2)
+{
+    uint16_t d1 = OPTIM2D_clamp(x_d1, state->params->lower_d1, state->params->upper_d1);
+    uint16_t d2 = OPTIM2D_clamp(x_d2, state->params->lower_d2, state->params->upper_d2);
+    OPTIM2D_evaluation *evaluation;
+    uint8_t i;
+
+    for (i = 0; i < state->cache_count; i++)
+    {
+        if (state->cache[i].code_d1 == d1 && state->cache[i].code_d2 == d2)
+            return state->cache[i].amplitude;
+    }
+
+    evaluation = &state->cache[state->cache_next];
+    evaluation->code_d1 = d1;
+    evaluation->code_d2 = d2;
+    evaluation->amplitude = state->measure(d1, d2, state->context);
+    state->cache_next = (state->cache_next + 1) % OPTIM2D_CACHE_SIZE;
+    if (state->cache_count < OPTIM2D_CACHE_SIZE)
+        state->cache_count++;
+
+    if (state->trace != NULL && state->trace->entries != NULL && state->trace->length < state->trace->capacity)
+        state->trace->entries[state->trace->length++] = *evaluation;
+
+    state->result->evaluations++;
+    if (state->result->evaluations == 1 || evaluation->amplitude < state->result->amplitude)
+    {
+        state->result->code_d1 = d1;
+        state->result->code_d2 = d2;
+        state->result->amplitude = evaluation->amplitude;
+    }
+    return evaluation->amplitude;
+}
+
+/**
+ * MINIMIZER_measure_callback for a line search along one axis.
+ */
+static float OPTIM2D_line_measure(uint16_t code, void *context)
+{
+    OPTIM2D_state *state = (OPTIM2D_state *)context;
+
+    if (state->line_axis == 0)
+        return OPTIM2D_evaluate(state, (float)code, (float)state->fixed_code);
+    return OPTIM2D_evaluate(state, (float)state->fixed_code, (float)code);
+}
+
+static uint16_t OPTIM2D_line_search(OPTIM2D_state *state, uint8_t axis, uint16_t center, uint16_t fixed_code,
+                                    uint16_t window)
+{
+    uint16_t lower_bound = (axis == 0) ? state->params->lower_d1 : state->params->lower_d2;
+    uint16_t upper_bound = (axis == 0) ? state->params->upper_d1 : state->params->upper_d2;
+    uint16_t lower = (center > lower_bound + window) ? center - window : lower_bound;
+    uint16_t upper = ((uint32_t)center + window < upper_bound) ? center + window : upper_bound;
+    MINIMIZER_result line_result;
+
+    state->line_axis = axis;
+    state->fixed_code = fixed_code;
+    MINIMIZER_search(MINIMIZER_BRENT, lower, upper, state->params->tolerance_lsb, OPTIM2D_line_measure, state,
+                     &line_result);
+    return line_result.code;
+}
+
+static void OPTIM2D_sequential(OPTIM2D_state *state)
+{
+    const OPTIM2D_params *params = state->params;
+    uint16_t d1 = OPTIM2D_line_search(state, 0, params->start_d1, params->start_d2, params->upper_d1 - params->lower_d1);
+
+    OPTIM2D_line_search(state, 1, params->start_d2, d1, params->upper_d2 - params->lower_d2);
+}
+
+static void OPTIM2D_coordinate_descent(OPTIM2D_state *state)
+{
+    const OPTIM2D_params *params = state->params;
+    uint16_t tolerance = (params->tolerance_lsb > 0) ? params->tolerance_lsb : 1;
+    uint16_t min_window = 4 * tolerance;
+    uint16_t window_d1 = (params->upper_d1 - params->lower_d1) / 2;
+    uint16_t window_d2 = (params->upper_d2 - params->lower_d2) / 2;
+    uint16_t d1 = params->start_d1;
+    uint16_t d2 = params->start_d2;
+    uint8_t sweep;
+
+    for (sweep = 0; sweep < OPTIM2D_MAX_SWEEPS; sweep++)
+    {
+        uint16_t new_d1 = OPTIM2D_line_search(state, 0, d1, d2, window_d1);
+        uint16_t new_d2 = OPTIM2D_line_search(state, 1, d2, new_d1, window_d2);
+        uint16_t move_d1 = (new_d1 > d1) ? new_d1 - d1 : d1 - new_d1;
+        uint16_t move_d2 = (new_d2 > d2) ? new_d2 - d2 : d2 - new_d2;
+
+        d1 = new_d1;
+        d2 = new_d2;
+
+        if (move_d1 <= tolerance && move_d2 <= tolerance && window_d1 <= min_window && window_d2 <= min_window)
+            break;
+
+        // the optimum of one axis only moves by a fraction of the move of the
+        // other one -> the next sweep only has to look around the last result
+        window_d1 = 2 * ((move_d1 > move_d2) ? move_d1 : move_d2);
+        if (window_d1 < min_window)
+            window_d1 = min_window;
+        window_d2 = window_d1;
+    }
+}
+
+/**
+ * Moves a simplex vertex into the search box. Vertices outside would be
+ * measured at the clamped codes, so the simplex could keep stretching along
+ * the edge without seeing any change and collapse there.
+ */
+static void OPTIM2D_limit(const OPTIM2D_params *params, float x[2])
+{
+    x[0] = fminf(fmaxf(x[0], (float)params->lower_d1), (float)params->upper_d1);
+    x[1] = fminf(fmaxf(x[1], (float)params->lower_d2), (float)params->upper_d2);
+}
+
+static float OPTIM2D_evaluate_vertex(OPTIM2D_state *state, float x[2])
+{
+    OPTIM2D_limit(state->params, x);
+    return OPTIM2D_evaluate(state, x[0], x[1]);
+}
+
+/**
+ * Right angled simplex at x[0], the legs point into the box.
+ */
+static void OPTIM2D_simplex_init(OPTIM2D_state *state, float x[3][2], float f[3], float step_d1, float step_d2)
+{
+    const OPTIM2D_params *params = state->params;
+    uint8_t i;
+
+    x[1][0] = (x[0][0] + step_d1 <= (float)params->upper_d1) ? x[0][0] + step_d1 : x[0][0] - step_d1;
+    x[1][1] = x[0][1];
+    x[2][0] = x[0][0];
+    x[2][1] = (x[0][1] + step_d2 <= (float)params->upper_d2) ? x[0][1] + step_d2 : x[0][1] - step_d2;
+    for (i = 0; i < 3; i++)
+        f[i] = OPTIM2D_evaluate_vertex(state, x[i]);
+}
+
+static void OPTIM2D_nelder_mead(OPTIM2D_state *state)
+{
+    const OPTIM2D_params *params = state->params;
+    float tolerance = (params->tolerance_lsb > 0) ? (float)params->tolerance_lsb : 1.0f;
+    float step_d1 = (float)(params->upper_d1 - params->lower_d1) / 8.0f;
+    float step_d2 = (float)(params->upper_d2 - params->lower_d2) / 8.0f;
+    uint8_t restarts = 0;
+    float x[3][2];
+    float f[3];
+    uint8_t i;
+
+    x[0][0] = params->start_d1;
+    x[0][1] = params->start_d2;
+    OPTIM2D_simplex_init(state, x, f, step_d1, step_d2);
+
+    while (state->result->evaluations < OPTIM2D_MAX_EVALUATIONS)
+    {
+        uint8_t best = 0, worst = 0, middle;
+        float centroid[2], xr[2], fr;
+        float size = 0.0f;
+        float area;
+
+        for (i = 1; i < 3; i++)
+        {
+            if (f[i] < f[best])
+                best = i;
+            if (f[i] > f[worst])
+                worst = i;
+        }
+        if (best == worst)
+            worst = (best + 1) % 3;
+        middle = 3 - best - worst;
+
+        for (i = 0; i < 3; i++)
+        {
+            size = fmaxf(size, fabsf(x[i][0] - x[best][0]));
+            size = fmaxf(size, fabsf(x[i][1] - x[best][1]));
+        }
+        area = fabsf((x[middle][0] - x[best][0]) * (x[worst][1] - x[best][1])
+                     - (x[middle][1] - x[best][1]) * (x[worst][0] - x[best][0]));
+
+        // converged when the simplex fits into the tolerance
+        if (size <= tolerance)
+            break;
+
+        // collapsed when its vertices lie on a line, typically stretched
+        // along the box edge away from the minimum: it can only search along
+        // that line, start again at the best point with a smaller simplex
+        if (area < OPTIM2D_COLLAPSED_RATIO * size * size)
+        {
+            if (restarts >= OPTIM2D_MAX_RESTARTS)
+                break;
+            restarts++;
+            step_d1 = fmaxf(step_d1 * OPTIM2D_RESTART_STEP, 2.0f * tolerance);
+            step_d2 = fmaxf(step_d2 * OPTIM2D_RESTART_STEP, 2.0f * tolerance);
+            x[0][0] = x[best][0];
+            x[0][1] = x[best][1];
+            OPTIM2D_simplex_init(state, x, f, step_d1, step_d2);
+            continue;
+        }
+
+        centroid[0] = 0.5f * (x[best][0] + x[middle][0]);
+        centroid[1] = 0.5f * (x[best][1] + x[middle][1]);
+
+        // reflection
+        xr[0] = 2.0f * centroid[0] - x[worst][0];
+        xr[1] = 2.0f * centroid[1] - x[worst][1];
+        fr = OPTIM2D_evaluate_vertex(state, xr);
+
+        if (fr < f[best])
+        {
+            // expansion
+            float xe[2] = {3.0f * centroid[0] - 2.0f * x[worst][0], 3.0f * centroid[1] - 2.0f * x[worst][1]};
+            float fe = OPTIM2D_evaluate_vertex(state, xe);
+
+            if (fe < fr)
+            {
+                x[worst][0] = xe[0];
+                x[worst][1] = xe[1];
+                f[worst] = fe;
+            }
+            else
+            {
+                x[worst][0] = xr[0];
+                x[worst][1] = xr[1];
+                f[worst] = fr;
+            }
+        }
+        else if (fr < f[middle])
+        {
+            x[worst][0] = xr[0];
+            x[worst][1] = xr[1];
+            f[worst] = fr;
+        }
+        else
+        {
+            // contraction, towards the better of reflected and worst point
+            float xc[2], fc;
+            bool outside = fr < f[worst];
+
+            if (outside)
+            {
+                xc[0] = centroid[0] + 0.5f * (xr[0] - centroid[0]);
+                xc[1] = centroid[1] + 0.5f * (xr[1] - centroid[1]);
+            }
+            else
+            {
+                xc[0] = centroid[0] + 0.5f * (x[worst][0] - centroid[0]);
+                xc[1] = centroid[1] + 0.5f * (x[worst][1] - centroid[1]);
+            }
+            fc = OPTIM2D_evaluate_vertex(state, xc);
+
+            if (fc < (outside ? fr : f[worst]))
+            {
+                x[worst][0] = xc[0];
+                x[worst][1] = xc[1];
+                f[worst] = fc;
+            }
+            else
+            {
+                // shrink towards the best vertex
+                for (i = 0; i < 3; i++)
+                {
+                    if (i == best)
+                        continue;
+                    x[i][0] = x[best][0] + 0.5f * (x[i][0] - x[best][0]);
+                    x[i][1] = x[best][1] + 0.5f * (x[i][1] - x[best][1]);
+                    f[i] = OPTIM2D_evaluate_vertex(state, x[i]);
+                }
+            }
+        }
+    }
+}
+
+// ###### functions
+
+/**
+ * Searches the (D1, D2) pair with the minimum notch amplitude.
+ * @param params: search box, start point and tolerance in DAC LSB
+ * @param measure: sets both DACs and returns the amplitude
+ * @param trace: optional, receives every evaluation in order
+ * @param result: best pair found and the number of evaluations used
+ */
+void OPTIM2D_search(OPTIM2D_method method, const OPTIM2D_params *params, OPTIM2D_measure_callback measure,
+                    void *context, OPTIM2D_trace *trace, OPTIM2D_result *result)
+{
+    OPTIM2D_state state = {0};
+
+    state.params = params;
+    state.measure = measure;
+    state.context = context;
+    state.trace = trace;
+    state.result = result;
+
+    result->code_d1 = params->start_d1;
+    result->code_d2 = params->start_d2;
+    result->amplitude = 0.0f;
+    result->evaluations = 0;
+    if (trace != NULL)
+        trace->length = 0;
+
+    switch (method)
+    {
+    case OPTIM2D_SEQUENTIAL:
+        OPTIM2D_sequential(&state);
+        break;
+    case OPTIM2D_COORDINATE_DESCENT:
+        OPTIM2D_coordinate_descent(&state);
+        break;
+    case OPTIM2D_NELDER_MEAD:
+        OPTIM2D_nelder_mead(&state);
+        break;
+    }
+}
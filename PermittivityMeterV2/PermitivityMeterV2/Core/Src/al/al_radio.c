@@ -0,0 +1,218 @@
+#include "al_radio.h"
+#include <string.h>
+#include "platform.h"
+#include "meas_config.h"
+#include "hal_serial.h"
+#include "mw_rf_handler.h"
+#include "mw_outbox.h"
+
+/*
+ * Duty cycle of the NINA module. Between sessions the module is held in
+ * reset with NINA_STOP set (RF_NINA_power_off(), the board has no supply
+ * switch for it) and
+ * the results collect in the flash outbox. A session starts when the outbox
+ * passes RADIO_WAKE_RECORDS results or its oldest result RADIO_WAKE_AGE_S,
+ * or when B1 is pressed, and ends once the outbox is empty, the peer is gone
+ * or nobody connected within RADIO_CONNECT_TIMEOUT_S. A module that does not
+ * boot ends the session as well, instead of the fatal error without the duty
+ * cycle: the measurements go on and the results wait in the outbox. After a
+ * session that did not empty the outbox the thresholds are ignored for
+ * RADIO_RETRY_PAUSE_S (only B1 starts one), nobody may be in range.
+ *
+ * The energy per session is not measured: the time in each state is
+ * weighted with the currents in meas_config.h.
+ */
+
+// ###### global variables
+
+static RADIO_state radio_state = RADIO_STATE_OFF;
+static uint32_t radio_state_since_ms = 0;
+static uint32_t radio_last_call_ms = 0;
+static bool radio_has_pending = false;
+static uint32_t radio_pending_since_ms = 0; // oldest pending result, as far as known
+static bool radio_is_retry_paused = false;
+static uint32_t radio_retry_after_ms = 0;
+static uint32_t radio_session_start_ms = 0;
+static uint32_t radio_sent_at_start = 0;
+static RADIO_session radio_session;
+static RADIO_statistics radio_statistics;
+
+// ###### private functions
+
+static void RADIO_set_state(RADIO_state state, uint32_t now_ms)
+{
+    radio_state = state;
+    radio_state_since_ms = now_ms;
+}
+
+static uint32_t RADIO_get_sent()
+{
+    OUTBOX_statistics statistics;
+
+    OUTBOX_get_statistics(&statistics);
+    return statistics.sent;
+}
+
+static void RADIO_start_session(RADIO_wake_reason reason, uint32_t now_ms)
+{
+    memset(&radio_session, 0, sizeof(radio_session));
+    radio_session.wake_reason = reason;
+    radio_session_start_ms = now_ms;
+    radio_sent_at_start = RADIO_get_sent();
+    RF_NINA_power_on();
+    RADIO_set_state(RADIO_STATE_BOOTING, now_ms);
+}
+
+static void RADIO_end_session(RADIO_end_reason reason, uint32_t now_ms)
+{
+    // the disconnect callback moves a partial result frame to the outbox
+    RF_NINA_power_off();
+
+    radio_session.end_reason = reason;
+    radio_session.on_ms = now_ms - radio_session_start_ms;
+    radio_session.records = RADIO_get_sent() - radio_sent_at_start;
+    radio_statistics.sessions++;
+    if (reason == RADIO_END_NO_PEER)
+        radio_statistics.failed_sessions++;
+    else if (reason == RADIO_END_BOOT_FAILED)
+        radio_statistics.boot_failures++;
+    radio_statistics.on_ms += radio_session.on_ms;
+    radio_statistics.boot_ms += radio_session.boot_ms;
+    radio_statistics.connect_ms += radio_session.connect_ms;
+    radio_statistics.energy_mj += radio_session.energy_mj;
+    radio_statistics.last = radio_session;
+
+    radio_is_retry_paused = OUTBOX_get_pending() > 0;
+    radio_retry_after_ms = now_ms + RADIO_RETRY_PAUSE_S * 1000u;
+    RADIO_set_state(RADIO_STATE_OFF, now_ms);
+}
+
+/**
+ * @return true if a session has to start, reason set
+ */
+static bool RADIO_is_wake_due(uint32_t now_ms, RADIO_wake_reason *reason)
+{
+    uint32_t pending = OUTBOX_get_pending();
+
+    if (PLATFORM_button_fetch_press())
+    {
+        *reason = RADIO_WAKE_BY_BUTTON;
+        return true;
+    }
+    if (radio_is_retry_paused && (int32_t)(now_ms - radio_retry_after_ms) < 0)
+        return false;
+    radio_is_retry_paused = false;
+
+    if (pending >= RADIO_WAKE_RECORDS)
+    {
+        *reason = RADIO_WAKE_BY_RECORDS;
+        return true;
+    }
+    if (pending > 0 && now_ms - radio_pending_since_ms >= RADIO_WAKE_AGE_S * 1000u)
+    {
+        *reason = RADIO_WAKE_BY_AGE;
+        return true;
+    }
+    return false;
+}
+
+// ###### functions
+
+/**
+ * After RF_init() and OUTBOX_init(): the module goes off until the first
+ * session. Results left in the outbox by an earlier run count as new.
+ */
+void RADIO_init()
+{
+    uint32_t now_ms = PLATFORM_get_tick_ms();
+
+    PLATFORM_button_init();
+    RF_NINA_power_off();
+    memset(&radio_statistics, 0, sizeof(radio_statistics));
+    radio_has_pending = OUTBOX_get_pending() > 0;
+    radio_pending_since_ms = now_ms;
+    radio_is_retry_paused = false;
+    radio_last_call_ms = now_ms;
+    RADIO_set_state(RADIO_STATE_OFF, now_ms);
+}
+
+/**
+ * Call it after RF_cyclic(), at least every few ms while the module is on.
+ */
+void RADIO_cyclic()
+{
+    uint32_t now_ms = PLATFORM_get_tick_ms();
+    uint32_t elapsed_ms = now_ms - radio_last_call_ms;
+    uint32_t state_ms = now_ms - radio_state_since_ms;
+    RADIO_wake_reason reason;
+    float current_ma;
+
+    radio_last_call_ms = now_ms;
+    if (OUTBOX_get_pending() == 0)
+        radio_has_pending = false;
+    else if (!radio_has_pending)
+    {
+        radio_has_pending = true;
+        radio_pending_since_ms = now_ms;
+    }
+
+    if (radio_state != RADIO_STATE_OFF)
+    {
+        current_ma = radio_state == RADIO_STATE_TRANSMITTING ? RADIO_CURRENT_TX_MA : RADIO_CURRENT_ON_MA;
+        radio_session.energy_mj += RADIO_SUPPLY_V * current_ma * (float)elapsed_ms * 1e-3f;
+        PLATFORM_button_fetch_press(); // nothing to start while on
+    }
+
+    switch (radio_state)
+    {
+    case RADIO_STATE_OFF:
+        if (RADIO_is_wake_due(now_ms, &reason))
+            RADIO_start_session(reason, now_ms);
+        break;
+    case RADIO_STATE_BOOTING:
+        // a module that does not boot is reset by mw_rf_handler.c, up to RF_MAX_REBOOTS times
+        if (RF_is_booted())
+        {
+            radio_session.boot_ms = state_ms;
+            RF_BT_enable();
+            RADIO_set_state(RADIO_STATE_CONNECTING, now_ms);
+        }
+        else if (RF_has_boot_failed())
+            RADIO_end_session(RADIO_END_BOOT_FAILED, now_ms);
+        break;
+    case RADIO_STATE_CONNECTING:
+        if (RF_is_peer_connected())
+        {
+            radio_session.connect_ms = state_ms;
+            RADIO_set_state(RADIO_STATE_TRANSMITTING, now_ms);
+        }
+        else if (state_ms >= RADIO_CONNECT_TIMEOUT_S * 1000u)
+            RADIO_end_session(RADIO_END_NO_PEER, now_ms);
+        break;
+    case RADIO_STATE_TRANSMITTING:
+        if (!RF_is_peer_connected())
+            RADIO_end_session(RADIO_END_PEER_LOST, now_ms);
+        else if (OUTBOX_get_pending() == 0 && !RF_is_transmitting_message_through_nina() && SERIAL_is_tx_idle())
+        {
+            radio_session.transmit_ms = state_ms;
+            RADIO_set_state(RADIO_STATE_LINGERING, now_ms);
+        }
+        break;
+    case RADIO_STATE_LINGERING:
+        if (!RF_is_peer_connected() || state_ms >= RADIO_LINGER_MS)
+            RADIO_end_session(RADIO_END_DONE, now_ms);
+        else if (OUTBOX_get_pending() > 0)
+            RADIO_set_state(RADIO_STATE_TRANSMITTING, now_ms);
+        break;
+    }
+}
+
+RADIO_state RADIO_get_state()
+{
+    return radio_state;
+}
+
+void RADIO_get_statistics(RADIO_statistics *statistics)
+{
+    *statistics = radio_statistics;
+}
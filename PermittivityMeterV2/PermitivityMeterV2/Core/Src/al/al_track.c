@@ -0,0 +1,186 @@
+#include "al_track.h"
+#include <math.h>
+#include <stddef.h>
+#include "meas_config.h"
+#include "al_tuning.h"
+#include "dsp_tone.h"
+
+/*
+ * Closed-loop notch tracking: after a search the varactor codes follow the
+ * notch block by block instead of searching again.
+ *
+ * Near the notch the alias tone phasor z = A e^(j phase) is linear in the
+ * code offsets of D1 and D2, z = S (u - u_notch), with a 2x2 slope S that
+ * TRACK_start() probes with one step of TRACK_PROBE_LSB per varactor. Every
+ * update then estimates the offset to the notch from one block,
+ * e = -S^-1 z, and moves the codes by a PI controller in velocity form:
+ *
+ *   u(k) = u(k-1) + TRACK_KP (e(k) - e(k-1)) + TRACK_KI e(k)
+ *
+ * The plant is static (the bias settles within TUNING_DAC_SETTLE_MS), so
+ * TRACK_KI = 1 would be a Newton step; less averages the noise of z.
+ *
+ * The phase is relative to the block start and only comparable while the
+ * ADC keeps running: the coherent alias sits at fs / 4 and a block holds
+ * whole periods. A sweep or an ACQ restart needs a new TRACK_start().
+ */
+
+// ###### defines
+
+// columns of S closer than this (sine of the angle between them) cannot be told apart
+#define TRACK_MIN_SLOPE_SINE 0.2f
+
+// ###### global variables
+
+static float track_codes[2];        // controller state, fractions of a code accumulate
+static float track_inverse[2][2];   // S^-1 [code per LSB]
+static float track_last_error[2];
+static float track_lock_amplitude;
+static uint8_t track_lost_count = 0;
+static bool track_is_locked = false;
+static TRACK_statistics track_statistics;
+
+// ###### private functions
+
+static float TRACK_clamp(float value, float lower, float upper)
+{
+    return value < lower ? lower : (value > upper ? upper : value);
+}
+
+static uint16_t TRACK_round_code(float code)
+{
+    return (uint16_t)lroundf(TRACK_clamp(code, TUNING_DAC_CODE_MIN, TUNING_DAC_CODE_MAX));
+}
+
+/**
+ * Phasor of the alias tone at the given codes.
+ */
+static void TRACK_measure(uint16_t code_d1, uint16_t code_d2, float z[2], float *amplitude)
+{
+    DSP_tone tone;
+
+    TUNING_measure_tone_2d(code_d1, code_d2, &tone);
+    z[0] = tone.amplitude * cosf(tone.phase);
+    z[1] = tone.amplitude * sinf(tone.phase);
+    if (amplitude != NULL)
+        *amplitude = tone.amplitude;
+}
+
+/**
+ * Probe step of TRACK_PROBE_LSB, downwards at the upper end of the DAC range.
+ */
+static int16_t TRACK_probe_step(uint16_t code)
+{
+    return (code + TRACK_PROBE_LSB <= TUNING_DAC_CODE_MAX) ? TRACK_PROBE_LSB : -TRACK_PROBE_LSB;
+}
+
+// ###### functions
+
+/**
+ * Probes the slope around the codes of a search and locks onto them.
+ * The DACs are left at the start codes.
+ * @param start: converged search result
+ * @return false if D1 and D2 move the phasor in (almost) the same direction,
+ *         the notch cannot be followed from here
+ */
+bool TRACK_start(const OPTIM2D_result *start)
+{
+    int16_t step_d1 = TRACK_probe_step(start->code_d1);
+    int16_t step_d2 = TRACK_probe_step(start->code_d2);
+    float z0[2], z1[2], z2[2];
+    float slope[2][2]; // [re/im][d1/d2], LSB per code
+    float determinant, amplitude;
+    uint8_t i;
+
+    track_statistics.identifications++;
+    track_is_locked = false;
+
+    TRACK_measure(start->code_d1, start->code_d2, z0, &amplitude);
+    TRACK_measure((uint16_t)(start->code_d1 + step_d1), start->code_d2, z1, NULL);
+    TRACK_measure(start->code_d1, (uint16_t)(start->code_d2 + step_d2), z2, NULL);
+    TUNING_set_dac(TUNING_VARACTOR_D1, start->code_d1);
+    TUNING_set_dac(TUNING_VARACTOR_D2, start->code_d2);
+
+    for (i = 0; i < 2; i++)
+    {
+        slope[i][0] = (z1[i] - z0[i]) / step_d1;
+        slope[i][1] = (z2[i] - z0[i]) / step_d2;
+    }
+    determinant = slope[0][0] * slope[1][1] - slope[0][1] * slope[1][0];
+    track_statistics.slope_determinant = determinant;
+    if (fabsf(determinant)
+        < TRACK_MIN_SLOPE_SINE * hypotf(slope[0][0], slope[1][0]) * hypotf(slope[0][1], slope[1][1]))
+        return false;
+
+    track_inverse[0][0] = slope[1][1] / determinant;
+    track_inverse[0][1] = -slope[0][1] / determinant;
+    track_inverse[1][0] = -slope[1][0] / determinant;
+    track_inverse[1][1] = slope[0][0] / determinant;
+
+    track_codes[0] = start->code_d1;
+    track_codes[1] = start->code_d2;
+    track_last_error[0] = 0.0f;
+    track_last_error[1] = 0.0f;
+    track_lock_amplitude = fmaxf(fmaxf(start->amplitude, amplitude), TRACK_LOST_MIN_LSB);
+    track_lost_count = 0;
+    track_statistics.updates = 0;
+    track_is_locked = true;
+    return true;
+}
+
+/**
+ * One controller step: measures one block at the current codes and moves
+ * the DACs towards the notch.
+ * @param result: codes the block was measured at and its amplitude,
+ *                evaluations = updates since TRACK_start()
+ * @return false once the lock is lost, a new search is needed
+ */
+bool TRACK_update(OPTIM2D_result *result)
+{
+    uint16_t code_d1 = TRACK_round_code(track_codes[0]);
+    uint16_t code_d2 = TRACK_round_code(track_codes[1]);
+    float z[2];
+    uint8_t i;
+
+    if (!track_is_locked)
+        return false;
+
+    TRACK_measure(code_d1, code_d2, z, &result->amplitude);
+    result->code_d1 = code_d1;
+    result->code_d2 = code_d2;
+    track_statistics.updates++;
+    result->evaluations = (uint16_t)(track_statistics.updates > UINT16_MAX ? UINT16_MAX : track_statistics.updates);
+
+    // the notch may have jumped further than the linear range, a few steps to catch up
+    track_lost_count = (result->amplitude > track_lock_amplitude * TRACK_LOST_RATIO) ? track_lost_count + 1 : 0;
+    if (track_lost_count >= TRACK_LOST_UPDATES)
+    {
+        track_is_locked = false;
+        track_statistics.losses++;
+        return false;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        float error = -(track_inverse[i][0] * z[0] + track_inverse[i][1] * z[1]);
+        float step = TRACK_KP * (error - track_last_error[i]) + TRACK_KI * error;
+
+        track_codes[i] += TRACK_clamp(step, -TRACK_MAX_STEP_LSB, TRACK_MAX_STEP_LSB);
+        track_codes[i] = TRACK_clamp(track_codes[i], TUNING_DAC_CODE_MIN, TUNING_DAC_CODE_MAX);
+        track_last_error[i] = error;
+    }
+    // the bias settles while the caller serves the link
+    TUNING_set_dac(TUNING_VARACTOR_D1, TRACK_round_code(track_codes[0]));
+    TUNING_set_dac(TUNING_VARACTOR_D2, TRACK_round_code(track_codes[1]));
+    return true;
+}
+
+bool TRACK_is_locked()
+{
+    return track_is_locked;
+}
+
+void TRACK_get_statistics(TRACK_statistics *statistics)
+{
+    *statistics = track_statistics;
+}
@@ -0,0 +1,704 @@
+#include "al_tuning.h"
+#include <math.h>
+#include <stddef.h>
+#include "platform.h"
+#include "meas_config.h"
+#include "hal_acq.h"
+#include "dsp_tone.h"
+#include "dsp_goertzel.h"
+#include "dsp_lockin.h"
+#include "dsp_sdft.h"
+#include "hal_sweep.h"
+#include "hal_gain.h"
+#include "al_warmstart.h"
+
+/*
+ * Glue between the varactor DACs, the acquisition and the minimizers.
+ * One evaluation = set DAC, let the bias settle and measure the alias tone
+ * with the sliding DFT over the samples after it (TUNING_SDFT_WINDOW), or
+ * drop the block that was sampled during the step and measure the next one.
+ */
+
+// ###### defines
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TUNING_BLOCK_TIMEOUT_MS 50
+#define TUNING_BLOCK_ATTEMPTS 3
+#define TUNING_SETTLE_SAMPLES ((uint32_t)(TUNING_DAC_SETTLE_MS * ACQ_SAMPLE_RATE_HZ / 1000.0f))
+
+// refinement of the coarse notch position, see TUNING_refine_phase()
+#define TUNING_NEWTON_STEPS 2
+#define TUNING_NEWTON_DELTA_LSB 16 // code difference for the slopes of the phasor
+
+#define TUNING_SWEEP_STEPS_PER_BLOCK (ACQ_BLOCK_SIZE / TUNING_SWEEP_SAMPLES_PER_STEP)
+#define TUNING_SWEEP_WINDOW (TUNING_SWEEP_SAMPLES_PER_STEP - TUNING_SWEEP_SETTLE_SAMPLES)
+// alias bin inside the measured part of a step
+#define TUNING_SWEEP_BIN (ACQ_ALIAS_BIN * TUNING_SWEEP_WINDOW / ACQ_BLOCK_SIZE)
+
+_Static_assert(ACQ_BLOCK_SIZE % TUNING_SWEEP_SAMPLES_PER_STEP == 0, "sweep steps must not cross block borders");
+_Static_assert(ACQ_ALIAS_BIN * TUNING_SWEEP_WINDOW % ACQ_BLOCK_SIZE == 0,
+               "measured part of a sweep step is not coherent with the alias tone");
+_Static_assert(TUNING_SWEEP_POINTS >= 3 && TUNING_SWEEP_POINTS <= 255, "TUNING_SWEEP_POINTS out of range");
+
+// ###### global variables
+
+#if ACQ_COHERENT_SAMPLING
+static uint16_t tuning_sweep_codes[TUNING_SWEEP_POINTS];
+#endif
+
+static uint16_t tuning_dac_codes[2] = {0, 0};
+static DSP_lockin tuning_lockin;
+#if TUNING_SDFT_WINDOW > 0
+static DSP_sdft tuning_sdft;
+#endif
+static uint16_t tuning_overwritten_count = 0;
+
+// ###### private functions
+
+static uint16_t TUNING_box_lower(uint16_t center, uint16_t half_width)
+{
+    return (center > TUNING_DAC_CODE_MIN + half_width) ? center - half_width : TUNING_DAC_CODE_MIN;
+}
+
+static uint16_t TUNING_box_upper(uint16_t center, uint16_t half_width)
+{
+    return ((uint32_t)center + half_width < TUNING_DAC_CODE_MAX) ? center + half_width : TUNING_DAC_CODE_MAX;
+}
+
+/**
+ * A minimum on the edge of the search box (that is not the DAC limit) means
+ * the notch lies outside of it. Nelder-Mead stops a few tolerances short of
+ * an edge it is pushed against.
+ */
+static bool TUNING_is_on_box_edge(const OPTIM2D_params *params, const OPTIM2D_result *result)
+{
+    uint16_t margin = 4 * TUNING_TOLERANCE_LSB;
+
+    return (params->lower_d1 > TUNING_DAC_CODE_MIN && result->code_d1 <= params->lower_d1 + margin)
+           || (params->upper_d1 < TUNING_DAC_CODE_MAX && result->code_d1 + margin >= params->upper_d1)
+           || (params->lower_d2 > TUNING_DAC_CODE_MIN && result->code_d2 <= params->lower_d2 + margin)
+           || (params->upper_d2 < TUNING_DAC_CODE_MAX && result->code_d2 + margin >= params->upper_d2);
+}
+
+/**
+ * Nelder-Mead in a box around the given codes. While the minimum ends up on
+ * the box edge, the search continues around the best pair so far with a box
+ * twice as large, at most TUNING_WARM_MAX_WIDENINGS times.
+ * @param widenings: incremented for every enlarged box
+ * @return false if the minimum is still on the edge of the largest box
+ */
+static bool TUNING_search_box(uint16_t code_d1, uint16_t code_d2, uint16_t half_width, OPTIM2D_result *result,
+                              TUNING_telemetry *telemetry, uint8_t *widenings)
+{
+    OPTIM2D_params params;
+    uint8_t i;
+
+    params.tolerance_lsb = TUNING_TOLERANCE_LSB;
+
+    for (i = 0; i <= TUNING_WARM_MAX_WIDENINGS; i++)
+    {
+        params.lower_d1 = TUNING_box_lower(code_d1, half_width);
+        params.upper_d1 = TUNING_box_upper(code_d1, half_width);
+        params.lower_d2 = TUNING_box_lower(code_d2, half_width);
+        params.upper_d2 = TUNING_box_upper(code_d2, half_width);
+        params.start_d1 = code_d1;
+        params.start_d2 = code_d2;
+
+        OPTIM2D_search(OPTIM2D_NELDER_MEAD, &params, TUNING_measure_amplitude_2d, NULL, NULL, result);
+        telemetry->evaluations += result->evaluations;
+
+        if (!TUNING_is_on_box_edge(&params, result))
+            return true;
+
+        code_d1 = result->code_d1;
+        code_d2 = result->code_d2;
+        half_width *= 2;
+        (*widenings)++;
+    }
+    return false;
+}
+
+/**
+ * Coarse notch position from two hardware sweeps (see TUNING_sweep()): D1
+ * over the whole range with D2 in the middle, then D2 over the whole range at
+ * the coarse D1 minimum.
+ * @param half_width: two steps of the coarse curves, D1 and D2 interact, so
+ *                    the notch can lie beyond the neighbours of the minima
+ * @return false if the sweep is not available or a curve is incomplete
+ */
+static bool TUNING_locate_coarse(uint16_t *code_d1, uint16_t *code_d2, uint16_t *half_width)
+{
+    TUNING_curve curve;
+
+    TUNING_set_dac(TUNING_VARACTOR_D2, (TUNING_DAC_CODE_MIN + TUNING_DAC_CODE_MAX) / 2);
+    PLATFORM_delay_ms(TUNING_DAC_SETTLE_MS);
+    if (!TUNING_sweep(TUNING_VARACTOR_D1, TUNING_DAC_CODE_MIN, TUNING_DAC_CODE_MAX, &curve))
+        return false;
+    *code_d1 = TUNING_get_dac(TUNING_VARACTOR_D1);
+
+    PLATFORM_delay_ms(TUNING_DAC_SETTLE_MS);
+    if (!TUNING_sweep(TUNING_VARACTOR_D2, TUNING_DAC_CODE_MIN, TUNING_DAC_CODE_MAX, &curve))
+        return false;
+    *code_d2 = TUNING_get_dac(TUNING_VARACTOR_D2);
+
+    *half_width = 2 * curve.code_step;
+    return true;
+}
+
+// ###### functions
+
+/**
+ * Sets up the sliding DFT of the tone measurement, before the first search.
+ */
+void TUNING_init()
+{
+#if TUNING_SDFT_WINDOW > 0
+    if (!DSP_sdft_init(&tuning_sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, TUNING_SDFT_WINDOW))
+        PLATFORM_fatal_error();
+#endif
+}
+
+void TUNING_set_dac(TUNING_varactor varactor, uint16_t code)
+{
+    PLATFORM_dac_write((uint8_t)varactor, code);
+    tuning_dac_codes[varactor] = code;
+}
+
+uint16_t TUNING_get_dac(TUNING_varactor varactor)
+{
+    return tuning_dac_codes[varactor];
+}
+
+#if TUNING_SDFT_WINDOW > 0
+/**
+ * Pushes the DMA blocks into the sliding DFT from TUNING_SETTLE_SAMPLES after
+ * the DAC step on, the tone is read at the end of the first block that
+ * completes the window. The window ends on a block border and holds whole
+ * periods, so the phase is the same as that of a whole block.
+ * @param step: ACQ_get_sample_index() right after the DAC write
+ * @return false if the blocks were overwritten or lost every time
+ */
+static bool TUNING_measure_sliding(uint32_t step, DSP_tone *tone)
+{
+    uint32_t first = step + TUNING_SETTLE_SAMPLES;
+    uint8_t attempts = 0;
+    ACQ_block block;
+
+    DSP_sdft_reset(&tuning_sdft);
+    while (attempts < TUNING_BLOCK_ATTEMPTS)
+    {
+        uint32_t start;
+        bool is_valid = false;
+
+        if (!ACQ_wait_block(&block, TUNING_BLOCK_TIMEOUT_MS))
+            PLATFORM_fatal_error();
+        start = (block.sequence - 1) * ACQ_BLOCK_SIZE;
+
+        if (start > first + tuning_sdft.samples)
+        {
+            // a block was lost, the window restarts with this one
+            DSP_sdft_reset(&tuning_sdft);
+            first = start;
+            attempts++;
+        }
+        if (start + block.length > first)
+        {
+            uint32_t offset = (first > start) ? first - start : 0;
+
+            DSP_sdft_push(&tuning_sdft, &block.samples[offset], (uint16_t)(block.length - offset));
+            is_valid = DSP_sdft_is_valid(&tuning_sdft);
+            if (is_valid)
+                DSP_sdft_get_tone(&tuning_sdft, tone);
+        }
+
+        if (!ACQ_release_block())
+        {
+            DSP_sdft_reset(&tuning_sdft);
+            first = start + block.length;
+            attempts++;
+        }
+        else if (is_valid)
+        {
+            return true;
+        }
+    }
+
+    tuning_overwritten_count++;
+    return false;
+}
+#endif
+
+/**
+ * Measures the alias tone after a DAC step, with the sliding DFT if
+ * TUNING_SDFT_WINDOW is set. A block the DMA wrote into while it was
+ * processed is measured again, up to TUNING_BLOCK_ATTEMPTS times.
+ * @param tone: amplitude in LSB and phase of the alias tone
+ * @param lockin_result: if not NULL, the block is demodulated with the tuning
+ *                       lock-in instead of DSP_tone_measure()
+ * @return false if every block was overwritten, the result comes from a
+ *         corrupted block then (counted, see TUNING_get_overwritten_count())
+ */
+static bool TUNING_measure_after_step(DSP_tone *tone, DSP_lockin_result *lockin_result)
+{
+    ACQ_block block;
+    uint8_t attempts;
+
+    tone->amplitude = 0.0f;
+    tone->phase = 0.0f;
+
+#if TUNING_SDFT_WINDOW > 0
+    if (lockin_result == NULL)
+    {
+        if (!ACQ_is_running())
+            ACQ_start();
+        return TUNING_measure_sliding(ACQ_get_sample_index(), tone);
+    }
+#endif
+
+    PLATFORM_delay_ms(TUNING_DAC_SETTLE_MS);
+
+    if (!ACQ_is_running())
+        ACQ_start();
+
+    // the block in flight was (partly) sampled before the step -> drop it
+    if (ACQ_wait_block(&block, TUNING_BLOCK_TIMEOUT_MS))
+        ACQ_release_block();
+
+    for (attempts = 0; attempts < TUNING_BLOCK_ATTEMPTS; attempts++)
+    {
+        if (!ACQ_wait_block(&block, TUNING_BLOCK_TIMEOUT_MS))
+            PLATFORM_fatal_error();
+        if (lockin_result != NULL)
+        {
+            DSP_lockin_process(&tuning_lockin, block.samples, block.length, lockin_result);
+            tone->amplitude = lockin_result->magnitude;
+            tone->phase = lockin_result->phase;
+        }
+        else
+        {
+            DSP_tone_measure(block.samples, block.length, tone);
+        }
+        if (ACQ_release_block())
+            return true;
+    }
+
+    tuning_overwritten_count++;
+    return false;
+}
+
+/**
+ * MINIMIZER_measure_callback for the varactor given by context.
+ * @param code: DAC code to measure at
+ * @param context: pointer to a TUNING_varactor
+ * @return amplitude of the alias tone in LSB
+ */
+float TUNING_measure_amplitude(uint16_t code, void *context)
+{
+    TUNING_varactor varactor = *(TUNING_varactor *)context;
+    DSP_tone tone;
+
+    TUNING_set_dac(varactor, code);
+    TUNING_measure_after_step(&tone, NULL);
+    return tone.amplitude;
+}
+
+/**
+ * OPTIM2D_measure_callback, sets both varactors. context is unused.
+ */
+float TUNING_measure_amplitude_2d(uint16_t code_d1, uint16_t code_d2, void *context)
+{
+    DSP_tone tone;
+
+    (void)context;
+    TUNING_measure_tone_2d(code_d1, code_d2, &tone);
+    return tone.amplitude;
+}
+
+/**
+ * Sets both varactors and measures amplitude and phase of the alias tone.
+ * The phase is only comparable between measurements while the ADC keeps
+ * running (coherent sampling, blocks of whole periods).
+ * @return false if the tone comes from an overwritten block
+ */
+bool TUNING_measure_tone_2d(uint16_t code_d1, uint16_t code_d2, DSP_tone *tone)
+{
+    TUNING_set_dac(TUNING_VARACTOR_D1, code_d1);
+    TUNING_set_dac(TUNING_VARACTOR_D2, code_d2);
+    return TUNING_measure_after_step(tone, NULL);
+}
+
+/**
+ * @return measurements that only got overwritten blocks (see
+ *         TUNING_measure_after_step()), the callbacks of the minimizers can
+ *         not report them
+ */
+uint16_t TUNING_get_overwritten_count()
+{
+    return tuning_overwritten_count;
+}
+
+void TUNING_reset_overwritten_count()
+{
+    tuning_overwritten_count = 0;
+}
+
+/**
+ * Searches the notch minimum with one varactor, the other one is left as is.
+ * The DAC is left at the best code found.
+ */
+void TUNING_search(TUNING_varactor varactor, MINIMIZER_method method, uint16_t lower, uint16_t upper,
+                   MINIMIZER_result *result)
+{
+    MINIMIZER_search(method, lower, upper, TUNING_TOLERANCE_LSB, TUNING_measure_amplitude, &varactor, result);
+    TUNING_set_dac(varactor, result->code);
+}
+
+/**
+ * Bisection on the side of the notch given by the lock-in phase, one varactor,
+ * the other one is left as is. Near the notch the tone phasor moves on a
+ * nearly straight line z = s * code + c, so the amplitude falls towards the
+ * minimum where z is perpendicular to the line. With the lock-in reference
+ * perpendicular to the chord between both bracket ends, the sign of the
+ * signed phase is the sign of the amplitude slope: +1 = minimum below the
+ * code. Needs about log2((upper - lower) / tolerance) + 2 evaluations and no
+ * amplitude comparisons, which fail in the noise close to the minimum.
+ * The ADC must keep running during the search, the DAC is left at the best
+ * code found.
+ */
+void TUNING_search_phase(TUNING_varactor varactor, uint16_t lower, uint16_t upper, MINIMIZER_result *result)
+{
+    DSP_lockin_result lower_result, upper_result, middle_result;
+    DSP_tone tone;
+
+    if (!DSP_lockin_init(&tuning_lockin, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, 0))
+        PLATFORM_fatal_error();
+
+    TUNING_set_dac(varactor, lower);
+    TUNING_measure_after_step(&tone, &lower_result);
+    TUNING_set_dac(varactor, upper);
+    TUNING_measure_after_step(&tone, &upper_result);
+    result->evaluations = 2;
+
+    while (upper - lower > TUNING_TOLERANCE_LSB)
+    {
+        uint16_t middle = lower + (upper - lower) / 2;
+        float chord_re = upper_result.magnitude * cosf(upper_result.phase)
+                         - lower_result.magnitude * cosf(lower_result.phase);
+        float chord_im = upper_result.magnitude * sinf(upper_result.phase)
+                         - lower_result.magnitude * sinf(lower_result.phase);
+
+        DSP_lockin_set_reference(&tuning_lockin, atan2f(chord_im, chord_re) - 0.5f * (float)M_PI);
+        TUNING_set_dac(varactor, middle);
+        TUNING_measure_after_step(&tone, &middle_result);
+        result->evaluations++;
+
+        if (DSP_lockin_notch_side(&middle_result) > 0)
+        {
+            upper = middle;
+            upper_result = middle_result;
+        }
+        else
+        {
+            lower = middle;
+            lower_result = middle_result;
+        }
+    }
+
+    if (lower_result.magnitude <= upper_result.magnitude)
+    {
+        result->code = lower;
+        result->amplitude = lower_result.magnitude;
+    }
+    else
+    {
+        result->code = upper;
+        result->amplitude = upper_result.magnitude;
+    }
+    TUNING_set_dac(varactor, result->code);
+}
+
+/**
+ * Lock-in phasor of the alias tone with both varactors set.
+ */
+static void TUNING_measure_phasor(uint16_t code_d1, uint16_t code_d2, float *re, float *im)
+{
+    DSP_lockin_result lockin_result;
+    DSP_tone tone;
+
+    TUNING_set_dac(TUNING_VARACTOR_D1, code_d1);
+    TUNING_set_dac(TUNING_VARACTOR_D2, code_d2);
+    TUNING_measure_after_step(&tone, &lockin_result);
+    *re = lockin_result.magnitude * cosf(lockin_result.phase);
+    *im = lockin_result.magnitude * sinf(lockin_result.phase);
+}
+
+/**
+ * Newton step on the tone phasor: near the notch z = a * d1 + b * d2 + c with
+ * complex a and b, which have different directions because D1 tunes the
+ * frequency and D2 the depth. Both slopes are measured TUNING_NEWTON_DELTA_LSB
+ * away, the step goes to z = 0 (clamped to the DAC range). 3 evaluations.
+ */
+static void TUNING_step_newton(uint16_t *code_d1, uint16_t *code_d2, TUNING_telemetry *telemetry)
+{
+    uint16_t near_d1 = (*code_d1 + TUNING_NEWTON_DELTA_LSB <= TUNING_DAC_CODE_MAX)
+                           ? *code_d1 + TUNING_NEWTON_DELTA_LSB : *code_d1 - TUNING_NEWTON_DELTA_LSB;
+    uint16_t near_d2 = (*code_d2 + TUNING_NEWTON_DELTA_LSB <= TUNING_DAC_CODE_MAX)
+                           ? *code_d2 + TUNING_NEWTON_DELTA_LSB : *code_d2 - TUNING_NEWTON_DELTA_LSB;
+    float z_re, z_im, a_re, a_im, b_re, b_im;
+    float determinant, next_d1, next_d2;
+
+    if (!DSP_lockin_init(&tuning_lockin, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, 0))
+        PLATFORM_fatal_error();
+    TUNING_measure_phasor(*code_d1, *code_d2, &z_re, &z_im);
+    TUNING_measure_phasor(near_d1, *code_d2, &a_re, &a_im);
+    TUNING_measure_phasor(*code_d1, near_d2, &b_re, &b_im);
+    telemetry->evaluations += 3;
+
+    a_re = (a_re - z_re) / ((float)near_d1 - (float)*code_d1);
+    a_im = (a_im - z_im) / ((float)near_d1 - (float)*code_d1);
+    b_re = (b_re - z_re) / ((float)near_d2 - (float)*code_d2);
+    b_im = (b_im - z_im) / ((float)near_d2 - (float)*code_d2);
+
+    // a * dx1 + b * dx2 = -z, real and imaginary part
+    determinant = a_re * b_im - a_im * b_re;
+    if (determinant == 0.0f)
+        return;
+    next_d1 = (float)*code_d1 + (b_re * z_im - b_im * z_re) / determinant;
+    next_d2 = (float)*code_d2 + (a_im * z_re - a_re * z_im) / determinant;
+
+    *code_d1 = (uint16_t)lroundf(fminf(fmaxf(next_d1, TUNING_DAC_CODE_MIN), TUNING_DAC_CODE_MAX));
+    *code_d2 = (uint16_t)lroundf(fminf(fmaxf(next_d2, TUNING_DAC_CODE_MIN), TUNING_DAC_CODE_MAX));
+}
+
+/**
+ * Phase bisection of D1, then D2, each in +-half_width around the codes.
+ */
+static void TUNING_bisect_both(uint16_t *code_d1, uint16_t *code_d2, uint16_t half_width,
+                               TUNING_telemetry *telemetry, MINIMIZER_result *line)
+{
+    TUNING_set_dac(TUNING_VARACTOR_D2, *code_d2);
+    TUNING_search_phase(TUNING_VARACTOR_D1, TUNING_box_lower(*code_d1, half_width),
+                        TUNING_box_upper(*code_d1, half_width), line);
+    telemetry->evaluations += line->evaluations;
+    *code_d1 = line->code;
+
+    TUNING_search_phase(TUNING_VARACTOR_D2, TUNING_box_lower(*code_d2, half_width),
+                        TUNING_box_upper(*code_d2, half_width), line);
+    telemetry->evaluations += line->evaluations;
+    *code_d2 = line->code;
+}
+
+/**
+ * From the coarse notch position to the minimum with the lock-in phasor
+ * instead of amplitude comparisons: phase bisections over the coarse bracket
+ * bring it into the region where the phasor is linear in both codes, Newton
+ * steps follow the coupling of D1 and D2 to the zero, and short bisections
+ * finish at the amplitude minimum.
+ */
+static void TUNING_refine_phase(uint16_t code_d1, uint16_t code_d2, uint16_t half_width, OPTIM2D_result *result,
+                                TUNING_telemetry *telemetry)
+{
+    uint16_t evaluations = telemetry->evaluations;
+    MINIMIZER_result line;
+    uint8_t step;
+
+    TUNING_bisect_both(&code_d1, &code_d2, half_width, telemetry, &line);
+    for (step = 0; step < TUNING_NEWTON_STEPS; step++)
+        TUNING_step_newton(&code_d1, &code_d2, telemetry);
+
+    TUNING_bisect_both(&code_d1, &code_d2, TUNING_NEWTON_DELTA_LSB, telemetry, &line);
+    TUNING_bisect_both(&code_d1, &code_d2, TUNING_NEWTON_DELTA_LSB / 4, telemetry, &line);
+
+    result->code_d1 = code_d1;
+    result->code_d2 = code_d2;
+    result->amplitude = line.amplitude;
+    result->evaluations = telemetry->evaluations - evaluations;
+}
+
+/**
+ * Searches D1 and D2 together, starting at the current DAC codes.
+ * Both DACs are left at the best pair found.
+ * @param trace: optional evaluation trace, may be NULL
+ */
+void TUNING_search_2d(OPTIM2D_method method, OPTIM2D_trace *trace, OPTIM2D_result *result)
+{
+    OPTIM2D_params params = {
+        .lower_d1 = TUNING_DAC_CODE_MIN,
+        .upper_d1 = TUNING_DAC_CODE_MAX,
+        .lower_d2 = TUNING_DAC_CODE_MIN,
+        .upper_d2 = TUNING_DAC_CODE_MAX,
+        .start_d1 = tuning_dac_codes[TUNING_VARACTOR_D1],
+        .start_d2 = tuning_dac_codes[TUNING_VARACTOR_D2],
+        .tolerance_lsb = TUNING_TOLERANCE_LSB,
+    };
+
+    OPTIM2D_search(method, &params, TUNING_measure_amplitude_2d, NULL, trace, result);
+    TUNING_set_dac(TUNING_VARACTOR_D1, result->code_d1);
+    TUNING_set_dac(TUNING_VARACTOR_D2, result->code_d2);
+}
+
+/**
+ * Captures a coarse amplitude curve of one varactor in a single hardware sweep
+ * (see hal_sweep.c), TUNING_SWEEP_POINTS equidistant codes from lower to upper.
+ * The DAC is left at the coarse minimum.
+ * @return false if a block was lost or overwritten, the curve is incomplete then
+ */
+bool TUNING_sweep(TUNING_varactor varactor, uint16_t lower, uint16_t upper, TUNING_curve *curve)
+{
+#if ACQ_COHERENT_SAMPLING
+    DSP_goertzel goertzel;
+    ACQ_block block;
+    DSP_tone tone;
+    uint8_t point = 0;
+    bool complete = true;
+    uint8_t i;
+
+    curve->code_start = lower;
+    curve->code_step = (upper > lower) ? (upper - lower) / (TUNING_SWEEP_POINTS - 1) : 0;
+    curve->length = 0;
+    curve->min_index = 0;
+
+    for (i = 0; i < TUNING_SWEEP_POINTS; i++)
+        tuning_sweep_codes[i] = lower + i * curve->code_step;
+
+    if (!DSP_goertzel_init(&goertzel, TUNING_SWEEP_BIN, TUNING_SWEEP_WINDOW))
+        PLATFORM_fatal_error();
+    SWEEP_start((uint8_t)varactor, tuning_sweep_codes, TUNING_SWEEP_POINTS);
+
+    while (point < TUNING_SWEEP_POINTS)
+    {
+        if (!ACQ_wait_block(&block, TUNING_BLOCK_TIMEOUT_MS))
+            PLATFORM_fatal_error();
+        // sequence numbers start at 1 with the first sample of step 0
+        if (block.sequence != (uint32_t)point / TUNING_SWEEP_STEPS_PER_BLOCK + 1)
+        {
+            ACQ_release_block();
+            complete = false;
+            break;
+        }
+
+        for (i = 0; i < TUNING_SWEEP_STEPS_PER_BLOCK && point < TUNING_SWEEP_POINTS; i++, point++)
+        {
+            DSP_goertzel_process(&goertzel,
+                                 &block.samples[i * TUNING_SWEEP_SAMPLES_PER_STEP + TUNING_SWEEP_SETTLE_SAMPLES], &tone);
+            curve->amplitudes[point] = tone.amplitude;
+            if (tone.amplitude < curve->amplitudes[curve->min_index])
+                curve->min_index = point;
+        }
+
+        if (!ACQ_release_block())
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    SWEEP_stop();
+    curve->length = point;
+    TUNING_set_dac(varactor, tuning_sweep_codes[curve->min_index]);
+    return complete;
+#else
+    (void)varactor;
+    (void)lower;
+    (void)upper;
+    curve->length = 0;
+    return false;
+#endif
+}
+
+/**
+ * Code range around the minimum of a curve that still brackets the notch:
+ * the neighbours of the lowest point.
+ */
+void TUNING_curve_bracket(const TUNING_curve *curve, uint16_t *lower, uint16_t *upper)
+{
+    uint8_t first = (curve->min_index > 0) ? curve->min_index - 1 : 0;
+    uint8_t last = (curve->min_index + 1 < curve->length) ? curve->min_index + 1 : curve->min_index;
+
+    *lower = curve->code_start + first * curve->code_step;
+    *upper = curve->code_start + last * curve->code_step;
+}
+
+/**
+ * Full search with warm start.
+ * If a converged point of a recent measurement is stored, the search
+ * starts in a small box around it and only widens when the minimum ends up on
+ * the box edge. Otherwise (or after too many widenings) two hardware sweeps
+ * locate the notch coarsely and the lock-in phase leads from there to the
+ * minimum (see TUNING_refine_phase()). Only if the sweep is not available,
+ * the whole DAC range is searched. The converged point is stored for the
+ * next measurement.
+ * @param timestamp_s: time of this measurement, ages the stored point and is stored with the new one
+ * @param telemetry: warm/cold, evaluations, overwritten blocks and duration of
+ *                   the search
+ */
+void TUNING_search_auto(uint32_t timestamp_s, OPTIM2D_result *result, TUNING_telemetry *telemetry)
+{
+    uint32_t start_tick = PLATFORM_get_tick_ms();
+    WARMSTART_point point;
+    uint16_t code_d1, code_d2, half_width;
+    bool converged = false;
+
+    telemetry->warm_start = false;
+    telemetry->widenings = 0;
+    telemetry->evaluations = 0;
+    TUNING_reset_overwritten_count();
+
+    if (WARMSTART_load(&point, timestamp_s))
+    {
+        float amplitude;
+
+        telemetry->warm_start = true;
+        GAIN_set((GAIN_setting)point.gain);
+
+        amplitude = TUNING_measure_amplitude_2d(point.code_d1, point.code_d2, NULL);
+        telemetry->evaluations++;
+        half_width = TUNING_WARM_BRACKET_LSB;
+        if (amplitude > point.amplitude * TUNING_WARM_MOVED_RATIO)
+            half_width *= 4; // notch clearly moved, skip the smallest boxes
+
+        // widenings > TUNING_WARM_MAX_WIDENINGS afterwards = cold fallback
+        converged = TUNING_search_box(point.code_d1, point.code_d2, half_width, result, telemetry,
+                                      &telemetry->widenings);
+    }
+
+    if (!converged && TUNING_locate_coarse(&code_d1, &code_d2, &half_width))
+    {
+        TUNING_refine_phase(code_d1, code_d2, half_width, result, telemetry);
+        converged = true;
+    }
+
+    if (!converged)
+    {
+        OPTIM2D_params params = {
+            .lower_d1 = TUNING_DAC_CODE_MIN,
+            .upper_d1 = TUNING_DAC_CODE_MAX,
+            .lower_d2 = TUNING_DAC_CODE_MIN,
+            .upper_d2 = TUNING_DAC_CODE_MAX,
+            .start_d1 = (TUNING_DAC_CODE_MIN + TUNING_DAC_CODE_MAX) / 2,
+            .start_d2 = (TUNING_DAC_CODE_MIN + TUNING_DAC_CODE_MAX) / 2,
+            .tolerance_lsb = TUNING_TOLERANCE_LSB,
+        };
+
+        // over the whole range coordinate descent is the more robust one, its
+        // line searches bracket the notch on each axis
+        OPTIM2D_search(OPTIM2D_COORDINATE_DESCENT, &params, TUNING_measure_amplitude_2d, NULL, NULL, result);
+        telemetry->evaluations += result->evaluations;
+    }
+
+    TUNING_set_dac(TUNING_VARACTOR_D1, result->code_d1);
+    TUNING_set_dac(TUNING_VARACTOR_D2, result->code_d2);
+
+    point.code_d1 = result->code_d1;
+    point.code_d2 = result->code_d2;
+    point.gain = (uint8_t)GAIN_get();
+    point.amplitude = result->amplitude;
+    point.timestamp_s = timestamp_s;
+    WARMSTART_save(&point);
+
+    telemetry->overwritten = TUNING_get_overwritten_count();
+    telemetry->duration_ms = PLATFORM_get_tick_ms() - start_tick;
+}
@@ -0,0 +1,81 @@
+#include "al_warmstart.h"
+#include "meas_config.h"
+
+/*
+ * Last converged tuning point, kept in SRAM2.
+ * SRAM2 is retained in STOP2 and not cleared by a reset (the section is not
+ * touched by the startup code), so the next search can start around the
+ * previous notch position. After a power loss the content is random, which
+ * the magic and the checksum detect. A point older than
+ * TUNING_WARM_MAX_AGE_S is not handed out. Timestamps count from power on,
+ * a point saved before a reset has a later one than the clock, its age is
+ * unknown and it is still used.
+ */
+
+// ###### defines
+
+#define WARMSTART_MAGIC 0x574D5354UL // "WMST"
+
+// ###### typedefs
+
+typedef struct
+{
+    uint32_t magic;
+    WARMSTART_point point;
+    uint32_t checksum;
+} WARMSTART_storage;
+
+// ###### global variables
+
+static WARMSTART_storage warmstart_storage __attribute__((section(".ram2_noinit")));
+
+// ###### private functions
+
+static uint32_t WARMSTART_checksum(const WARMSTART_point *point)
+{
+    const uint8_t *bytes = (const uint8_t *)point;
+    uint32_t hash = 2166136261UL; // FNV-1a
+    uint16_t i;
+
+    for (i = 0; i < sizeof(WARMSTART_point); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// ###### functions
+
+void WARMSTART_save(const WARMSTART_point *point)
+{
+    warmstart_storage.magic = 0;
+    warmstart_storage.point = *point;
+    warmstart_storage.checksum = WARMSTART_checksum(&warmstart_storage.point);
+    warmstart_storage.magic = WARMSTART_MAGIC;
+}
+
+/**
+ * @param point: receives the stored tuning point
+ * @param now_s: time of the measurement, same clock as WARMSTART_point.timestamp_s
+ * @return false if nothing valid is stored (first boot, power loss) or the
+ *         point is older than TUNING_WARM_MAX_AGE_S
+ */
+bool WARMSTART_load(WARMSTART_point *point, uint32_t now_s)
+{
+    if (warmstart_storage.magic != WARMSTART_MAGIC)
+        return false;
+    if (warmstart_storage.checksum != WARMSTART_checksum(&warmstart_storage.point))
+        return false;
+    if (TUNING_WARM_MAX_AGE_S > 0 && now_s >= warmstart_storage.point.timestamp_s
+        && now_s - warmstart_storage.point.timestamp_s > TUNING_WARM_MAX_AGE_S)
+        return false;
+
+    *point = warmstart_storage.point;
+    return true;
+}
+
+void WARMSTART_invalidate()
+{
+    warmstart_storage.magic = 0;
+}
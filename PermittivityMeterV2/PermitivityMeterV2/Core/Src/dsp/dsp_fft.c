@@ -0,0 +1,120 @@
+#include "dsp_fft.h"
+#include <math.h>
+#include "meas_config.h"
+#include "dsp_rfft.h"
+
+/*
+ * Spectrum of one block through the real FFT of dsp_rfft.h (CMSIS-DSP on the
+ * target with DSP_BACKEND_CMSIS).
+ * Only used for diagnostics (DSP_TONE_DETECTOR_FFT, spectrum dumps or the
+ * frequency of a tone off the bins, dsp_peak.h), the tuning itself runs on
+ * the Goertzel detector.
+ */
+
+// ###### defines
+
+#define FFT_MAX_LENGTH ACQ_BLOCK_SIZE
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### global variables
+
+static DSP_rfft fft_rfft;
+static float fft_samples[FFT_MAX_LENGTH];
+static float fft_spectrum[FFT_MAX_LENGTH];
+static float fft_window[FFT_MAX_LENGTH]; // Hann of fft_window_length
+static uint16_t fft_window_length = 0;
+
+// ###### private functions
+
+/**
+ * Transforms the samples without their mean into fft_spectrum (packed, dsp_rfft.h).
+ * @param length: power of two, at most FFT_MAX_LENGTH
+ * @param is_windowed: Hann window after removing the mean
+ * @return false if the real FFT does not support the length (DSP_rfft_init())
+ */
+static bool FFT_transform(const uint16_t *samples, uint16_t length, bool is_windowed)
+{
+    uint32_t sum = 0;
+    float mean;
+    uint16_t i;
+
+    if (fft_rfft.length != length && !DSP_rfft_init(&fft_rfft, length))
+        return false;
+
+    for (i = 0; i < length; i++)
+        sum += samples[i];
+    mean = (float)sum / (float)length;
+    for (i = 0; i < length; i++)
+        fft_samples[i] = (float)samples[i] - mean;
+
+    if (is_windowed)
+    {
+        if (fft_window_length != length)
+        {
+            for (i = 0; i < length; i++)
+                fft_window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / length);
+            fft_window_length = length;
+        }
+        for (i = 0; i < length; i++)
+            fft_samples[i] *= fft_window[i];
+    }
+
+    DSP_rfft_f32(&fft_rfft, fft_samples, fft_spectrum);
+    return true;
+}
+
+// ###### functions
+
+/**
+ * Computes the single sided amplitude spectrum of one block.
+ * @param magnitudes: length / 2 values, peak amplitude per bin in LSB
+ * @return false if the length is not supported, magnitudes are left as they are
+ */
+bool DSP_fft_spectrum(const uint16_t *samples, uint16_t length, float magnitudes[])
+{
+    uint16_t i;
+
+    if (!FFT_transform(samples, length, false))
+        return false;
+    DSP_cmplx_mag_f32(fft_spectrum, magnitudes, length / 2);
+    magnitudes[0] = fabsf(fft_spectrum[0]); // [1] is the real X(length/2), not the imaginary part of X(0)
+    for (i = 0; i < length / 2; i++)
+        magnitudes[i] *= 2.0f / (float)length;
+    return true;
+}
+
+/**
+ * Amplitude and phase of one bin, computed through the full FFT.
+ * Same result as the Goertzel detector, used to cross check it.
+ * @param bin: 1..length/2-1
+ * @return false if the length is not supported, the result is 0 then
+ */
+bool DSP_fft_tone(const uint16_t *samples, uint16_t length, uint16_t bin, DSP_tone *result)
+{
+    float re, im;
+
+    result->amplitude = 0.0f;
+    result->phase = 0.0f;
+    if (!FFT_transform(samples, length, false))
+        return false;
+    re = fft_spectrum[2 * bin];
+    im = fft_spectrum[2 * bin + 1];
+    result->amplitude = 2.0f * sqrtf(re * re + im * im) / (float)length;
+    result->phase = atan2f(im, re);
+    return true;
+}
+
+/**
+ * Frequency and amplitude of the strongest tone of one block, between the
+ * bins (dsp_peak.h). The block is windowed as the method needs.
+ * @return false if there is no peak or the length is not supported
+ */
+bool DSP_fft_peak(const uint16_t *samples, uint16_t length, DSP_peak_method method, DSP_peak *peak)
+{
+    if (!FFT_transform(samples, length, DSP_peak_is_windowed(method)))
+        return false;
+    return DSP_peak_estimate(method, fft_spectrum, length, peak);
+}
@@ -0,0 +1,93 @@
+#include "dsp_goertzel.h"
+#include <math.h>
+
+/*
+ * Goertzel detector for a single DFT bin.
+ * The recursion runs on the raw 12-bit samples in integer arithmetic:
+ *
+ *   s[n] = x[n] + 2cos(w) * s[n-1] - s[n-2]
+ *
+ * The coefficient is in Q30, only the product needs 64 bit (one SMULL on the
+ * Cortex-M4). The DC offset of the ADC signal does not leak into an integer
+ * bin, so it is not removed. It does drive the state though: the resonator
+ * has a DC gain of up to 1 / (sin(w) sin(w/2)), the tone adds up to
+ * length / sin(w). With 12-bit samples around mid-scale the state is bounded by
+ *
+ *   2048 / (sin(w) sin(w/2)) + 2048 * length / sin(w)
+ *
+ * which DSP_goertzel_init() keeps below 2^30, so s[n-1] * 2cos(w) + x[n] fits
+ * 32 bit as well. The alias bin at a quarter of the block passes for any
+ * length, bin 1 only up to 1580 samples (bin 2: 2384, bin 3: 2989).
+ */
+
+// ###### defines
+
+#define GOERTZEL_Q30_ONE (1L << 30)
+// bound of the state, half the int32 range (see above)
+#define GOERTZEL_STATE_LIMIT 1073741824.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### functions
+
+/**
+ * Precomputes the coefficients for one bin.
+ * @param bin: DFT bin to evaluate (1..length/2-1)
+ * @param length: number of samples per block
+ * @return false if the bin is out of range or the state could overflow 32 bit
+ *         for this bin and length (low bins of long blocks)
+ */
+bool DSP_goertzel_init(DSP_goertzel *goertzel, uint16_t bin, uint16_t length)
+{
+    double w, bound;
+
+    goertzel->length = 0;
+    if (bin == 0 || 2 * (uint32_t)bin >= length)
+        return false;
+    w = 2.0 * M_PI * (double)bin / (double)length;
+    bound = 2048.0 / (sin(w) * sin(w / 2.0)) + 2048.0 * (double)length / sin(w);
+    if (bound >= GOERTZEL_STATE_LIMIT)
+        return false;
+
+    goertzel->length = length;
+    goertzel->bin = bin;
+    goertzel->coeff_q30 = (int32_t)lround(2.0 * cos(w) * GOERTZEL_Q30_ONE);
+    goertzel->cos_w = (float)cos(w);
+    goertzel->sin_w = (float)sin(w);
+    return true;
+}
+
+/**
+ * Evaluates the configured bin over one block of raw ADC samples.
+ * @param samples: goertzel->length right aligned ADC samples
+ * @param result: amplitude in LSB (peak) and phase of the bin
+ */
+void DSP_goertzel_process(const DSP_goertzel *goertzel, const uint16_t *samples, DSP_tone *result)
+{
+    const int32_t coeff = goertzel->coeff_q30;
+    int32_t s1 = 0; // s[n-1]
+    int32_t s2 = 0; // s[n-2]
+    uint16_t i;
+
+    // unrolled by two, the states swap roles instead of being copied
+    for (i = 0; i + 1 < goertzel->length; i += 2)
+    {
+        s2 = (int32_t)samples[i] + (int32_t)(((int64_t)coeff * s1) >> 30) - s2;
+        s1 = (int32_t)samples[i + 1] + (int32_t)(((int64_t)coeff * s2) >> 30) - s1;
+    }
+    if (i < goertzel->length)
+    {
+        int32_t s0 = (int32_t)samples[i] + (int32_t)(((int64_t)coeff * s1) >> 30) - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+
+    // X(k) = s[N-1] * e^(jw) - s[N-2]
+    float re = (float)s1 * goertzel->cos_w - (float)s2;
+    float im = (float)s1 * goertzel->sin_w;
+
+    result->amplitude = 2.0f * sqrtf(re * re + im * im) / (float)goertzel->length;
+    result->phase = atan2f(im, re);
+}
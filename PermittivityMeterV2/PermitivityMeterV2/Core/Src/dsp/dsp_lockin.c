@@ -0,0 +1,168 @@
+#include "dsp_lockin.h"
+#include <math.h>
+
+/*
+ * Software lock-in amplifier.
+ * The ADC samples are mixed with a cosine and a sine reference at the alias
+ * frequency and integrated over the block. With coherent sampling the sample
+ * clock is derived from the same HSE crystal as MCO1, so the reference table
+ * stays phase locked to the excitation without any PLL in software.
+ *
+ * Across the Twin-T notch the phase turns by about 180 deg, so the sign of the
+ * phase relative to the notch centre tells on which side of the minimum the
+ * varactor voltage currently is.
+ */
+
+// ###### defines
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### private functions
+
+static uint16_t LOCKIN_gcd(uint16_t a, uint16_t b)
+{
+    while (b != 0)
+    {
+        uint16_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static float LOCKIN_wrap(float phase)
+{
+    while (phase > (float)M_PI)
+        phase -= 2.0f * (float)M_PI;
+    while (phase < -(float)M_PI)
+        phase += 2.0f * (float)M_PI;
+    return phase;
+}
+
+// ###### functions
+
+/**
+ * Builds the reference table. Only one period of the reference is stored,
+ * e.g. 4 samples for the alias at fs / 4.
+ * @param cycles_per_block: reference cycles per block (= DFT bin), must be > 0
+ * @param length: samples per block
+ * @param smoothing_shift: I/Q are averaged over about 2^shift blocks
+ * @return false if the period is longer than LOCKIN_MAX_PERIOD
+ */
+bool DSP_lockin_init(DSP_lockin *lockin, uint16_t cycles_per_block, uint16_t length, uint8_t smoothing_shift)
+{
+    uint16_t cycles_per_period;
+    uint16_t divisor;
+    uint16_t i;
+
+    lockin->period = 0;
+    if (cycles_per_block == 0 || length == 0)
+        return false;
+
+    divisor = LOCKIN_gcd(length, cycles_per_block);
+    if (length / divisor > LOCKIN_MAX_PERIOD)
+        return false;
+
+    cycles_per_period = cycles_per_block / divisor;
+    lockin->period = length / divisor;
+
+    for (i = 0; i < lockin->period; i++)
+    {
+        double w = 2.0 * M_PI * (double)cycles_per_period * i / lockin->period;
+        lockin->cos_q15[i] = (int16_t)lround(32767.0 * cos(w));
+        lockin->sin_q15[i] = (int16_t)lround(-32767.0 * sin(w));
+    }
+
+    lockin->smoothing_shift = smoothing_shift;
+    lockin->phase_reference = 0.0f;
+    DSP_lockin_reset(lockin);
+    return true;
+}
+
+/**
+ * Forgets the averaged I/Q, e.g. after the DAC was stepped.
+ */
+void DSP_lockin_reset(DSP_lockin *lockin)
+{
+    lockin->i_filtered = 0;
+    lockin->q_filtered = 0;
+    lockin->has_filtered_value = false;
+}
+
+/**
+ * Stores the phase measured at the notch centre (found once by a full search).
+ */
+void DSP_lockin_set_reference(DSP_lockin *lockin, float phase_at_notch)
+{
+    lockin->phase_reference = phase_at_notch;
+}
+
+/**
+ * Demodulates one block. Only whole periods of the reference are used, the
+ * samples of an incomplete last period are left out (none for the block
+ * length of DSP_lockin_init()).
+ * @param result: magnitude and phase of the (averaged) I/Q vector
+ */
+void DSP_lockin_process(DSP_lockin *lockin, const uint16_t *samples, uint16_t length, DSP_lockin_result *result)
+{
+    int64_t i_sum = 0;
+    int64_t q_sum = 0;
+    uint16_t n = 0;
+    uint16_t k;
+
+    length = (lockin->period > 0) ? length - length % lockin->period : 0;
+    if (length == 0)
+    {
+        result->magnitude = 0.0f;
+        result->phase = 0.0f;
+        result->signed_phase = 0.0f;
+        return;
+    }
+
+    // the DC offset cancels because the block holds whole reference periods,
+    // the 64 bit accumulation maps onto SMLAL on the Cortex-M4
+    while (n < length)
+    {
+        for (k = 0; k < lockin->period; k++, n++)
+        {
+            int32_t x = (int32_t)samples[n];
+            i_sum += (int64_t)(x * lockin->cos_q15[k]);
+            q_sum += (int64_t)(x * lockin->sin_q15[k]);
+        }
+    }
+
+    if (lockin->smoothing_shift == 0 || !lockin->has_filtered_value)
+    {
+        lockin->i_filtered = i_sum;
+        lockin->q_filtered = q_sum;
+        lockin->has_filtered_value = true;
+    }
+    else
+    {
+        // first order low pass: y += (x - y) / 2^shift
+        lockin->i_filtered += (i_sum - lockin->i_filtered) >> lockin->smoothing_shift;
+        lockin->q_filtered += (q_sum - lockin->q_filtered) >> lockin->smoothing_shift;
+    }
+
+    float i_value = (float)lockin->i_filtered / 32767.0f;
+    float q_value = (float)lockin->q_filtered / 32767.0f;
+
+    result->magnitude = 2.0f * sqrtf(i_value * i_value + q_value * q_value) / (float)length;
+    result->phase = atan2f(q_value, i_value);
+    result->signed_phase = LOCKIN_wrap(result->phase - lockin->phase_reference);
+}
+
+/**
+ * @return +1 or -1 depending on which side of the notch the last block was
+ *         measured, 0 if the phase is exactly at the reference
+ */
+int8_t DSP_lockin_notch_side(const DSP_lockin_result *result)
+{
+    if (result->signed_phase > 0.0f)
+        return 1;
+    if (result->signed_phase < 0.0f)
+        return -1;
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "dsp_peak.h"
+#include <math.h>
+
+/*
+ * Frequency and amplitude of the strongest tone between the bins of a real
+ * FFT (spectrum packed as in dsp_rfft.h). Picking the highest bin is off by
+ * up to half a bin and loses up to 36 % (no window) of the amplitude when the
+ * tone falls between two bins, which longer blocks would have to make up.
+ *
+ * The three bins k-1, k, k+1 around the highest one give the offset d from k:
+ *
+ *   QUADRATIC       vertex of the parabola through |X|, biased towards the bin
+ *   JACOBSEN        d = Re((X(k-1) - X(k+1)) / (2 X(k) - X(k-1) - X(k+1))),
+ *                   exact for a rectangular window up to tan(pi/N) / (pi/N)
+ *   JACOBSEN_HANN   the same ratio times 2 is exact with the Hann window, whose
+ *                   bins around a tone go with 1 / (d (1 - d^2))
+ *
+ * The amplitude of bin k is divided by the window response at d (sinc(d),
+ * with Hann sinc(d) / (1 - d^2)). The error is the noise of the spectrum
+ * away from the peak carried through the estimator: it does not contain the
+ * bias of the method, and with no window the leakage of the tone counts as
+ * noise, so it is pessimistic there. The Hann window correlates the noise of
+ * neighbouring bins (-2/3, 1/6 two bins apart), which is taken into account.
+ */
+
+// ###### defines
+
+#define PEAK_GUARD_BINS 3      // bins on each side of the peak left out of the noise floor
+#define PEAK_HANN_SUM 0.5f     // sum of the Hann window / length
+#define PEAK_BIN_ERROR 0.2887f // standard deviation of the rounding to a bin, 1 / sqrt(12)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### typedefs
+
+typedef struct
+{
+    float re[3]; // X(k-1), X(k), X(k+1)
+    float im[3];
+} PEAK_bins;
+
+// ###### private functions
+
+static void PEAK_get_bin(const float *spectrum, uint16_t length, uint16_t k, float *re, float *im)
+{
+    if (k == 0 || k == length / 2)
+    {
+        *re = spectrum[k == 0 ? 0 : 1]; // DC and Nyquist are real, packed into [0] and [1]
+        *im = 0.0f;
+        return;
+    }
+    *re = spectrum[2 * k];
+    *im = spectrum[2 * k + 1];
+}
+
+static float PEAK_sinc(float x)
+{
+    return fabsf(x) < 1e-6f ? 1.0f : sinf((float)M_PI * x) / ((float)M_PI * x);
+}
+
+/**
+ * Real part of the complex ratio (X(k-1) - X(k+1)) / (2 X(k) -+ X(k-1) -+ X(k+1)).
+ */
+static float PEAK_ratio(const PEAK_bins *bins)
+{
+    float numerator_re = bins->re[0] - bins->re[2];
+    float numerator_im = bins->im[0] - bins->im[2];
+    float denominator_re = 2.0f * bins->re[1] - bins->re[0] - bins->re[2];
+    float denominator_im = 2.0f * bins->im[1] - bins->im[0] - bins->im[2];
+    float norm = denominator_re * denominator_re + denominator_im * denominator_im;
+
+    if (norm == 0.0f)
+        return 0.0f;
+    return (numerator_re * denominator_re + numerator_im * denominator_im) / norm;
+}
+
+/**
+ * @return offset of the tone from the middle bin, -0.5..0.5
+ */
+static float PEAK_offset(DSP_peak_method method, const PEAK_bins *bins, uint16_t length)
+{
+    float offset = 0.0f;
+
+    switch (method)
+    {
+    case DSP_PEAK_BIN:
+        break;
+    case DSP_PEAK_QUADRATIC:
+    {
+        float left = hypotf(bins->re[0], bins->im[0]);
+        float middle = hypotf(bins->re[1], bins->im[1]);
+        float right = hypotf(bins->re[2], bins->im[2]);
+        float curvature = left - 2.0f * middle + right;
+
+        if (curvature < 0.0f)
+            offset = 0.5f * (left - right) / curvature;
+        break;
+    }
+    case DSP_PEAK_JACOBSEN:
+        offset = PEAK_ratio(bins) * tanf((float)M_PI / length) / ((float)M_PI / length);
+        break;
+    case DSP_PEAK_JACOBSEN_HANN:
+        offset = 2.0f * PEAK_ratio(bins);
+        break;
+    }
+    return offset < -0.5f ? -0.5f : (offset > 0.5f ? 0.5f : offset);
+}
+
+static float PEAK_amplitude(DSP_peak_method method, const PEAK_bins *bins, float offset, uint16_t length)
+{
+    float middle = hypotf(bins->re[1], bins->im[1]);
+    float scale = 2.0f / (float)length;
+
+    switch (method)
+    {
+    case DSP_PEAK_BIN:
+        break;
+    case DSP_PEAK_QUADRATIC:
+        // vertex of the parabola
+        middle -= 0.25f * (hypotf(bins->re[0], bins->im[0]) - hypotf(bins->re[2], bins->im[2])) * offset;
+        scale /= PEAK_HANN_SUM;
+        break;
+    case DSP_PEAK_JACOBSEN:
+        middle /= PEAK_sinc(offset);
+        break;
+    case DSP_PEAK_JACOBSEN_HANN:
+        middle *= (1.0f - offset * offset) / PEAK_sinc(offset);
+        scale /= PEAK_HANN_SUM;
+        break;
+    }
+    return middle * scale;
+}
+
+/**
+ * Noise of the three bins (mean power of the bins away from the peak) carried
+ * through the estimator: slope per bin and component, then the variance with
+ * the correlation of the bins.
+ */
+static float PEAK_error(DSP_peak_method method, const float *spectrum, uint16_t length, uint16_t peak_bin,
+                        const PEAK_bins *bins, float offset)
+{
+    static const float hann_correlation[3] = {1.0f, -2.0f / 3.0f, 1.0f / 6.0f};
+    static const float no_correlation[3] = {1.0f, 0.0f, 0.0f};
+    const float *correlation = DSP_peak_is_windowed(method) ? hann_correlation : no_correlation;
+    PEAK_bins disturbed;
+    float changes[6]; // re of k-1, k, k+1, then im
+    float power = 0.0f;
+    float variance = 0.0f;
+    float deviation;
+    uint16_t count = 0;
+    uint16_t k;
+    uint8_t i, j;
+
+    if (method == DSP_PEAK_BIN)
+        return PEAK_BIN_ERROR;
+
+    for (k = 1; k < length / 2; k++)
+    {
+        float re, im;
+
+        if (k + PEAK_GUARD_BINS >= peak_bin && k <= peak_bin + PEAK_GUARD_BINS)
+            continue;
+        PEAK_get_bin(spectrum, length, k, &re, &im);
+        power += re * re + im * im;
+        count++;
+    }
+    if (count == 0)
+        return 0.0f;
+    deviation = sqrtf(power / count / 2.0f); // per component
+
+    for (i = 0; i < 6; i++)
+    {
+        disturbed = *bins;
+        if (i < 3)
+            disturbed.re[i] += deviation;
+        else
+            disturbed.im[i - 3] += deviation;
+        changes[i] = PEAK_offset(method, &disturbed, length) - offset;
+    }
+    for (i = 0; i < 3; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            float c = correlation[i > j ? i - j : j - i];
+
+            variance += c * (changes[i] * changes[j] + changes[i + 3] * changes[j + 3]);
+        }
+    }
+    return variance > 0.0f ? sqrtf(variance) : 0.0f;
+}
+
+// ###### functions
+
+/**
+ * @return true if the method expects the block Hann windowed (w(n) = 0.5 - 0.5 cos(2 pi n / length))
+ */
+bool DSP_peak_is_windowed(DSP_peak_method method)
+{
+    return method == DSP_PEAK_QUADRATIC || method == DSP_PEAK_JACOBSEN_HANN;
+}
+
+/**
+ * Strongest tone between DC and Nyquist (both excluded).
+ * @param spectrum: real FFT of the block without its mean, windowed as DSP_peak_is_windowed() says, packed
+ * @param length: of the block, at least 8
+ * @return false if there is no peak (too short or all zero)
+ */
+bool DSP_peak_estimate(DSP_peak_method method, const float *spectrum, uint16_t length, DSP_peak *peak)
+{
+    PEAK_bins bins;
+    float highest = 0.0f;
+    uint16_t peak_bin = 0;
+    float offset;
+    uint16_t k;
+    uint8_t i;
+
+    if (length < 8)
+        return false;
+    for (k = 1; k < length / 2; k++)
+    {
+        float re, im;
+
+        PEAK_get_bin(spectrum, length, k, &re, &im);
+        if (re * re + im * im > highest)
+        {
+            highest = re * re + im * im;
+            peak_bin = k;
+        }
+    }
+    if (peak_bin == 0)
+        return false;
+
+    for (i = 0; i < 3; i++)
+        PEAK_get_bin(spectrum, length, peak_bin + i - 1, &bins.re[i], &bins.im[i]);
+
+    offset = PEAK_offset(method, &bins, length);
+    peak->bin = (float)peak_bin + offset;
+    peak->amplitude = PEAK_amplitude(method, &bins, offset, length);
+    peak->error = PEAK_error(method, spectrum, length, peak_bin, &bins, offset);
+    return true;
+}
@@ -0,0 +1,214 @@
+#include "dsp_q15.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * Fixed point path from the raw ADC block to the tone amplitude or the
+ * spectrum, without converting the samples to float:
+ *
+ *   offset   mean of the block (the 1.25 V bias of the buffer) removed
+ *   window   Hann or rectangular, q15
+ *   tone     single bin: correlation with window * e^(-jwn), 64 bit sums
+ *   spectrum windowed q15 block -> DSP_rfft_q15() -> DSP_cmplx_mag_q15()
+ *
+ * The inner loops take two 16-bit samples per 32-bit word and use the
+ * Cortex-M4 dual MACs (SMLAD, SMLALD, SMUAD) and SSUB16. On the host the
+ * same code runs with the C versions below, which give identical results.
+ *
+ * The single bin removes the offset without a second pass: the mean is
+ * summed along (SMLAD with 1, 1) and sum((x - m) ref) = sum(x ref) - m sum(ref).
+ */
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP == 1
+#include "cmsis_compiler.h"
+#else
+
+// C versions of the CMSIS SIMD intrinsics, same operands and results
+
+static inline uint32_t __SSUB16(uint32_t op1, uint32_t op2)
+{
+    uint16_t lo = (uint16_t)((int16_t)op1 - (int16_t)op2);
+    uint16_t hi = (uint16_t)((int16_t)(op1 >> 16) - (int16_t)(op2 >> 16));
+
+    return (uint32_t)lo | ((uint32_t)hi << 16);
+}
+
+static inline uint32_t __SMUAD(uint32_t op1, uint32_t op2)
+{
+    return (uint32_t)((int32_t)(int16_t)op1 * (int16_t)op2 + (int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16));
+}
+
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+    return __SMUAD(op1, op2) + op3;
+}
+
+static inline uint64_t __SMLALD(uint32_t op1, uint32_t op2, uint64_t acc)
+{
+    return acc + (uint64_t)((int64_t)(int16_t)op1 * (int16_t)op2 + (int64_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16));
+}
+
+#define __PKHBT(ARG1, ARG2, ARG3) ((((uint32_t)(ARG1)) & 0x0000FFFFUL) | ((((uint32_t)(ARG2)) << (ARG3)) & 0xFFFF0000UL))
+
+#endif
+
+// ###### defines
+
+#define Q15_ONES 0x00010001UL        // (1, 1): SMLAD with it sums both halves
+#define Q15_WINDOW_SHIFT 12          // (x - offset) * window >> 12: 12-bit input to q15
+#define Q15_RECTANGULAR_WINDOW 32767
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### private functions
+
+/**
+ * Two consecutive 16-bit values as one word (one LDR, alignment does not matter on the M4).
+ */
+static inline uint32_t Q15_read_pair(const void *values)
+{
+    uint32_t pair;
+
+    memcpy(&pair, values, sizeof(pair));
+    return pair;
+}
+
+static inline void Q15_write_pair(void *values, uint32_t pair)
+{
+    memcpy(values, &pair, sizeof(pair));
+}
+
+static uint16_t Q15_round_mean(uint32_t sum, uint16_t length)
+{
+    return (uint16_t)((sum + length / 2) / length);
+}
+
+// ###### functions
+
+/**
+ * Builds the window and the single bin reference.
+ * @param bin: DFT bin of DSP_q15_tone() (1..length/2-1)
+ * @param length: even, at most ACQ_BLOCK_SIZE; DSP_q15_spectrum() also needs a power of two
+ * @param is_windowed: Hann window, otherwise rectangular (enough with coherent sampling)
+ */
+void DSP_q15_init(DSP_q15 *q15, uint16_t bin, uint16_t length, bool is_windowed)
+{
+    double sum = 0.0;
+    uint16_t n;
+
+    q15->length = length;
+    q15->bin = bin;
+    q15->cos_sum = 0;
+    q15->sin_sum = 0;
+    for (n = 0; n < length; n++)
+    {
+        double w = 2.0 * M_PI * (double)((uint32_t)bin * n % length) / length;
+        double window = is_windowed ? 0.5 * (1.0 - cos(2.0 * M_PI * n / length)) : 1.0;
+
+        q15->window_q15[n] = is_windowed ? (int16_t)lround(32767.0 * window) : Q15_RECTANGULAR_WINDOW;
+        q15->cos_q15[n] = (int16_t)lround(32767.0 * window * cos(w));
+        q15->sin_q15[n] = (int16_t)lround(-32767.0 * window * sin(w));
+        q15->cos_sum += q15->cos_q15[n];
+        q15->sin_sum += q15->sin_q15[n];
+        sum += q15->window_q15[n];
+    }
+    q15->window_sum = (float)sum;
+    // the single bin works at any even length, only the spectrum needs the FFT
+    q15->has_spectrum = DSP_rfft_init(&q15->rfft, length);
+}
+
+/**
+ * @return mean ADC code of the block (the bias of the buffer stage), rounded
+ */
+uint16_t DSP_q15_get_offset(const DSP_q15 *q15, const uint16_t *samples)
+{
+    uint32_t sum = 0;
+    uint16_t n;
+
+    for (n = 0; n < q15->length; n += 2)
+        sum = __SMLAD(Q15_read_pair(&samples[n]), Q15_ONES, sum);
+    return Q15_round_mean(sum, q15->length);
+}
+
+/**
+ * Offset removed and windowed: out = (x - offset) * window / 2^12, about
+ * 8x the ADC value (rectangular), so the q15 range is used.
+ * @param out: q15->length values
+ */
+void DSP_q15_load(const DSP_q15 *q15, const uint16_t *samples, int16_t *out)
+{
+    uint16_t offset = DSP_q15_get_offset(q15, samples);
+    uint32_t offset_pair = ((uint32_t)offset << 16) | offset;
+    uint16_t n;
+
+    for (n = 0; n < q15->length; n += 2)
+    {
+        uint32_t x = __SSUB16(Q15_read_pair(&samples[n]), offset_pair);
+        uint32_t window = Q15_read_pair(&q15->window_q15[n]);
+        int32_t lo = (int32_t)__SMUAD(x, window & 0x0000FFFFUL) >> Q15_WINDOW_SHIFT;
+        int32_t hi = (int32_t)__SMUAD(x, window & 0xFFFF0000UL) >> Q15_WINDOW_SHIFT;
+
+        Q15_write_pair(&out[n], __PKHBT(lo, hi, 16));
+    }
+}
+
+/**
+ * Amplitude and phase of q15->bin in one pass over the raw block.
+ * Same convention as the Goertzel and FFT detectors.
+ */
+void DSP_q15_tone(const DSP_q15 *q15, const uint16_t *samples, DSP_tone *result)
+{
+    uint32_t sum = 0;
+    int64_t re = 0;
+    int64_t im = 0;
+    uint16_t offset;
+    uint16_t n;
+
+    for (n = 0; n < q15->length; n += 2)
+    {
+        uint32_t x = Q15_read_pair(&samples[n]);
+        uint32_t c = Q15_read_pair(&q15->cos_q15[n]);
+        uint32_t s = Q15_read_pair(&q15->sin_q15[n]);
+
+        sum = __SMLAD(x, Q15_ONES, sum);
+        re = (int64_t)__SMLALD(x, c, (uint64_t)re);
+        im = (int64_t)__SMLALD(x, s, (uint64_t)im);
+    }
+    offset = Q15_round_mean(sum, q15->length);
+    re -= (int64_t)offset * q15->cos_sum;
+    im -= (int64_t)offset * q15->sin_sum;
+
+    // |sum| = amplitude / 2 * sum(window)
+    result->amplitude = 2.0f * sqrtf((float)re * (float)re + (float)im * (float)im) / q15->window_sum;
+    result->phase = atan2f((float)im, (float)re);
+}
+
+/**
+ * Single sided magnitude spectrum in fixed point.
+ * @param magnitudes: q15->length / 2 + 1 values (2.14), times
+ *                    DSP_q15_get_lsb_per_magnitude() = peak amplitude in LSB
+ * @return false if the real FFT does not support q15->length
+ */
+bool DSP_q15_spectrum(DSP_q15 *q15, const uint16_t *samples, int16_t magnitudes[])
+{
+    static int16_t block[ACQ_BLOCK_SIZE];
+    static int16_t spectrum[ACQ_BLOCK_SIZE + 2];
+
+    if (!q15->has_spectrum)
+        return false;
+    DSP_q15_load(q15, samples, block);
+    DSP_rfft_q15(&q15->rfft, block, spectrum);
+    DSP_cmplx_mag_q15(spectrum, magnitudes, q15->length / 2 + 1);
+    return true;
+}
+
+/**
+ * Magnitude m = |X(k)| / length / 2 of (x - offset) * window / 2^12, so the
+ * peak amplitude of a tone is m * 2^14 * length / sum(window).
+ */
+float DSP_q15_get_lsb_per_magnitude(const DSP_q15 *q15)
+{
+    return 16384.0f * (float)q15->length / q15->window_sum;
+}
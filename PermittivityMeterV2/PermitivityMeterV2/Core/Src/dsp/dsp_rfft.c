@@ -0,0 +1,340 @@
+#include "dsp_rfft.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * DSP_BACKEND_CMSIS calls the CMSIS-DSP library (FPU / SIMD variants of the
+ * Cortex-M4 build). DSP_BACKEND_PORTABLE is the same computation in plain C,
+ * for the host and for the target as long as the library is not linked:
+ *
+ *   length/2 point complex FFT of the even / odd samples packed as re / im,
+ *   radix-2, then the split into the spectrum of the real signal
+ *   X(k) = (Z(k) + Z*(M-k)) / 2 - j W^k (Z(k) - Z*(M-k)) / 2, M = length/2
+ *
+ * The q15 FFT halves every stage (Z / M) and the split halves once more,
+ * so nothing can overflow and the bins are X(k) / length, the scaling the
+ * CMSIS-DSP documentation gives for arm_rfft_q15.
+ * The CMSIS branch has not been compiled yet (arm_math.h and the library are
+ * not in the tree) and has never been compared with this one. CMSIS uses
+ * radix-4/8 butterflies in another order, so the results will not be equal
+ * bit for bit; dsp_bench (Simulation/) holds both to the same tolerances
+ * against a DFT once it can be built with the library.
+ */
+
+// ###### defines
+
+#define RFFT_MAX_LENGTH ACQ_BLOCK_SIZE
+#define RFFT_MIN_LENGTH 4
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### global variables
+
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+static int16_t rfft_q15_output[2 * RFFT_MAX_LENGTH]; // arm_rfft_q15 writes the full spectrum
+#else
+// e^(-j 2pi i / RFFT_MAX_LENGTH), every shorter length takes every n-th entry
+static float rfft_cos[RFFT_MAX_LENGTH / 2];
+static float rfft_sin[RFFT_MAX_LENGTH / 2];
+static int16_t rfft_cos_q15[RFFT_MAX_LENGTH / 2];
+static int16_t rfft_sin_q15[RFFT_MAX_LENGTH / 2];
+static bool rfft_is_table_ready = false;
+#endif
+
+// ###### private functions
+
+#if DSP_BACKEND == DSP_BACKEND_PORTABLE
+
+static void RFFT_prepare_table()
+{
+    uint16_t i;
+
+    if (rfft_is_table_ready)
+        return;
+
+    for (i = 0; i < RFFT_MAX_LENGTH / 2; i++)
+    {
+        double w = 2.0 * M_PI * i / RFFT_MAX_LENGTH;
+
+        rfft_cos[i] = (float)cos(w);
+        rfft_sin[i] = (float)sin(w);
+        rfft_cos_q15[i] = (int16_t)lround(cos(w) * 32767.0);
+        rfft_sin_q15[i] = (int16_t)lround(sin(w) * 32767.0);
+    }
+    rfft_is_table_ready = true;
+}
+
+static int16_t RFFT_saturate_q15(int32_t value)
+{
+    if (value > INT16_MAX)
+        return INT16_MAX;
+    if (value < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)value;
+}
+
+/**
+ * Swaps the complex values into bit reversed order.
+ * @param data: count complex values of size bytes each (re / im pair)
+ */
+static void RFFT_bit_reverse(uint8_t *data, uint16_t count, uint16_t size)
+{
+    uint8_t swap[2 * sizeof(float)];
+    uint16_t i, j, k;
+
+    for (i = 0, j = 0; i < count; i++)
+    {
+        if (i < j)
+        {
+            memcpy(swap, &data[i * size], size);
+            memcpy(&data[i * size], &data[j * size], size);
+            memcpy(&data[j * size], swap, size);
+        }
+        k = count >> 1;
+        while (j & k)
+        {
+            j ^= k;
+            k >>= 1;
+        }
+        j |= k;
+    }
+}
+
+/**
+ * In place complex FFT, unscaled.
+ * @param count: complex points, power of two, at most RFFT_MAX_LENGTH / 2
+ */
+static void RFFT_cfft_f32(float *data, uint16_t count)
+{
+    uint16_t i, k, size;
+
+    RFFT_bit_reverse((uint8_t *)data, count, 2 * sizeof(float));
+    for (size = 2; size <= count; size <<= 1)
+    {
+        uint16_t half = size >> 1;
+        uint16_t step = RFFT_MAX_LENGTH / size;
+
+        for (i = 0; i < count; i += size)
+        {
+            for (k = 0; k < half; k++)
+            {
+                float wr = rfft_cos[k * step];
+                float wi = -rfft_sin[k * step];
+                float *a = &data[2 * (i + k)];
+                float *b = a + 2 * half;
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * In place complex FFT, every stage halves, result / count.
+ * Only values near full scale in re and im at once can saturate.
+ */
+static void RFFT_cfft_q15(int16_t *data, uint16_t count)
+{
+    uint16_t i, k, size;
+
+    RFFT_bit_reverse((uint8_t *)data, count, 2 * sizeof(int16_t));
+    for (size = 2; size <= count; size <<= 1)
+    {
+        uint16_t half = size >> 1;
+        uint16_t step = RFFT_MAX_LENGTH / size;
+
+        for (i = 0; i < count; i += size)
+        {
+            for (k = 0; k < half; k++)
+            {
+                int32_t wr = rfft_cos_q15[k * step];
+                int32_t wi = -rfft_sin_q15[k * step];
+                int16_t *a = &data[2 * (i + k)];
+                int16_t *b = a + 2 * half;
+                int32_t tr = (b[0] * wr - b[1] * wi) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr) >> 15;
+                int32_t ar = a[0];
+                int32_t ai = a[1];
+
+                a[0] = RFFT_saturate_q15((ar + tr) >> 1);
+                a[1] = RFFT_saturate_q15((ai + ti) >> 1);
+                b[0] = RFFT_saturate_q15((ar - tr) >> 1);
+                b[1] = RFFT_saturate_q15((ai - ti) >> 1);
+            }
+        }
+    }
+}
+
+static uint16_t RFFT_sqrt_u32(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+#endif
+
+// ###### functions
+
+/**
+ * @param length: power of two, RFFT_MIN_LENGTH (CMSIS: 32) to RFFT_MAX_LENGTH
+ * @return false if the length is not supported
+ */
+bool DSP_rfft_init(DSP_rfft *rfft, uint16_t length)
+{
+    // stays 0 if the length is not supported
+    rfft->length = 0;
+    if (length < RFFT_MIN_LENGTH || length > RFFT_MAX_LENGTH || (length & (length - 1)) != 0)
+        return false;
+
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    if (arm_rfft_fast_init_f32(&rfft->fast, length) != ARM_MATH_SUCCESS
+        || arm_rfft_init_q15(&rfft->q15, length, 0, 1) != ARM_MATH_SUCCESS)
+        return false;
+#else
+    RFFT_prepare_table();
+#endif
+    rfft->length = length;
+    return true;
+}
+
+/**
+ * @param samples: rfft->length values, used as work buffer (overwritten)
+ * @param spectrum: rfft->length values, packed (dsp_rfft.h)
+ */
+void DSP_rfft_f32(DSP_rfft *rfft, float *samples, float *spectrum)
+{
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    arm_rfft_fast_f32(&rfft->fast, samples, spectrum, 0);
+#else
+    uint16_t count = rfft->length / 2;
+    uint16_t step = RFFT_MAX_LENGTH / rfft->length;
+    uint16_t k;
+
+    RFFT_cfft_f32(samples, count);
+
+    spectrum[0] = samples[0] + samples[1];
+    spectrum[1] = samples[0] - samples[1];
+    for (k = 1; k < count; k++)
+    {
+        float c = rfft_cos[k * step];
+        float s = rfft_sin[k * step];
+        float sr = samples[2 * k] + samples[2 * (count - k)];
+        float si = samples[2 * k + 1] - samples[2 * (count - k) + 1];
+        float dr = samples[2 * k] - samples[2 * (count - k)];
+        float di = samples[2 * k + 1] + samples[2 * (count - k) + 1];
+
+        spectrum[2 * k] = 0.5f * (sr + c * di - s * dr);
+        spectrum[2 * k + 1] = 0.5f * (si - c * dr - s * di);
+    }
+#endif
+}
+
+/**
+ * @param samples: rfft->length values in q15, used as work buffer by arm_rfft_q15 (overwritten)
+ * @param spectrum: rfft->length + 2 values, X(k) / length for k = 0..length/2
+ */
+void DSP_rfft_q15(DSP_rfft *rfft, int16_t *samples, int16_t *spectrum)
+{
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    arm_rfft_q15(&rfft->q15, samples, rfft_q15_output);
+    memcpy(spectrum, rfft_q15_output, (rfft->length + 2) * sizeof(int16_t));
+#else
+    uint16_t count = rfft->length / 2;
+    uint16_t step = RFFT_MAX_LENGTH / rfft->length;
+    int32_t re0, im0;
+    uint16_t k;
+
+    // the complex FFT runs in the spectrum, X(length/2) is appended by the split
+    memcpy(spectrum, samples, rfft->length * sizeof(int16_t));
+    RFFT_cfft_q15(spectrum, count);
+
+    re0 = spectrum[0];
+    im0 = spectrum[1];
+    spectrum[0] = (int16_t)((re0 + im0) >> 1);
+    spectrum[1] = 0;
+    spectrum[2 * count] = (int16_t)((re0 - im0) >> 1);
+    spectrum[2 * count + 1] = 0;
+
+    // in place: X(k) and X(M-k) both come from Z(k) and Z(M-k)
+    for (k = 1; k <= count / 2; k++)
+    {
+        int16_t *a = &spectrum[2 * k];
+        int16_t *b = &spectrum[2 * (count - k)];
+        int32_t c = rfft_cos_q15[k * step];
+        int32_t s = rfft_sin_q15[k * step];
+        int32_t sr = a[0] + b[0];
+        int32_t si = a[1] - b[1];
+        int32_t dr = a[0] - b[0];
+        int32_t di = a[1] + b[1];
+        int32_t p = ((c * di) >> 15) - ((s * dr) >> 15);
+        int32_t q = ((c * dr) >> 15) + ((s * di) >> 15);
+
+        a[0] = RFFT_saturate_q15((sr + p) >> 2);
+        a[1] = RFFT_saturate_q15((si - q) >> 2);
+        if (b != a)
+        {
+            b[0] = RFFT_saturate_q15((sr - p) >> 2);
+            b[1] = RFFT_saturate_q15((-si - q) >> 2);
+        }
+    }
+#endif
+}
+
+/**
+ * @param spectrum: count interleaved re / im pairs
+ * @param magnitudes: count values, sqrt(re^2 + im^2)
+ */
+void DSP_cmplx_mag_f32(const float *spectrum, float *magnitudes, uint16_t count)
+{
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    arm_cmplx_mag_f32(spectrum, magnitudes, count);
+#else
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+        magnitudes[i] = sqrtf(spectrum[2 * i] * spectrum[2 * i] + spectrum[2 * i + 1] * spectrum[2 * i + 1]);
+#endif
+}
+
+/**
+ * @param spectrum: count interleaved re / im pairs in q15
+ * @param magnitudes: count values in 2.14 like arm_cmplx_mag_q15, sqrt(re^2 + im^2) / 2 in q15
+ */
+void DSP_cmplx_mag_q15(const int16_t *spectrum, int16_t *magnitudes, uint16_t count)
+{
+#if DSP_BACKEND == DSP_BACKEND_CMSIS
+    arm_cmplx_mag_q15(spectrum, magnitudes, count);
+#else
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        int32_t re = spectrum[2 * i];
+        int32_t im = spectrum[2 * i + 1];
+
+        magnitudes[i] = (int16_t)(RFFT_sqrt_u32((uint32_t)(re * re) + (uint32_t)(im * im)) >> 1);
+    }
+#endif
+}
@@ -0,0 +1,153 @@
+#include "dsp_sdft.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * Sliding DFT of one bin over the last sdft->window samples, updated with
+ * every sample, so the amplitude follows the notch between two blocks.
+ *
+ * The textbook recursion S(n) = (S(n-1) + x(n) - x(n-N)) e^(jw) multiplies
+ * the state with a rounded twiddle every sample, the error piles up and has
+ * to be cleared by recomputing the sum now and then. Here the sum is kept in
+ * the frame of the reference instead:
+ *
+ *   A(n) = A(n-1) + (x(n) - x(n-N)) e^(-jw n)
+ *
+ * Since N holds whole periods of the reference, x(n) and x(n-N) meet the
+ * same q15 table entry and A is an exact integer sum (64 bit, SMLAL on the
+ * Cortex-M4): two multiply-adds per sample and no drift to re-normalise,
+ * however long it runs. The rotation back to the window start,
+ * X = A e^(jw s), is done only when the tone is read.
+ *
+ * A gap in the samples (lost DMA block, ACQ restart, DAC step) breaks the
+ * window: DSP_sdft_reset(), the result is valid again N samples later.
+ */
+
+// ###### defines
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### private functions
+
+static uint16_t SDFT_gcd(uint16_t a, uint16_t b)
+{
+    while (b != 0)
+    {
+        uint16_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// ###### functions
+
+/**
+ * @param cycles_per_block: reference cycles per block_length samples (= DFT bin of the block), > 0
+ * @param block_length: samples the bin refers to, e.g. ACQ_BLOCK_SIZE
+ * @param window: samples summed over, a multiple of the reference period, at most SDFT_WINDOW_LENGTH
+ * @return false if the window does not fit the history or does not hold whole
+ *         periods, the sums would not be exact then
+ */
+bool DSP_sdft_init(DSP_sdft *sdft, uint16_t cycles_per_block, uint16_t block_length, uint16_t window)
+{
+    uint16_t divisor;
+    uint16_t cycles_per_period;
+    uint16_t i;
+
+    sdft->period = 0;
+    sdft->window = 0;
+    if (cycles_per_block == 0 || block_length == 0 || window == 0 || window > SDFT_WINDOW_LENGTH)
+        return false;
+
+    divisor = SDFT_gcd(block_length, cycles_per_block);
+    cycles_per_period = cycles_per_block / divisor;
+    if (window % (block_length / divisor) != 0)
+        return false;
+
+    sdft->period = block_length / divisor;
+    sdft->window = window;
+    for (i = 0; i < sdft->period; i++)
+    {
+        double w = 2.0 * M_PI * (double)cycles_per_period * i / sdft->period;
+
+        sdft->cos_q15[i] = (int16_t)lround(32767.0 * cos(w));
+        sdft->sin_q15[i] = (int16_t)lround(-32767.0 * sin(w));
+    }
+    DSP_sdft_reset(sdft);
+    return true;
+}
+
+/**
+ * Empties the window, e.g. after a gap in the samples.
+ */
+void DSP_sdft_reset(DSP_sdft *sdft)
+{
+    memset(sdft->history, 0, sizeof(sdft->history));
+    sdft->phase = 0;
+    sdft->position = 0;
+    sdft->filled = 0;
+    sdft->re = 0;
+    sdft->im = 0;
+    sdft->samples = 0;
+}
+
+/**
+ * Slides the window over the next samples, whatever length the DMA hands out.
+ * @param samples: raw ADC samples following the ones pushed before
+ */
+void DSP_sdft_push(DSP_sdft *sdft, const uint16_t *samples, uint16_t count)
+{
+    int64_t re = sdft->re;
+    int64_t im = sdft->im;
+    uint16_t phase = sdft->phase;
+    uint16_t position = sdft->position;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        // the slots start at 0, so the window fills with the same code
+        int32_t difference = (int32_t)samples[i] - (int32_t)sdft->history[position];
+
+        re += (int64_t)difference * sdft->cos_q15[phase];
+        im += (int64_t)difference * sdft->sin_q15[phase];
+        sdft->history[position] = samples[i];
+        if (++position == sdft->window)
+            position = 0;
+        if (++phase == sdft->period)
+            phase = 0;
+    }
+
+    sdft->re = re;
+    sdft->im = im;
+    sdft->phase = phase;
+    sdft->position = position;
+    sdft->samples += count;
+    sdft->filled = sdft->samples >= sdft->window ? sdft->window : (uint16_t)sdft->samples;
+}
+
+/**
+ * @return true once a whole window has been pushed since the last reset
+ */
+bool DSP_sdft_is_valid(const DSP_sdft *sdft)
+{
+    return sdft->filled == sdft->window;
+}
+
+/**
+ * Tone over the current window, same scaling and phase convention (relative
+ * to the oldest sample of the window) as the block detectors of dsp_tone.h.
+ */
+void DSP_sdft_get_tone(const DSP_sdft *sdft, DSP_tone *result)
+{
+    // oldest sample s: s = n - N and N holds whole periods, so s mod period = phase
+    float re = (float)sdft->re / 32767.0f;
+    float im = (float)sdft->im / 32767.0f;
+    float c = (float)sdft->cos_q15[sdft->phase] / 32767.0f;
+    float s = -(float)sdft->sin_q15[sdft->phase] / 32767.0f;
+
+    result->amplitude = 2.0f * sqrtf(re * re + im * im) / (float)sdft->window;
+    result->phase = atan2f(re * s + im * c, re * c - im * s);
+}
@@ -0,0 +1,59 @@
+#include "dsp_tone.h"
+#include "meas_config.h"
+#include "dsp_goertzel.h"
+#include "dsp_fft.h"
+#include "dsp_q15.h"
+
+/*
+ * Measures the aliased excitation tone (ACQ_ALIAS_BIN) of one block with the
+ * detector selected by DSP_TONE_DETECTOR.
+ */
+
+// ###### defines
+
+#if DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_FFT
+_Static_assert((ACQ_BLOCK_SIZE & (ACQ_BLOCK_SIZE - 1)) == 0, "the FFT detector needs a power of two ACQ_BLOCK_SIZE");
+#endif
+
+// ###### global variables
+
+#if DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_GOERTZEL
+static DSP_goertzel tone_goertzel;
+#elif DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_Q15
+static DSP_q15 tone_q15;
+#endif
+
+// ###### functions
+
+/**
+ * @return false if the detector cannot evaluate ACQ_ALIAS_BIN of ACQ_BLOCK_SIZE samples
+ */
+bool DSP_tone_init()
+{
+#if DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_GOERTZEL
+    return DSP_goertzel_init(&tone_goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE);
+#elif DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_Q15
+    DSP_q15_init(&tone_q15, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, DSP_Q15_WINDOWED);
+    return true;
+#else
+    return true;
+#endif
+}
+
+/**
+ * @param samples: raw ADC block
+ * @param length: must be ACQ_BLOCK_SIZE
+ * @param result: amplitude and phase of the alias bin
+ */
+void DSP_tone_measure(const uint16_t *samples, uint16_t length, DSP_tone *result)
+{
+#if DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_GOERTZEL
+    (void)length;
+    DSP_goertzel_process(&tone_goertzel, samples, result);
+#elif DSP_TONE_DETECTOR == DSP_TONE_DETECTOR_Q15
+    (void)length;
+    DSP_q15_tone(&tone_q15, samples, result);
+#else
+    DSP_fft_tone(samples, length, ACQ_ALIAS_BIN, result); // ACQ_BLOCK_SIZE, asserted above
+#endif
+}
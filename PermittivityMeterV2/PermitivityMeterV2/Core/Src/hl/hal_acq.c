@@ -0,0 +1,223 @@
+#include "hal_acq.h"
+#include "platform.h"
+
+/*
+ * Streaming acquisition of ADC1.
+ * DMA1 channel 1 runs in circular mode over a buffer of two blocks. The half
+ * transfer interrupt hands out block 0, the transfer complete interrupt block 1,
+ * so the application processes one block while the DMA fills the other one.
+ * The peripheral setup itself is behind platform.h (platform_stm32.c).
+ */
+
+// ###### defines
+
+#define ACQ_NO_BLOCK 0xFF
+
+#if ACQ_COHERENT_SAMPLING
+_Static_assert((((unsigned long long)MEAS_EXCITATION_HZ * ACQ_TRIGGER_DIVIDER) % ACQ_TRIGGER_CLOCK_HZ)
+                       * ACQ_BLOCK_SIZE % ACQ_TRIGGER_CLOCK_HZ == 0,
+               "aliased excitation tone does not fall on an integer bin of ACQ_BLOCK_SIZE");
+#endif
+
+// ###### global variables
+
+static uint16_t acq_dma_buffer[2 * ACQ_BLOCK_SIZE];
+
+static volatile bool acq_is_running = false;
+static bool acq_is_armed = false;
+static volatile uint8_t acq_pending_half = ACQ_NO_BLOCK;  // completed, not yet fetched
+static volatile uint8_t acq_owned_half = ACQ_NO_BLOCK;    // fetched by the application
+static volatile bool acq_owned_half_overwritten = false;
+static volatile uint32_t acq_sequence = 0;
+static volatile uint32_t acq_pending_sequence = 0;
+static volatile uint32_t acq_overrun_count = 0;
+
+// ###### functions
+
+void ACQ_init()
+{
+    PLATFORM_adc_init();
+}
+
+/**
+ * Calibrates ADC1 and arms the circular DMA capture.
+ * In coherent mode the ADC then waits for the first TIM6 trigger, so a second
+ * timer can be lined up with the sampling before ACQ_start() (see hal_sweep.c).
+ * Without coherent sampling the free running conversions start right away.
+ */
+void ACQ_arm()
+{
+    if (acq_is_running || acq_is_armed)
+        return;
+
+    acq_pending_half = ACQ_NO_BLOCK;
+    acq_owned_half = ACQ_NO_BLOCK;
+    acq_owned_half_overwritten = false;
+    acq_sequence = 0;
+
+    PLATFORM_adc_arm(acq_dma_buffer, 2 * ACQ_BLOCK_SIZE);
+    acq_is_armed = true;
+}
+
+/**
+ * Starts the circular DMA capture of ADC1.
+ * Blocks become available through ACQ_get_block() every ACQ_BLOCK_SIZE samples.
+ */
+void ACQ_start()
+{
+    if (acq_is_running)
+        return;
+
+    ACQ_arm();
+    PLATFORM_adc_trigger_start();
+    acq_is_armed = false;
+    acq_is_running = true;
+}
+
+void ACQ_stop()
+{
+    if (!acq_is_running && !acq_is_armed)
+        return;
+
+    PLATFORM_adc_stop();
+    acq_is_running = false;
+    acq_is_armed = false;
+    acq_pending_half = ACQ_NO_BLOCK;
+}
+
+bool ACQ_is_running()
+{
+    return acq_is_running;
+}
+
+/**
+ * Fetches the most recently completed block without waiting.
+ * The block stays valid until ACQ_release_block() is called, as long as the
+ * application finishes with it before the DMA completes the other half.
+ * @param block: filled with pointer, length and sequence number of the block
+ * @return true if a new block was available
+ */
+bool ACQ_get_block(ACQ_block *block)
+{
+    bool has_block = false;
+
+    PLATFORM_irq_disable();
+    if (acq_pending_half != ACQ_NO_BLOCK && acq_owned_half == ACQ_NO_BLOCK)
+    {
+        acq_owned_half = acq_pending_half;
+        acq_owned_half_overwritten = false;
+        acq_pending_half = ACQ_NO_BLOCK;
+
+        block->samples = &acq_dma_buffer[acq_owned_half * ACQ_BLOCK_SIZE];
+        block->length = ACQ_BLOCK_SIZE;
+        block->sequence = acq_pending_sequence;
+        has_block = true;
+    }
+    PLATFORM_irq_enable();
+
+    return has_block;
+}
+
+/**
+ * Waits (in sleep mode) until the next block is available.
+ * @param block: see ACQ_get_block()
+ * @param timeout_ms: maximum time to wait
+ * @return false on timeout or if the acquisition is not running
+ */
+bool ACQ_wait_block(ACQ_block *block, uint32_t timeout_ms)
+{
+    uint32_t start = PLATFORM_get_tick_ms();
+
+    while (acq_is_running)
+    {
+        if (ACQ_get_block(block))
+            return true;
+        if (PLATFORM_get_tick_ms() - start >= timeout_ms)
+            return false;
+        PLATFORM_wait_for_interrupt(); // the DMA interrupt wakes us up
+    }
+    return false;
+}
+
+/**
+ * Hands the current block back to the DMA.
+ * @return false if the DMA already started overwriting the block while it was
+ *         processed, i.e. the results computed from it must be discarded
+ */
+bool ACQ_release_block()
+{
+    bool was_intact;
+
+    PLATFORM_irq_disable();
+    was_intact = !acq_owned_half_overwritten;
+    acq_owned_half = ACQ_NO_BLOCK;
+    acq_owned_half_overwritten = false;
+    PLATFORM_irq_enable();
+
+    return was_intact;
+}
+
+/**
+ * Index of the sample the ADC converts next, counted from ACQ_start(). The
+ * block with sequence s holds the samples (s - 1) * ACQ_BLOCK_SIZE up to
+ * s * ACQ_BLOCK_SIZE - 1, so a DAC step can be placed inside a block.
+ */
+uint32_t ACQ_get_sample_index()
+{
+    uint32_t position;
+    uint32_t sequence;
+
+    PLATFORM_irq_disable();
+    position = PLATFORM_adc_get_position();
+    sequence = acq_sequence;
+    PLATFORM_irq_enable();
+
+    // after s completions the DMA writes into half s % 2, unless it crossed
+    // into the next half and the interrupt is still pending
+    if (position / ACQ_BLOCK_SIZE != sequence % 2)
+        sequence++;
+    return sequence * ACQ_BLOCK_SIZE + position % ACQ_BLOCK_SIZE;
+}
+
+uint32_t ACQ_get_overrun_count()
+{
+    return acq_overrun_count;
+}
+
+void ACQ_reset_overrun_count()
+{
+    acq_overrun_count = 0;
+}
+
+/**
+ * Bookkeeping of the ping-pong buffer. Must be called with interrupts masked
+ * or from the DMA interrupt itself.
+ * @param half: 0 after the half transfer, 1 after the transfer complete event
+ */
+void ACQ_on_dma_block_complete(uint8_t half)
+{
+    acq_sequence++;
+
+    // the DMA continues with the other half -> the application must be done with it
+    if (acq_owned_half == (half ^ 1u))
+    {
+        acq_owned_half_overwritten = true;
+        acq_overrun_count++;
+    }
+
+    // previous block was never fetched -> it is lost
+    if (acq_pending_half != ACQ_NO_BLOCK)
+        acq_overrun_count++;
+
+    if (acq_owned_half == half)
+    {
+        // the application still holds this half although the DMA wrapped around once
+        acq_owned_half_overwritten = true;
+        acq_overrun_count++;
+        acq_pending_half = ACQ_NO_BLOCK;
+        return;
+    }
+
+    acq_pending_half = half;
+    acq_pending_sequence = acq_sequence;
+}
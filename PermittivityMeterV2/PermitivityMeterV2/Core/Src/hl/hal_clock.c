@@ -0,0 +1,71 @@
+#include "hal_clock.h"
+#include "main.h"
+#include "meas_config.h"
+
+/*
+ * SystemClock_Config() runs the PLL from HSI. For coherent sampling the ADC
+ * trigger timer has to be derived from the same 20 MHz HSE crystal that drives
+ * MCO1, so the PLL is moved over to HSE here.
+ *
+ * HSE 20 MHz / M 2 * N 16 = 160 MHz VCO, / R 2 = 80 MHz SYSCLK
+ */
+
+// ###### defines
+
+#define CLOCK_PLLM 2
+#define CLOCK_PLLN 16
+
+#if (MEAS_EXCITATION_HZ / CLOCK_PLLM * CLOCK_PLLN / 2) != ACQ_TRIGGER_CLOCK_HZ
+#error "PLL settings do not match ACQ_TRIGGER_CLOCK_HZ"
+#endif
+
+// ###### functions
+
+/**
+ * Switches SYSCLK (and with it every timer clock) to the HSE-locked PLL.
+ * Must be called before the peripherals are initialized, because their
+ * dividers (UART baud rate, ...) are computed from the clock at init time.
+ */
+void CLOCK_config_coherent()
+{
+    RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+    RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+    // the PLL can not be reconfigured while it is the system clock -> run from HSI meanwhile
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_SYSCLK;
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_OFF;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+    RCC_OscInitStruct.PLL.PLLM = CLOCK_PLLM;
+    RCC_OscInitStruct.PLL.PLLN = CLOCK_PLLN;
+    RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV7;
+    RCC_OscInitStruct.PLL.PLLQ = RCC_PLLQ_DIV2;
+    RCC_OscInitStruct.PLL.PLLR = RCC_PLLR_DIV2;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK
+                                | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+    RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+    RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
@@ -0,0 +1,38 @@
+#include "hal_gain.h"
+#include "platform.h"
+
+/*
+ * Gain of the OPA2690 stages, selected with GAIN_SLCT_1 (PC8) / GAIN_SLCT_2 (PC9).
+ * 1x: both low, 10x: GAIN_SLCT_1 high, 100x: both high
+ */
+
+// ###### global variables
+
+static GAIN_setting gain_current = GAIN_1X;
+
+// ###### functions
+
+void GAIN_set(GAIN_setting gain)
+{
+    PLATFORM_pin_write(PLATFORM_PIN_GAIN_SLCT_1, gain != GAIN_1X);
+    PLATFORM_pin_write(PLATFORM_PIN_GAIN_SLCT_2, gain == GAIN_100X);
+    gain_current = gain;
+}
+
+GAIN_setting GAIN_get()
+{
+    return gain_current;
+}
+
+float GAIN_get_factor()
+{
+    switch (gain_current)
+    {
+    case GAIN_10X:
+        return 10.0f;
+    case GAIN_100X:
+        return 100.0f;
+    default:
+        return 1.0f;
+    }
+}
@@ -0,0 +1,152 @@
+#include "hal_nina.h"
+#include <string.h>
+#include "hal_serial.h"
+#include "platform.h"
+
+/*
+ * UART side of the NINA-W1 module, ported from the MSP430 code
+ * ("NINA software von okorn"). Transmissions are queued in hal_serial.c and
+ * return immediately instead of waiting for every byte. Received bytes are
+ * run through the AT parser once, callers get tokens instead of searching
+ * the receive buffer for every possible response.
+ * The board has no supply switch for the module, "power off" holds it in
+ * reset and sets NINA_STOP (low-power mode, low while running, the level
+ * from MX_GPIO_Init()). Its DSR input is driven by NINA_DTR, the pulse length is timed by
+ * the one shot timer instead of counted main loop cycles.
+ */
+
+// ###### defines
+
+#define NINA_RX_CHUNK_SIZE 32
+
+// ###### global variables
+
+static AT_parser nina_parser;
+static uint8_t nina_rx_chunk[NINA_RX_CHUNK_SIZE]; // read from hal_serial.c, not yet parsed
+static uint8_t nina_rx_chunk_length = 0;
+static uint8_t nina_rx_chunk_index = 0;
+static bool nina_is_powered_on = false;
+static volatile bool nina_is_dtr_pulse_done = true;
+
+// ###### private functions
+
+static void NINA_on_dtr_pulse_end()
+{
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_DTR, false);
+    nina_is_dtr_pulse_done = true;
+}
+
+// ###### functions
+
+void NINA_init()
+{
+    AT_parser_init(&nina_parser);
+    nina_rx_chunk_length = 0;
+    nina_rx_chunk_index = 0;
+    SERIAL_init();
+}
+
+/**
+ * Queues the string for transmission via UART4.
+ * @return false if the transmit buffer is full, nothing is sent then
+ */
+bool NINA_send_string(const char *string)
+{
+    return NINA_send_bytes(string, (uint16_t)strlen(string));
+}
+
+bool NINA_send_bytes(const char *buffer, uint16_t length)
+{
+    return SERIAL_write((const uint8_t *)buffer, length);
+}
+
+/**
+ * Parses received bytes up to the next complete token, never waits.
+ * @param token: text stays valid until the next call
+ * @return false if no complete token has been received yet
+ */
+bool NINA_get_token(AT_token *token)
+{
+    while (true)
+    {
+        if (nina_rx_chunk_index == nina_rx_chunk_length)
+        {
+            nina_rx_chunk_length = (uint8_t)SERIAL_read(nina_rx_chunk, NINA_RX_CHUNK_SIZE);
+            nina_rx_chunk_index = 0;
+            if (nina_rx_chunk_length == 0)
+                return false;
+        }
+        if (AT_parser_feed(&nina_parser, nina_rx_chunk[nina_rx_chunk_index++], token))
+            return true;
+    }
+}
+
+/**
+ * Tells the parser whether the following bytes are AT responses or peer data.
+ * Call it when the mode switch has been confirmed (OK of ATO1 / DSR toggle).
+ */
+void NINA_set_data_mode(bool data_mode)
+{
+    AT_parser_set_data_mode(&nina_parser, data_mode);
+}
+
+void NINA_power_off()
+{
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_RST, false);
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_DTR, false);
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_STOP, true);
+    nina_is_powered_on = false;
+}
+
+void NINA_power_on()
+{
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_STOP, false);
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_RST, true);
+    nina_is_powered_on = true;
+}
+
+bool NINA_is_powered_on()
+{
+    return nina_is_powered_on;
+}
+
+/**
+ * Pulls the reset line for 1 ms, the module answers with +STARTUP after booting.
+ * A partially parsed line is dropped, the module starts in command mode.
+ */
+void NINA_reset()
+{
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_RST, false);
+    PLATFORM_delay_ms(1);
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_RST, true);
+    nina_is_powered_on = true;
+    AT_parser_set_data_mode(&nina_parser, false);
+}
+
+/**
+ * Raises DTR (DSR of the module) for duration_ms, the falling edge switches
+ * the module from data mode to command mode.
+ */
+void NINA_start_dtr_pulse(uint16_t duration_ms)
+{
+    nina_is_dtr_pulse_done = false;
+    PLATFORM_pin_write(PLATFORM_PIN_NINA_DTR, true);
+    PLATFORM_timer_start(duration_ms, NINA_on_dtr_pulse_end);
+}
+
+bool NINA_is_dtr_pulse_done()
+{
+    return nina_is_dtr_pulse_done;
+}
+
+// the module drives its status LEDs active low
+
+bool NINA_is_led_red_on()
+{
+    return !PLATFORM_pin_read(PLATFORM_PIN_NINA_LED_RED);
+}
+
+bool NINA_is_led_blue_on()
+{
+    return !PLATFORM_pin_read(PLATFORM_PIN_NINA_LED_BLUE);
+}
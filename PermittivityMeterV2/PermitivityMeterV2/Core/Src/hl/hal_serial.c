@@ -0,0 +1,298 @@
+#include "hal_serial.h"
+#include <stddef.h>
+#include "platform.h"
+
+/*
+ * Asynchronous transmit and receive path of UART4 (NINA link).
+ * Writes are copied into a ring buffer and return immediately. The DMA sends
+ * the longest contiguous part of the buffer, its completion interrupt starts
+ * the next part, so a frame that wraps around the end takes two transfers.
+ * Only the writer moves the head and only the completion moves the tail.
+ * Reception runs continuously into a circular DMA buffer. Half, full and
+ * idle line events publish the DMA write position, SERIAL_read() copies out
+ * what arrived since the last call. Nothing is parsed in the interrupt.
+ */
+
+// ###### typedefs
+
+typedef struct
+{
+    SERIAL_tx_callback callback;
+    void *context;
+    uint32_t end; // value of serial_tx_total_sent once the write is out
+} SERIAL_pending_callback;
+
+// ###### global variables
+
+static uint8_t serial_tx_buffer[SERIAL_TX_BUFFER_SIZE];
+static volatile uint16_t serial_tx_head = 0;  // next byte written by SERIAL_write()
+static volatile uint16_t serial_tx_tail = 0;  // first byte not yet sent
+static volatile uint16_t serial_tx_count = 0; // bytes queued, including the running transfer
+static volatile uint16_t serial_tx_active = 0; // length of the running DMA transfer, 0 = idle
+
+static volatile uint32_t serial_tx_total_queued = 0;
+static volatile uint32_t serial_tx_total_sent = 0;
+static volatile uint32_t serial_tx_dropped = 0;
+
+static SERIAL_pending_callback serial_callbacks[SERIAL_TX_CALLBACK_SLOTS];
+static volatile uint8_t serial_callback_count = 0;
+
+static uint8_t serial_rx_buffer[SERIAL_RX_BUFFER_SIZE];
+static volatile uint16_t serial_rx_head = 0;  // next byte the DMA writes
+static volatile uint16_t serial_rx_tail = 0;  // next byte returned by SERIAL_read()
+static volatile uint16_t serial_rx_count = 0; // bytes between tail and head
+static volatile uint32_t serial_rx_overruns = 0;
+
+static uint32_t serial_baud_rate = SERIAL_BAUD_RATE_DEFAULT;
+
+// ###### private functions
+
+/**
+ * Starts the DMA on the contiguous part behind the tail.
+ * Must be called with interrupts masked or from the completion interrupt.
+ */
+static void SERIAL_start_next_transfer()
+{
+    uint16_t length;
+
+    if (serial_tx_active != 0 || serial_tx_count == 0)
+        return;
+
+    length = SERIAL_TX_BUFFER_SIZE - serial_tx_tail;
+    if (length > serial_tx_count)
+        length = serial_tx_count;
+
+    serial_tx_active = length;
+    PLATFORM_uart_transmit_start(&serial_tx_buffer[serial_tx_tail], length);
+}
+
+// ###### functions
+
+void SERIAL_init()
+{
+    serial_tx_head = 0;
+    serial_tx_tail = 0;
+    serial_tx_count = 0;
+    serial_tx_active = 0;
+    serial_callback_count = 0;
+    serial_rx_head = 0;
+    serial_rx_tail = 0;
+    serial_rx_count = 0;
+    serial_baud_rate = SERIAL_BAUD_RATE_DEFAULT;
+    PLATFORM_uart_init();
+    PLATFORM_uart_receive_start(serial_rx_buffer, SERIAL_RX_BUFFER_SIZE);
+}
+
+/**
+ * Queues data for transmission and returns immediately.
+ * @return false if the data does not fit into the buffer, nothing is queued then
+ */
+bool SERIAL_write(const uint8_t *data, uint16_t length)
+{
+    return SERIAL_write_with_callback(data, length, NULL, NULL);
+}
+
+/**
+ * Same as SERIAL_write(), callback is called from the interrupt once the last
+ * byte of this write has been handed to the UART.
+ */
+bool SERIAL_write_with_callback(const uint8_t *data, uint16_t length, SERIAL_tx_callback callback, void *context)
+{
+    uint16_t head = serial_tx_head;
+    uint16_t i;
+
+    if (length == 0)
+        return true;
+    if (length > SERIAL_TX_BUFFER_SIZE - serial_tx_count
+        || (callback != NULL && serial_callback_count >= SERIAL_TX_CALLBACK_SLOTS))
+    {
+        serial_tx_dropped++;
+        return false;
+    }
+
+    // the space behind the head is ours, the DMA only reads behind the tail
+    for (i = 0; i < length; i++)
+    {
+        serial_tx_buffer[head] = data[i];
+        head = (head + 1 == SERIAL_TX_BUFFER_SIZE) ? 0 : head + 1;
+    }
+
+    PLATFORM_irq_disable();
+    serial_tx_head = head;
+    serial_tx_count += length;
+    serial_tx_total_queued += length;
+    if (callback != NULL)
+    {
+        serial_callbacks[serial_callback_count].callback = callback;
+        serial_callbacks[serial_callback_count].context = context;
+        serial_callbacks[serial_callback_count].end = serial_tx_total_queued;
+        serial_callback_count++;
+    }
+    SERIAL_start_next_transfer();
+    PLATFORM_irq_enable();
+
+    return true;
+}
+
+uint16_t SERIAL_get_tx_free()
+{
+    return SERIAL_TX_BUFFER_SIZE - serial_tx_count;
+}
+
+bool SERIAL_is_tx_idle()
+{
+    return serial_tx_count == 0;
+}
+
+/**
+ * Waits (in sleep mode) until everything queued has been sent.
+ * @return false on timeout
+ */
+bool SERIAL_flush(uint32_t timeout_ms)
+{
+    uint32_t start = PLATFORM_get_tick_ms();
+
+    while (serial_tx_count != 0)
+    {
+        if (PLATFORM_get_tick_ms() - start >= timeout_ms)
+            return false;
+        PLATFORM_wait_for_interrupt();
+    }
+    return true;
+}
+
+uint32_t SERIAL_get_tx_dropped()
+{
+    return serial_tx_dropped;
+}
+
+/**
+ * Changes the baud rate of UART4. Unread received bytes are dropped, they were
+ * sent at the old rate.
+ * @return false if a transmission is still running, nothing is changed then
+ */
+bool SERIAL_set_baud_rate(uint32_t baud_rate)
+{
+    if (serial_tx_count != 0)
+        return false;
+    if (baud_rate == serial_baud_rate)
+        return true;
+
+    PLATFORM_uart_set_baud_rate(baud_rate);
+    serial_baud_rate = baud_rate;
+    serial_rx_head = 0;
+    serial_rx_tail = 0;
+    serial_rx_count = 0;
+    PLATFORM_uart_receive_start(serial_rx_buffer, SERIAL_RX_BUFFER_SIZE);
+    return true;
+}
+
+uint32_t SERIAL_get_baud_rate()
+{
+    return serial_baud_rate;
+}
+
+/**
+ * Completion of the running transfer: releases its bytes, calls the callbacks
+ * of finished writes and chains the next transfer.
+ */
+void SERIAL_on_tx_complete()
+{
+    uint16_t length = serial_tx_active;
+    uint8_t done = 0;
+    uint8_t i;
+
+    serial_tx_tail = (uint16_t)((serial_tx_tail + length) % SERIAL_TX_BUFFER_SIZE);
+    serial_tx_count -= length;
+    serial_tx_total_sent += length;
+    serial_tx_active = 0;
+
+    SERIAL_start_next_transfer();
+
+    // callbacks are queued in write order, the finished ones are at the front
+    while (done < serial_callback_count && (int32_t)(serial_tx_total_sent - serial_callbacks[done].end) >= 0)
+        done++;
+    if (done == 0)
+        return;
+
+    for (i = 0; i < done; i++)
+        serial_callbacks[i].callback(serial_callbacks[i].context);
+    for (i = done; i < serial_callback_count; i++)
+        serial_callbacks[i - done] = serial_callbacks[i];
+    serial_callback_count -= done;
+}
+
+/**
+ * Copies received bytes out of the DMA buffer, never waits.
+ * @return number of bytes copied
+ */
+uint16_t SERIAL_read(uint8_t *data, uint16_t max_length)
+{
+    uint32_t overruns = serial_rx_overruns;
+    uint16_t tail = serial_rx_tail;
+    uint16_t length = serial_rx_count;
+    uint16_t i;
+
+    if (length > max_length)
+        length = max_length;
+    for (i = 0; i < length; i++)
+    {
+        data[i] = serial_rx_buffer[tail];
+        tail = (tail + 1 == SERIAL_RX_BUFFER_SIZE) ? 0 : tail + 1;
+    }
+
+    PLATFORM_irq_disable();
+    if (overruns != serial_rx_overruns)
+        length = 0; // the DMA has overwritten the bytes while they were copied
+    else
+    {
+        serial_rx_tail = tail;
+        serial_rx_count -= length;
+    }
+    PLATFORM_irq_enable();
+
+    return length;
+}
+
+uint16_t SERIAL_get_rx_available()
+{
+    return serial_rx_count;
+}
+
+uint32_t SERIAL_get_rx_overruns()
+{
+    return serial_rx_overruns;
+}
+
+void SERIAL_on_rx_event(uint16_t position)
+{
+    uint16_t received;
+
+    if (position >= SERIAL_RX_BUFFER_SIZE)
+        position = 0;
+    received = (uint16_t)((position + SERIAL_RX_BUFFER_SIZE - serial_rx_head) % SERIAL_RX_BUFFER_SIZE);
+    serial_rx_head = position;
+
+    // the DMA has overwritten unread bytes: keep the newest SERIAL_RX_BUFFER_SIZE - 1
+    if (serial_rx_count + received >= SERIAL_RX_BUFFER_SIZE)
+    {
+        serial_rx_overruns++;
+        serial_rx_count = SERIAL_RX_BUFFER_SIZE - 1;
+        serial_rx_tail = (position + 1 == SERIAL_RX_BUFFER_SIZE) ? 0 : position + 1;
+        return;
+    }
+    serial_rx_count += received;
+}
+
+/**
+ * A framing/noise/overrun error aborts the DMA reception. Unread bytes are
+ * dropped and the reception starts again at the beginning of the buffer.
+ */
+void SERIAL_on_rx_error()
+{
+    serial_rx_overruns++;
+    serial_rx_head = 0;
+    serial_rx_tail = 0;
+    serial_rx_count = 0;
+    PLATFORM_uart_receive_start(serial_rx_buffer, SERIAL_RX_BUFFER_SIZE);
+}
@@ -0,0 +1,162 @@
+#include "hal_sweep.h"
+#include "main.h"
+#include "hal_acq.h"
+
+/*
+ * Hardware DAC staircase, paced by the ADC sample clock.
+ * TIM7 runs from the same 80 MHz as the ADC trigger TIM6, prescaled by
+ * ACQ_TRIGGER_DIVIDER so it counts ADC samples. Every TUNING_SWEEP_SAMPLES_PER_STEP
+ * samples its TRGO latches the next code of the table into the DAC, and the
+ * DMA reloads the holding register behind it. The whole curve is captured
+ * without any CPU involvement, the samples of step k are the k-th
+ * TUNING_SWEEP_SAMPLES_PER_STEP samples of the acquisition.
+ *
+ * DAC trigger, DHR -> DOR on trigger k, then the DMA writes code k + 1 into DHR:
+ *
+ *   DHR  | code 0 | code 1      | code 2      | ...
+ *   DOR  | old    | code 0      | code 1      | ...
+ *   ADC  |        ^ sample 0    ^ sample 256  ^ sample 512
+ */
+
+#if ACQ_COHERENT_SAMPLING
+
+// ###### extern variables from main.c
+
+extern DAC_HandleTypeDef hdac1;
+
+// ###### global variables
+
+static TIM_HandleTypeDef sweep_htim;
+static DMA_HandleTypeDef sweep_hdma_dac_ch1;
+static DMA_HandleTypeDef sweep_hdma_dac_ch2;
+
+static uint32_t sweep_channel = DAC_CHANNEL_1;
+
+// ###### private functions
+
+static void SWEEP_init_dma(DMA_HandleTypeDef *hdma, DMA_Channel_TypeDef *instance, uint32_t request)
+{
+    hdma->Instance = instance;
+    hdma->Init.Request = request;
+    hdma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_MEDIUM;
+    if (HAL_DMA_Init(hdma) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/**
+ * Switches the trigger of the sweep channel. TSEL can only be changed while
+ * the channel is disabled.
+ */
+static void SWEEP_config_trigger(uint32_t trigger)
+{
+    DAC_ChannelConfTypeDef sConfig = {0};
+
+    sConfig.DAC_SampleAndHold = DAC_SAMPLEANDHOLD_DISABLE;
+    sConfig.DAC_Trigger = trigger;
+    sConfig.DAC_OutputBuffer = DAC_OUTPUTBUFFER_ENABLE;
+    sConfig.DAC_ConnectOnChipPeripheral = DAC_CHIPCONNECT_DISABLE;
+    sConfig.DAC_UserTrimming = DAC_TRIMMING_FACTORY;
+    if (HAL_DAC_ConfigChannel(&hdac1, &sConfig, sweep_channel) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+// ###### functions
+
+/**
+ * Sets up TIM7 as sample counter and the DMA channels of both DAC outputs
+ * (DMA1 channel 3 / 4). Call after ACQ_init().
+ */
+void SWEEP_init()
+{
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+    __HAL_RCC_TIM7_CLK_ENABLE();
+
+    sweep_htim.Instance = TIM7;
+    sweep_htim.Init.Prescaler = ACQ_TRIGGER_DIVIDER - 1; // one count per ADC sample
+    sweep_htim.Init.CounterMode = TIM_COUNTERMODE_UP;
+    sweep_htim.Init.Period = TUNING_SWEEP_SAMPLES_PER_STEP - 1;
+    sweep_htim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_Base_Init(&sweep_htim) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(&sweep_htim, &sMasterConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    SWEEP_init_dma(&sweep_hdma_dac_ch1, DMA1_Channel3, DMA_REQUEST_6);
+    __HAL_LINKDMA(&hdac1, DMA_Handle1, sweep_hdma_dac_ch1);
+    SWEEP_init_dma(&sweep_hdma_dac_ch2, DMA1_Channel4, DMA_REQUEST_5);
+    __HAL_LINKDMA(&hdac1, DMA_Handle2, sweep_hdma_dac_ch2);
+}
+
+/**
+ * Restarts the acquisition together with a DAC staircase.
+ * Step k holds codes[k] for TUNING_SWEEP_SAMPLES_PER_STEP samples, starting
+ * with the first sample of the first block.
+ * @param dac_output: 0 = DAC1 OUT1 (FRQ_TN), 1 = DAC1 OUT2 (Q_FACT_TN)
+ * @param codes: 12-bit codes, must stay valid until SWEEP_stop()
+ * @param length: number of steps (at least 2)
+ */
+void SWEEP_start(uint8_t dac_output, const uint16_t *codes, uint16_t length)
+{
+    sweep_channel = (dac_output == 0) ? DAC_CHANNEL_1 : DAC_CHANNEL_2;
+
+    ACQ_stop();
+
+    // reset the prescaler (the update also pulses TRGO, the DAC trigger is still off)
+    HAL_TIM_Base_Stop(&sweep_htim);
+    sweep_htim.Instance->EGR = TIM_EGR_UG;
+    // first update together with the first TIM6 update = ADC sample 0
+    __HAL_TIM_SET_COUNTER(&sweep_htim, TUNING_SWEEP_SAMPLES_PER_STEP - 1);
+
+    HAL_DAC_Stop(&hdac1, sweep_channel);
+    SWEEP_config_trigger(DAC_TRIGGER_T7_TRGO);
+    if (HAL_DAC_SetValue(&hdac1, sweep_channel, DAC_ALIGN_12B_R, codes[0]) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    if (HAL_DAC_Start_DMA(&hdac1, sweep_channel, (uint32_t *)&codes[1], length - 1, DAC_ALIGN_12B_R) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    // both timers count the same clock, started a few CPU cycles apart
+    ACQ_arm();
+    __disable_irq();
+    __HAL_TIM_ENABLE(&sweep_htim);
+    ACQ_start();
+    __enable_irq();
+}
+
+/**
+ * Stops the staircase, the DAC keeps the last code and is switched back to
+ * software updates. The acquisition keeps running.
+ */
+void SWEEP_stop()
+{
+    HAL_TIM_Base_Stop(&sweep_htim);
+    HAL_DAC_Stop_DMA(&hdac1, sweep_channel);
+    SWEEP_config_trigger(DAC_TRIGGER_NONE);
+    if (HAL_DAC_Start(&hdac1, sweep_channel) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+#endif
@@ -0,0 +1,488 @@
+#include "platform.h"
+#include <string.h>
+#include "main.h"
+#include "meas_config.h"
+#include "hal_acq.h"
+#include "hal_serial.h"
+
+/*
+ * STM32L476 implementation of platform.h on top of the CubeMX handles.
+ */
+
+// ###### extern variables from main.c
+
+extern ADC_HandleTypeDef hadc1;
+extern DAC_HandleTypeDef hdac1;
+extern UART_HandleTypeDef huart4;
+
+// ###### defines
+
+#define PLATFORM_NO_ECC_ERROR UINT32_MAX
+
+// ###### typedefs
+
+typedef struct
+{
+    GPIO_TypeDef *port;
+    uint16_t pin;
+} PLATFORM_gpio;
+
+// ###### global variables
+
+static const PLATFORM_gpio platform_pins[PLATFORM_PIN_COUNT] = {
+    [PLATFORM_PIN_STATUS_LED] = {STATUS_LED_GPIO_Port, STATUS_LED_Pin},
+    [PLATFORM_PIN_MEAS_LED] = {MEAS_LED_GPIO_Port, MEAS_LED_Pin},
+    [PLATFORM_PIN_ERR_LED] = {ERR_LED_GPIO_Port, ERR_LED_Pin},
+    [PLATFORM_PIN_GAIN_SLCT_1] = {GAIN_SLCT_1_GPIO_Port, GAIN_SLCT_1_Pin},
+    [PLATFORM_PIN_GAIN_SLCT_2] = {GAIN_SLCT_2_GPIO_Port, GAIN_SLCT_2_Pin},
+    [PLATFORM_PIN_NINA_RST] = {NINA_RST_GPIO_Port, NINA_RST_Pin},
+    [PLATFORM_PIN_NINA_STOP] = {NINA_STOP_GPIO_Port, NINA_STOP_Pin},
+    [PLATFORM_PIN_NINA_DTR] = {NINA_DTR_GPIO_Port, NINA_DTR_Pin},
+    [PLATFORM_PIN_NINA_LED_RED] = {NINA_LED_RED_GPIO_Port, NINA_LED_RED_Pin},
+    [PLATFORM_PIN_NINA_LED_BLUE] = {NINA_LED_BLUE_GPIO_Port, NINA_LED_BLUE_Pin},
+};
+
+#if ACQ_COHERENT_SAMPLING
+static TIM_HandleTypeDef platform_htim_adc_trigger;
+#endif
+static uint32_t platform_adc_length = 0;
+
+// serviced in stm32l4xx_it.c
+DMA_HandleTypeDef hdma_uart4_tx;
+DMA_HandleTypeDef hdma_uart4_rx;
+TIM_HandleTypeDef htim15;
+
+static volatile PLATFORM_timer_callback platform_timer_callback = NULL;
+static volatile bool platform_is_button_pressed = false;
+static volatile uint32_t platform_flash_ecc_offset = PLATFORM_NO_ECC_ERROR; // set by PLATFORM_on_nmi()
+
+// ###### functions
+
+uint32_t PLATFORM_get_tick_ms()
+{
+    return HAL_GetTick();
+}
+
+void PLATFORM_delay_ms(uint32_t delay_ms)
+{
+    HAL_Delay(delay_ms);
+}
+
+void PLATFORM_wait_for_interrupt()
+{
+    __WFI();
+}
+
+/**
+ * Enables the DWT cycle counter on the first call.
+ */
+uint32_t PLATFORM_get_cycle_count()
+{
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+void PLATFORM_irq_disable()
+{
+    __disable_irq();
+}
+
+void PLATFORM_irq_enable()
+{
+    __enable_irq();
+}
+
+void PLATFORM_fatal_error()
+{
+    Error_Handler();
+}
+
+void PLATFORM_pin_write(PLATFORM_pin pin, bool level)
+{
+    HAL_GPIO_WritePin(platform_pins[pin].port, platform_pins[pin].pin, level ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+void PLATFORM_pin_toggle(PLATFORM_pin pin)
+{
+    HAL_GPIO_TogglePin(platform_pins[pin].port, platform_pins[pin].pin);
+}
+
+bool PLATFORM_pin_read(PLATFORM_pin pin)
+{
+    return HAL_GPIO_ReadPin(platform_pins[pin].port, platform_pins[pin].pin) == GPIO_PIN_SET;
+}
+
+/**
+ * TIM15 in one pulse mode at 10 kHz (0.1 ms resolution, up to 6.5 s).
+ * A running timer is restarted with the new duration.
+ */
+void PLATFORM_timer_start(uint16_t duration_ms, PLATFORM_timer_callback callback)
+{
+    uint32_t ticks = (uint32_t)duration_ms * 10;
+
+    if (ticks == 0)
+        ticks = 1;
+    if (ticks > 0x10000)
+        ticks = 0x10000;
+
+    if (htim15.Instance == NULL)
+    {
+        __HAL_RCC_TIM15_CLK_ENABLE();
+        htim15.Instance = TIM15;
+        htim15.Init.Prescaler = (HAL_RCC_GetPCLK2Freq() / 10000) - 1; // APB2 prescaler is 1, timer clock = PCLK2
+        htim15.Init.CounterMode = TIM_COUNTERMODE_UP;
+        htim15.Init.Period = 0xFFFF;
+        htim15.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+        htim15.Init.RepetitionCounter = 0;
+        htim15.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+        if (HAL_TIM_OnePulse_Init(&htim15, TIM_OPMODE_SINGLE) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        HAL_NVIC_SetPriority(TIM1_BRK_TIM15_IRQn, 2, 0);
+        HAL_NVIC_EnableIRQ(TIM1_BRK_TIM15_IRQn);
+    }
+
+    HAL_TIM_Base_Stop_IT(&htim15);
+    platform_timer_callback = callback;
+    __HAL_TIM_SET_AUTORELOAD(&htim15, ticks - 1);
+    __HAL_TIM_SET_COUNTER(&htim15, 0);
+    __HAL_TIM_CLEAR_FLAG(&htim15, TIM_FLAG_UPDATE);
+    if (HAL_TIM_Base_Start_IT(&htim15) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+void PLATFORM_timer_stop()
+{
+    if (htim15.Instance != NULL)
+        HAL_TIM_Base_Stop_IT(&htim15);
+    platform_timer_callback = NULL;
+}
+
+void PLATFORM_dac_write(uint8_t channel, uint16_t code)
+{
+    uint32_t dac_channel = (channel == 0) ? DAC_CHANNEL_1 : DAC_CHANNEL_2;
+
+    if (HAL_DAC_SetValue(&hdac1, dac_channel, DAC_ALIGN_12B_R, code) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    if (HAL_DAC_Start(&hdac1, dac_channel) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/**
+ * Finishes the ADC1 setup of MX_ADC1_Init() for the selected sampling mode.
+ * In coherent mode ADC1 is switched from free running conversions to one
+ * conversion per TIM6 update event (TRGO). The ADC clock is taken
+ * synchronously from HCLK, so the trigger to sample delay is constant.
+ */
+void PLATFORM_adc_init()
+{
+#if ACQ_COHERENT_SAMPLING
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+    hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    hadc1.Init.ContinuousConvMode = DISABLE;
+    hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIG_T6_TRGO;
+    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    if (HAL_ADC_Init(&hadc1) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    __HAL_RCC_TIM6_CLK_ENABLE();
+
+    platform_htim_adc_trigger.Instance = TIM6;
+    platform_htim_adc_trigger.Init.Prescaler = 0;
+    platform_htim_adc_trigger.Init.CounterMode = TIM_COUNTERMODE_UP;
+    platform_htim_adc_trigger.Init.Period = ACQ_TRIGGER_DIVIDER - 1;
+    platform_htim_adc_trigger.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_Base_Init(&platform_htim_adc_trigger) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(&platform_htim_adc_trigger, &sMasterConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+#endif
+}
+
+/**
+ * Calibrates ADC1 and starts the circular DMA. In coherent mode the ADC then
+ * waits for the first TIM6 trigger, otherwise the conversions start right away.
+ */
+void PLATFORM_adc_arm(uint16_t *buffer, uint32_t length)
+{
+    if (HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    platform_adc_length = length;
+    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t *)buffer, length) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+void PLATFORM_adc_trigger_start()
+{
+#if ACQ_COHERENT_SAMPLING
+    // ADC is armed now, the first trigger starts the sampling
+    __HAL_TIM_SET_COUNTER(&platform_htim_adc_trigger, 0);
+    if (HAL_TIM_Base_Start(&platform_htim_adc_trigger) != HAL_OK)
+    {
+        Error_Handler();
+    }
+#endif
+}
+
+void PLATFORM_adc_stop()
+{
+#if ACQ_COHERENT_SAMPLING
+    HAL_TIM_Base_Stop(&platform_htim_adc_trigger);
+#endif
+    HAL_ADC_Stop_DMA(&hadc1);
+}
+
+/**
+ * The DMA counts the transfers left until the circular buffer wraps (CNDTR),
+ * it is reloaded with the length on the wrap.
+ */
+uint32_t PLATFORM_adc_get_position()
+{
+    uint32_t remaining = __HAL_DMA_GET_COUNTER(hadc1.DMA_Handle);
+
+    return (remaining < platform_adc_length) ? platform_adc_length - remaining : 0;
+}
+
+/**
+ * Links DMA2 channel 3 (request 2 = UART4_TX) and channel 5 (request 2 =
+ * UART4_RX) to huart4. The TX DMA moves the bytes, the UART4 interrupt
+ * signals the end of the last stop bit and the idle line after reception.
+ */
+void PLATFORM_uart_init()
+{
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    hdma_uart4_tx.Instance = DMA2_Channel3;
+    hdma_uart4_tx.Init.Request = DMA_REQUEST_2;
+    hdma_uart4_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_uart4_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_uart4_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_uart4_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_uart4_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_uart4_tx.Init.Mode = DMA_NORMAL;
+    hdma_uart4_tx.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_uart4_tx) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    __HAL_LINKDMA(&huart4, hdmatx, hdma_uart4_tx);
+
+    hdma_uart4_rx.Instance = DMA2_Channel5;
+    hdma_uart4_rx.Init.Request = DMA_REQUEST_2;
+    hdma_uart4_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_uart4_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_uart4_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_uart4_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_uart4_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_uart4_rx.Init.Mode = DMA_CIRCULAR;
+    hdma_uart4_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+    if (HAL_DMA_Init(&hdma_uart4_rx) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    __HAL_LINKDMA(&huart4, hdmarx, hdma_uart4_rx);
+
+    // below the ADC DMA (priority 0), a late UART completion only delays the next chunk
+    HAL_NVIC_SetPriority(DMA2_Channel3_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Channel3_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Channel5_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Channel5_IRQn);
+    HAL_NVIC_SetPriority(UART4_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(UART4_IRQn);
+}
+
+void PLATFORM_uart_transmit_start(const uint8_t *data, uint16_t length)
+{
+    if (HAL_UART_Transmit_DMA(&huart4, (uint8_t *)data, length) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+void PLATFORM_uart_set_baud_rate(uint32_t baud_rate)
+{
+    if (HAL_UART_AbortReceive(&huart4) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    // gState is READY, HAL_UART_Init() only rewrites the configuration (BRR), MSP and DMA links stay
+    huart4.Init.BaudRate = baud_rate;
+    if (HAL_UART_Init(&huart4) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+void PLATFORM_uart_receive_start(uint8_t *buffer, uint16_t length)
+{
+    if (HAL_UARTEx_ReceiveToIdle_DMA(&huart4, buffer, length) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/**
+ * B1 is configured for a falling edge interrupt by CubeMX, only its IRQ is
+ * enabled here (handler in stm32l4xx_it.c).
+ */
+void PLATFORM_button_init()
+{
+    platform_is_button_pressed = false;
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+}
+
+bool PLATFORM_button_fetch_press()
+{
+    bool is_pressed = platform_is_button_pressed;
+
+    // bouncing only sets the flag again
+    platform_is_button_pressed = false;
+    return is_pressed;
+}
+
+/**
+ * Copies from the memory mapped region. A double ECC error raises the NMI
+ * during the copy, PLATFORM_on_nmi() notes it and the copy goes on.
+ */
+bool PLATFORM_flash_read(uint32_t offset, void *data, uint16_t length)
+{
+    platform_flash_ecc_offset = PLATFORM_NO_ECC_ERROR;
+    memcpy(data, (const uint8_t *)OUTBOX_FLASH_ADDRESS + offset, length);
+    __DSB(); // the NMI of the last read is taken before the check
+    return platform_flash_ecc_offset == PLATFORM_NO_ECC_ERROR;
+}
+
+/**
+ * Blocks for about 22 ms. The region is in bank 2, the code runs from bank 1
+ * and is not stalled by the erase.
+ */
+bool PLATFORM_flash_erase_page(uint16_t page)
+{
+    FLASH_EraseInitTypeDef erase;
+    uint32_t address = OUTBOX_FLASH_ADDRESS + (uint32_t)page * PLATFORM_FLASH_PAGE_SIZE;
+    uint32_t page_error;
+    HAL_StatusTypeDef status;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.Banks = address >= FLASH_BASE + FLASH_BANK_SIZE ? FLASH_BANK_2 : FLASH_BANK_1;
+    erase.Page = ((address - FLASH_BASE) % FLASH_BANK_SIZE) / FLASH_PAGE_SIZE;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+    status = HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+bool PLATFORM_flash_program(uint32_t offset, const uint64_t *data, uint16_t count)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    uint16_t i;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+    for (i = 0; i < count && status == HAL_OK; i++)
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, OUTBOX_FLASH_ADDRESS + offset + 8u * i, data[i]);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+/**
+ * Called by NMI_Handler(). A double ECC error in the outbox region comes from
+ * a reset while programming, the outbox reads it as a corrupt slot and
+ * programs it to zero (like ST's EEPROM emulation does). Any other double
+ * ECC error is in code or constants.
+ * @return true if the NMI was such an outbox read and is cleared
+ */
+bool PLATFORM_on_nmi()
+{
+    uint32_t eccr = FLASH->ECCR;
+    uint32_t address = FLASH_BASE + (eccr & FLASH_ECCR_ADDR_ECC) + ((eccr & FLASH_ECCR_BK_ECC) ? FLASH_BANK_SIZE : 0);
+
+    if ((eccr & FLASH_ECCR_ECCD) == 0 || (eccr & FLASH_ECCR_SYSF_ECC) != 0 || address < OUTBOX_FLASH_ADDRESS ||
+        address >= OUTBOX_FLASH_ADDRESS + (uint32_t)OUTBOX_FLASH_PAGES * PLATFORM_FLASH_PAGE_SIZE)
+        return false;
+    platform_flash_ecc_offset = address - OUTBOX_FLASH_ADDRESS;
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ECCD);
+    return true;
+}
+
+// ###### HAL callbacks
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance == ADC1)
+        ACQ_on_dma_block_complete(0);
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance == ADC1)
+        ACQ_on_dma_block_complete(1);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == UART4)
+        SERIAL_on_tx_complete();
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    PLATFORM_timer_callback callback;
+
+    if (htim->Instance != TIM15)
+        return;
+    callback = platform_timer_callback;
+    platform_timer_callback = NULL;
+    if (callback != NULL)
+        callback();
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    if (GPIO_Pin == B1_Pin)
+        platform_is_button_pressed = true;
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    // circular mode: Size = bytes written since the start of the buffer
+    if (huart->Instance == UART4)
+        SERIAL_on_rx_event(Size);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    // only errors that stopped the reception, a lost TX completion would be fatal anyway
+    if (huart->Instance == UART4 && huart->RxState == HAL_UART_STATE_READY)
+        SERIAL_on_rx_error();
+}
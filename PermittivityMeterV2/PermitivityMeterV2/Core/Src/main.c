@@ -21,6 +21,8 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "hal_clock.h"
+#include "al_app.h"
 
 /* USER CODE END Includes */
 
@@ -97,6 +99,9 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+#if ACQ_COHERENT_SAMPLING
+  CLOCK_config_coherent();
+#endif
 
   /* USER CODE END SysInit */
 
@@ -109,6 +114,7 @@ int main(void)
   MX_IWDG_Init();
   MX_TIM1_Init();
   /* USER CODE BEGIN 2 */
+  APP_init();
 
   /* USER CODE END 2 */
 
@@ -116,9 +122,13 @@ int main(void)
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-
-	  HAL_GPIO_TogglePin(GPIOA, STATUS_LED_Pin);
-	  HAL_Delay(500);
+    APP_cycle(NULL);
+    HAL_IWDG_Refresh(&hiwdg);
+#if APP_TRACKING
+    APP_idle(0); // the cycle itself lasts 1 / TRACK_OUTPUT_HZ
+#else
+    APP_idle(APP_CYCLE_PAUSE_MS);
+#endif
 
     /* USER CODE END WHILE */
 
@@ -217,7 +227,7 @@ static void MX_ADC1_Init(void)
   hadc1.Init.Overrun = ADC_OVR_DATA_PRESERVED;
   hadc1.Init.OversamplingMode = ENABLE;
   hadc1.Init.Oversampling.Ratio = ADC_OVERSAMPLING_RATIO_2;
-  hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_NONE;
+  hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_1;
   hadc1.Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
   hadc1.Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
   if (HAL_ADC_Init(&hadc1) != HAL_OK)
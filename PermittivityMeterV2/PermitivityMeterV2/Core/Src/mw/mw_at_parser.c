@@ -0,0 +1,120 @@
+#include "mw_at_parser.h"
+#include <string.h>
+
+/*
+ * Incremental parser for the responses of the NINA-W1 AT interface.
+ * Every received byte is looked at once: it is appended to the current line,
+ * at the line end the line is classified once and returned as a token. The
+ * cost per byte does not depend on how much has been received before, unlike
+ * searching the whole receive buffer for every possible response.
+ *
+ * In command mode responses and URCs are lines terminated by CR LF, empty
+ * lines are skipped. In data mode the bytes come from the peer, a line (CR or
+ * LF terminated, or a full line buffer) is returned as AT_TOKEN_DATA.
+ */
+
+// ###### typedefs
+
+typedef struct
+{
+    const char *text;
+    uint8_t length;
+    bool prefix_only; // the response carries parameters behind the text
+    AT_token_type type;
+} AT_response;
+
+// ###### global variables
+
+static const AT_response at_responses[] = {
+    {"OK", 2, false, AT_TOKEN_OK},
+    {"ERROR", 5, false, AT_TOKEN_ERROR},
+    {"+STARTUP", 8, false, AT_TOKEN_STARTUP},
+    {"+UUDPC:", 7, true, AT_TOKEN_PEER_CONNECTED},
+    {"+UUDPD:", 7, true, AT_TOKEN_PEER_DISCONNECTED},
+};
+
+// ###### private functions
+
+static AT_token_type AT_classify(const char *line, uint16_t length)
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(at_responses) / sizeof(at_responses[0]); i++)
+    {
+        const AT_response *response = &at_responses[i];
+
+        if (response->prefix_only ? length < response->length : length != response->length)
+            continue;
+        if (memcmp(line, response->text, response->length) == 0)
+            return response->type;
+    }
+    return AT_TOKEN_LINE;
+}
+
+static void AT_emit(AT_parser *parser, AT_token_type type, AT_token *token)
+{
+    parser->line[parser->length] = '\0';
+    token->type = type;
+    token->text = parser->line;
+    token->length = parser->length;
+    parser->length = 0;
+}
+
+// ###### functions
+
+void AT_parser_init(AT_parser *parser)
+{
+    parser->length = 0;
+    parser->data_mode = false;
+    parser->discarding = false;
+}
+
+/**
+ * Switches between command mode (AT responses) and data mode (peer data).
+ * A partially received line is dropped.
+ */
+void AT_parser_set_data_mode(AT_parser *parser, bool data_mode)
+{
+    parser->data_mode = data_mode;
+    parser->length = 0;
+    parser->discarding = false;
+}
+
+/**
+ * Feeds one received byte.
+ * @param token: receives the token if the byte completed one
+ * @return true if a token was completed
+ */
+bool AT_parser_feed(AT_parser *parser, uint8_t byte, AT_token *token)
+{
+    if (byte == '\r' || byte == '\n')
+    {
+        if (parser->discarding)
+        {
+            parser->discarding = false;
+            parser->length = 0;
+            return false;
+        }
+        if (parser->length == 0)
+            return false; // second half of CR LF or empty line
+
+        AT_emit(parser, parser->data_mode ? AT_TOKEN_DATA : AT_classify(parser->line, parser->length), token);
+        return true;
+    }
+
+    if (parser->discarding)
+        return false;
+
+    parser->line[parser->length++] = (char)byte;
+    if (parser->length < AT_LINE_MAX_LENGTH)
+        return false;
+
+    // line buffer full
+    if (parser->data_mode)
+    {
+        AT_emit(parser, AT_TOKEN_DATA, token);
+        return true;
+    }
+    parser->discarding = true;
+    return false;
+}
@@ -0,0 +1,256 @@
+#include "mw_at_pipeline.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "platform.h"
+#include "hal_nina.h"
+
+/*
+ * The head command is sent when the caller allows it (command mode), its
+ * OK/ERROR comes in through ATP_on_token(). Timeouts, retries and backoff
+ * are tick deadlines checked in ATP_cyclic(), nothing blocks: a lost OK
+ * costs at most (retries + 1) * timeout plus the backoff.
+ * Finished commands are removed from the front, entries and arena move up
+ * (a few hundred bytes at most), so the arena never fragments.
+ */
+
+// ###### private functions
+
+static bool ATP_is_deadline_reached(uint32_t deadline_ms)
+{
+    return (int32_t)(PLATFORM_get_tick_ms() - deadline_ms) >= 0;
+}
+
+/**
+ * Removes the head, its text leaves the arena.
+ */
+static ATP_entry ATP_pop(ATP_pipeline *pipeline)
+{
+    ATP_entry head = pipeline->entries[0];
+    uint8_t i;
+
+    pipeline->count--;
+    memmove(&pipeline->entries[0], &pipeline->entries[1], pipeline->count * sizeof(ATP_entry));
+    for (i = 0; i < pipeline->count; i++)
+        pipeline->entries[i].offset -= head.length;
+
+    pipeline->arena_used -= head.length;
+    memmove(&pipeline->arena[0], &pipeline->arena[head.length], pipeline->arena_used);
+
+    pipeline->state = ATP_STATE_READY;
+    pipeline->attempts = 0;
+    pipeline->has_response = false;
+    return head;
+}
+
+/**
+ * Head done: removed before its callback runs, the callback may queue new
+ * commands or clear the pipeline.
+ */
+static void ATP_complete(ATP_pipeline *pipeline, ATP_result result)
+{
+    const char *response = pipeline->has_response ? pipeline->response : NULL;
+    ATP_entry head = ATP_pop(pipeline);
+
+    if (result != ATP_RESULT_OK && head.sequence != 0)
+    {
+        // the rest of the sequence makes no sense without this command
+        while (pipeline->count > 0 && pipeline->entries[0].sequence == head.sequence)
+        {
+            ATP_entry cancelled = ATP_pop(pipeline);
+
+            if (cancelled.callback != NULL)
+                cancelled.callback(ATP_RESULT_CANCELLED, NULL, cancelled.context);
+        }
+    }
+    // the response buffer is only overwritten by the next token
+    if (head.callback != NULL)
+        head.callback(result, response, head.context);
+}
+
+/**
+ * Attempt failed: again after the backoff or give up.
+ */
+static void ATP_fail_attempt(ATP_pipeline *pipeline, ATP_result result)
+{
+    const ATP_policy *policy = pipeline->entries[0].policy;
+
+    if (pipeline->attempts > policy->retries)
+    {
+        ATP_complete(pipeline, result);
+        return;
+    }
+    pipeline->state = ATP_STATE_BACKOFF;
+    pipeline->has_response = false;
+    pipeline->deadline_ms = PLATFORM_get_tick_ms() + ((uint32_t)policy->backoff_ms << (pipeline->attempts - 1));
+}
+
+// ###### functions
+
+void ATP_init(ATP_pipeline *pipeline)
+{
+    pipeline->last_sequence = 0;
+    ATP_clear(pipeline);
+}
+
+/**
+ * Queues a command, formatted like printf (including CR LF).
+ * @param policy: has to stay valid until the command is done (static const)
+ * @param callback: optional
+ * @return false if the queue or the arena is full, nothing is queued then
+ */
+bool ATP_enqueue(ATP_pipeline *pipeline, const ATP_policy *policy, ATP_callback callback, void *context,
+                 const char *format, ...)
+{
+    ATP_entry *entry;
+    uint16_t space = ATP_ARENA_SIZE - pipeline->arena_used;
+    va_list arguments;
+    int length;
+
+    if (pipeline->count >= ATP_QUEUE_LENGTH)
+    {
+        pipeline->sequence_failed = true;
+        return false;
+    }
+
+    // vsnprintf writes a terminating zero, it is not part of the command
+    va_start(arguments, format);
+    length = vsnprintf(&pipeline->arena[pipeline->arena_used], space, format, arguments);
+    va_end(arguments);
+    if (length <= 0 || length >= space)
+    {
+        pipeline->sequence_failed = true;
+        return false;
+    }
+
+    entry = &pipeline->entries[pipeline->count++];
+    entry->offset = pipeline->arena_used;
+    entry->length = (uint16_t)length;
+    entry->policy = policy;
+    entry->callback = callback;
+    entry->context = context;
+    entry->sequence = pipeline->sequence;
+    pipeline->arena_used += (uint16_t)length;
+    return true;
+}
+
+void ATP_begin_sequence(ATP_pipeline *pipeline)
+{
+    pipeline->last_sequence++;
+    if (pipeline->last_sequence == 0)
+        pipeline->last_sequence = 1; // 0 means no sequence
+    pipeline->sequence = pipeline->last_sequence;
+    pipeline->sequence_failed = false;
+}
+
+/**
+ * @return false if a command of the sequence did not fit, the whole sequence
+ *         is dropped then (without callbacks)
+ */
+bool ATP_end_sequence(ATP_pipeline *pipeline)
+{
+    uint8_t sequence = pipeline->sequence;
+
+    pipeline->sequence = 0;
+    if (!pipeline->sequence_failed)
+        return true;
+
+    // nothing of it was sent yet, it is at the end of the queue
+    while (pipeline->count > 0 && pipeline->entries[pipeline->count - 1].sequence == sequence)
+    {
+        pipeline->count--;
+        pipeline->arena_used = pipeline->entries[pipeline->count].offset;
+    }
+    return false;
+}
+
+/**
+ * Hands a token of the module to the head command.
+ * @return true if the token answered the head command, false if it is
+ *         unsolicited (URC, OK to the DTR escape, peer data)
+ */
+bool ATP_on_token(ATP_pipeline *pipeline, const AT_token *token)
+{
+    const ATP_policy *policy;
+
+    if (pipeline->state != ATP_STATE_WAITING)
+        return false;
+    policy = pipeline->entries[0].policy;
+
+    switch (token->type)
+    {
+    case AT_TOKEN_OK:
+        if (policy->expect_prefix != NULL && !pipeline->has_response)
+            ATP_fail_attempt(pipeline, ATP_RESULT_UNEXPECTED);
+        else
+            ATP_complete(pipeline, ATP_RESULT_OK);
+        return true;
+    case AT_TOKEN_ERROR:
+        ATP_fail_attempt(pipeline, ATP_RESULT_ERROR);
+        return true;
+    case AT_TOKEN_LINE:
+        if (policy->expect_prefix == NULL ||
+            strncmp(token->text, policy->expect_prefix, strlen(policy->expect_prefix)) != 0)
+            return false; // echo of the command or something else
+        memcpy(pipeline->response, token->text, token->length + 1u);
+        pipeline->has_response = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Checks the deadlines and sends the head command.
+ * @param can_send: false while the module is not in command mode, a command
+ *                  on the line still times out
+ */
+void ATP_cyclic(ATP_pipeline *pipeline, bool can_send)
+{
+    ATP_entry *head;
+
+    if (pipeline->count == 0)
+        return;
+
+    if (pipeline->state == ATP_STATE_WAITING)
+    {
+        if (ATP_is_deadline_reached(pipeline->deadline_ms))
+            ATP_fail_attempt(pipeline, ATP_RESULT_TIMEOUT);
+        return;
+    }
+    if (pipeline->state == ATP_STATE_BACKOFF)
+    {
+        if (!ATP_is_deadline_reached(pipeline->deadline_ms))
+            return;
+        pipeline->state = ATP_STATE_READY;
+    }
+
+    if (!can_send)
+        return;
+    head = &pipeline->entries[0];
+    if (!NINA_send_bytes(&pipeline->arena[head->offset], head->length))
+        return; // transmit buffer full, next call
+    pipeline->attempts++;
+    pipeline->has_response = false;
+    pipeline->deadline_ms = PLATFORM_get_tick_ms() + head->policy->timeout_ms;
+    pipeline->state = ATP_STATE_WAITING;
+}
+
+/**
+ * Drops all commands without calling their callbacks (module reset).
+ */
+void ATP_clear(ATP_pipeline *pipeline)
+{
+    pipeline->arena_used = 0;
+    pipeline->count = 0;
+    pipeline->state = ATP_STATE_READY;
+    pipeline->attempts = 0;
+    pipeline->has_response = false;
+    pipeline->sequence = 0;
+    pipeline->sequence_failed = false;
+}
+
+bool ATP_is_idle(const ATP_pipeline *pipeline)
+{
+    return pipeline->count == 0;
+}
@@ -0,0 +1,129 @@
+#include "mw_frame.h"
+#include <string.h>
+
+/*
+ * Encoder of the binary result frame (layout in mw_frame.h). Records are
+ * packed byte by byte, the frame does not depend on struct layout or
+ * endianness of the compiler.
+ */
+
+// ###### private functions
+
+static uint8_t *FRAME_put_u16(uint8_t *out, uint16_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+static uint8_t *FRAME_put_u32(uint8_t *out, uint32_t value)
+{
+    out = FRAME_put_u16(out, (uint16_t)value);
+    return FRAME_put_u16(out, (uint16_t)(value >> 16));
+}
+
+/**
+ * Rounds to the fixed point unit and saturates to the range of the field.
+ */
+static int32_t FRAME_fixed(float value, float scale, int32_t min, int32_t max)
+{
+    float scaled = value * scale;
+
+    if (scaled != scaled) // NaN
+        return min;
+    if (scaled <= (float)min)
+        return min;
+    if (scaled >= (float)max)
+        return max;
+    return (int32_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+// ###### functions
+
+void FRAME_begin(FRAME_builder *builder)
+{
+    builder->buffer[0] = FRAME_MAGIC;
+    builder->buffer[1] = FRAME_VERSION;
+    builder->buffer[2] = 0;
+    builder->buffer[3] = FRAME_RECORD_SIZE;
+    builder->length = FRAME_HEADER_SIZE;
+    builder->count = 0;
+}
+
+/**
+ * @return false if the frame already holds FRAME_MAX_RECORDS records
+ */
+bool FRAME_add(FRAME_builder *builder, const FRAME_record *record)
+{
+    if (builder->count >= FRAME_MAX_RECORDS)
+        return false;
+
+    FRAME_encode_record(record, &builder->buffer[builder->length]);
+    builder->length += FRAME_RECORD_SIZE;
+    builder->count++;
+    return true;
+}
+
+/**
+ * Same as FRAME_add() for a record encoded before (outbox).
+ * @param encoded: FRAME_RECORD_SIZE bytes
+ */
+bool FRAME_add_encoded(FRAME_builder *builder, const uint8_t *encoded)
+{
+    if (builder->count >= FRAME_MAX_RECORDS)
+        return false;
+
+    memcpy(&builder->buffer[builder->length], encoded, FRAME_RECORD_SIZE);
+    builder->length += FRAME_RECORD_SIZE;
+    builder->count++;
+    return true;
+}
+
+/**
+ * Packs a record as it appears in the frame.
+ * @param out: FRAME_RECORD_SIZE bytes
+ */
+void FRAME_encode_record(const FRAME_record *record, uint8_t *out)
+{
+    out = FRAME_put_u32(out, record->sequence);
+    out = FRAME_put_u32(out, record->timestamp_s);
+    out = FRAME_put_u16(out, (uint16_t)FRAME_fixed(record->permittivity_real, 1000.0f, 0, UINT16_MAX));
+    out = FRAME_put_u16(out, (uint16_t)FRAME_fixed(record->permittivity_imag, 10000.0f, 0, UINT16_MAX));
+    out = FRAME_put_u16(out, record->code_d1);
+    out = FRAME_put_u16(out, record->code_d2);
+    out = FRAME_put_u16(out, (uint16_t)FRAME_fixed(record->amplitude, 100.0f, 0, UINT16_MAX));
+    out = FRAME_put_u16(out, (uint16_t)(int16_t)FRAME_fixed(record->temperature_c, 100.0f, INT16_MIN, INT16_MAX));
+    *out++ = record->gain;
+    *out++ = record->flags;
+    out = FRAME_put_u16(out, (record->duration_ms < UINT16_MAX) ? (uint16_t)record->duration_ms : UINT16_MAX);
+    FRAME_put_u16(out, record->evaluations);
+}
+
+/**
+ * Writes the record count and appends the CRC.
+ * @return length of the frame in bytes
+ */
+uint16_t FRAME_finish(FRAME_builder *builder)
+{
+    builder->buffer[2] = builder->count;
+    FRAME_put_u16(&builder->buffer[builder->length], FRAME_crc16(builder->buffer, builder->length, 0xFFFF));
+    builder->length += FRAME_CRC_SIZE;
+    return builder->length;
+}
+
+/**
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, MSB first), start with crc = 0xFFFF.
+ */
+uint16_t FRAME_crc16(const uint8_t *data, uint16_t length, uint16_t crc)
+{
+    uint16_t i;
+    uint8_t bit;
+
+    for (i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
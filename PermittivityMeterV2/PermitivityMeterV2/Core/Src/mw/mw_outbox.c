@@ -0,0 +1,409 @@
+#include "mw_outbox.h"
+#include <string.h>
+
+/*
+ * Write position: page and slot the next record goes to. Read position: at
+ * or before the oldest pending record. Both only move forward through the
+ * ring, OUTBOX_init() finds them again from the flash contents:
+ * - the page with the highest sequence is the write page, its slots are
+ *   used up to the last one that is not erased
+ * - the used pages follow each other in the ring, the one after the last
+ *   erased page (or after the write page) is the oldest
+ * The scan reads every slot once (a few ms for the whole region).
+ *
+ * Sent records stay in flash until their page is erased. The highest
+ * sequence number among them and the pending ones, or of a reservation
+ * (OUTBOX_reserve_sequence(), a record that is sent already), is where the
+ * sequence continues after a reset.
+ *
+ * A reset while a double word is programmed can leave it with a double ECC
+ * error. Every read goes through PLATFORM_flash_read(), which reports it
+ * instead of faulting. Such a slot is programmed to zero, which the ECC
+ * accepts: it reads as a sent record from then on. A page header is zeroed
+ * the same way, the page counts as unused then.
+ */
+
+// ###### defines
+
+#define OUTBOX_RECORD_CRC_OFFSET FRAME_RECORD_SIZE
+#define OUTBOX_MARKER_OFFSET 32
+#define OUTBOX_RECORD_WORDS (OUTBOX_MARKER_OFFSET / 8)
+
+_Static_assert(OUTBOX_RECORD_CRC_OFFSET + 2 <= OUTBOX_MARKER_OFFSET, "record and CRC overlap the sent marker");
+_Static_assert(OUTBOX_MARKER_OFFSET + 8 == OUTBOX_SLOT_SIZE, "the sent marker is the last double word of a slot");
+_Static_assert(OUTBOX_SEQUENCE_BLOCK <= OUTBOX_CAPACITY / 2, "a reservation must outlive the records behind it");
+
+// ###### global variables
+
+static uint16_t outbox_write_page = OUTBOX_FLASH_PAGES - 1;
+static uint8_t outbox_write_slot = OUTBOX_SLOTS_PER_PAGE; // full: the next append opens a page
+static uint32_t outbox_write_sequence = 0;
+static uint16_t outbox_read_page = OUTBOX_FLASH_PAGES - 1;
+static uint8_t outbox_read_slot = OUTBOX_SLOTS_PER_PAGE;
+static uint8_t outbox_peeked = 0; // records of the last OUTBOX_peek_frame() still in flash
+static OUTBOX_statistics outbox_statistics;
+
+// ###### private functions
+
+static uint32_t OUTBOX_slot_offset(uint16_t page, uint8_t slot)
+{
+    return (uint32_t)page * PLATFORM_FLASH_PAGE_SIZE + OUTBOX_PAGE_HEADER_SIZE + (uint32_t)slot * OUTBOX_SLOT_SIZE;
+}
+
+static uint32_t OUTBOX_read_u32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static bool OUTBOX_is_erased(const uint8_t *data, uint16_t length)
+{
+    uint16_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (data[i] != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+static bool OUTBOX_is_page_used(uint16_t page, uint32_t *sequence)
+{
+    static const uint64_t zero = 0;
+    uint32_t offset = (uint32_t)page * PLATFORM_FLASH_PAGE_SIZE;
+    uint8_t header[OUTBOX_PAGE_HEADER_SIZE];
+
+    if (!PLATFORM_flash_read(offset, header, sizeof(header)))
+    {
+        // reset while the page was opened, it holds no records yet
+        PLATFORM_flash_program(offset, &zero, 1);
+        return false;
+    }
+    if (OUTBOX_read_u32(header) != OUTBOX_PAGE_MAGIC)
+        return false;
+    *sequence = OUTBOX_read_u32(header + 4);
+    return true;
+}
+
+/**
+ * Copies a slot. One with a double ECC error is programmed to zero and
+ * counted as corrupt, data holds the zeros then.
+ * @param data: OUTBOX_SLOT_SIZE bytes
+ */
+static void OUTBOX_read_slot(uint16_t page, uint8_t slot, uint8_t *data)
+{
+    static const uint64_t zero[OUTBOX_SLOT_SIZE / 8] = {0};
+    uint32_t offset = OUTBOX_slot_offset(page, slot);
+
+    if (PLATFORM_flash_read(offset, data, OUTBOX_SLOT_SIZE))
+        return;
+    PLATFORM_flash_program(offset, zero, OUTBOX_SLOT_SIZE / 8);
+    memset(data, 0, OUTBOX_SLOT_SIZE);
+    outbox_statistics.corrupt++;
+}
+
+/**
+ * @param data: the slot (OUTBOX_read_slot())
+ * @return true if the slot holds a record with a correct CRC, sent or not
+ */
+static bool OUTBOX_is_record(const uint8_t *data)
+{
+    uint16_t crc = (uint16_t)(data[OUTBOX_RECORD_CRC_OFFSET] | data[OUTBOX_RECORD_CRC_OFFSET + 1] << 8);
+
+    return FRAME_crc16(data, FRAME_RECORD_SIZE, 0xFFFF) == crc;
+}
+
+/**
+ * @param data: the slot (OUTBOX_read_slot())
+ * @return true if the slot holds a record with a correct CRC that is not sent yet
+ */
+static bool OUTBOX_is_pending(const uint8_t *data)
+{
+    return OUTBOX_is_erased(&data[OUTBOX_MARKER_OFFSET], OUTBOX_SLOT_SIZE - OUTBOX_MARKER_OFFSET) &&
+           OUTBOX_is_record(data);
+}
+
+/**
+ * Moves (page, slot) to the next pending record, starting at (page, slot).
+ * @param data: receives the slot of the record (OUTBOX_SLOT_SIZE bytes)
+ * @return false if the write position is reached first
+ */
+static bool OUTBOX_find_pending(uint16_t *page, uint8_t *slot, uint8_t *data)
+{
+    while (true)
+    {
+        if (*slot >= OUTBOX_SLOTS_PER_PAGE && *page != outbox_write_page)
+        {
+            *page = (uint16_t)((*page + 1) % OUTBOX_FLASH_PAGES);
+            *slot = 0;
+        }
+        if (*page == outbox_write_page && *slot >= outbox_write_slot)
+            return false;
+        OUTBOX_read_slot(*page, *slot, data);
+        if (OUTBOX_is_pending(data))
+            return true;
+        (*slot)++;
+    }
+}
+
+/**
+ * Erases the page after the write page and makes it the write page. If it
+ * is the oldest page its pending records are dropped.
+ */
+static bool OUTBOX_open_next_page()
+{
+    uint16_t next = (uint16_t)((outbox_write_page + 1) % OUTBOX_FLASH_PAGES);
+    uint8_t data[OUTBOX_SLOT_SIZE];
+    uint64_t header;
+    uint16_t page;
+    uint8_t slot;
+
+    if (outbox_read_page == next && outbox_statistics.pending > 0)
+    {
+        page = outbox_read_page;
+        slot = outbox_read_slot;
+        while (OUTBOX_find_pending(&page, &slot, data) && page == next)
+        {
+            outbox_statistics.pending--;
+            outbox_statistics.dropped++;
+            if (outbox_peeked > 0)
+                outbox_peeked--; // the oldest ones, the frame holds them anyway
+            slot++;
+        }
+        outbox_read_page = (uint16_t)((next + 1) % OUTBOX_FLASH_PAGES);
+        outbox_read_slot = 0;
+    }
+
+    outbox_write_sequence++;
+    header = (uint64_t)outbox_write_sequence << 32 | OUTBOX_PAGE_MAGIC; // little endian: magic first
+    if (!PLATFORM_flash_erase_page(next) ||
+        !PLATFORM_flash_program((uint32_t)next * PLATFORM_FLASH_PAGE_SIZE, &header, 1))
+        return false;
+
+    // an empty outbox has its read position at the write position
+    if (outbox_statistics.pending == 0)
+    {
+        outbox_read_page = next;
+        outbox_read_slot = 0;
+    }
+    outbox_write_page = next;
+    outbox_write_slot = 0;
+    return true;
+}
+
+/**
+ * Programs a record with its CRC into the next slot, opens a new page first
+ * if the write page is full.
+ * @param is_sent: the sent marker is programmed along (5 double words instead of 4)
+ */
+static bool OUTBOX_write(const uint8_t *encoded, bool is_sent)
+{
+    uint64_t words[OUTBOX_SLOT_SIZE / 8];
+    uint8_t *bytes = (uint8_t *)words;
+    uint16_t crc = FRAME_crc16(encoded, FRAME_RECORD_SIZE, 0xFFFF);
+    uint32_t offset;
+
+    if (outbox_write_slot >= OUTBOX_SLOTS_PER_PAGE && !OUTBOX_open_next_page())
+        return false;
+
+    memset(bytes, 0xFF, sizeof(words)); // the gap to the marker stays erased
+    memcpy(bytes, encoded, FRAME_RECORD_SIZE);
+    bytes[OUTBOX_RECORD_CRC_OFFSET] = (uint8_t)crc;
+    bytes[OUTBOX_RECORD_CRC_OFFSET + 1] = (uint8_t)(crc >> 8);
+    words[OUTBOX_RECORD_WORDS] = 0; // sent marker, only programmed with is_sent
+
+    // the slot is used even if programming fails half way, its CRC is wrong or it has an ECC error then
+    offset = OUTBOX_slot_offset(outbox_write_page, outbox_write_slot);
+    outbox_write_slot++;
+    return PLATFORM_flash_program(offset, words, is_sent ? OUTBOX_RECORD_WORDS + 1 : OUTBOX_RECORD_WORDS);
+}
+
+// ###### functions
+
+/**
+ * Finds write and read position in the flash contents, counts the pending
+ * records. Has to run before any other OUTBOX_ function.
+ * @return sequence number after the highest one in flash (records and
+ *         reservations), 0 if the outbox is empty
+ */
+uint32_t OUTBOX_init()
+{
+    uint8_t data[OUTBOX_SLOT_SIZE];
+    uint32_t next_sequence = 0;
+    uint32_t sequence;
+    bool is_any_page_used = false;
+    uint16_t page;
+    uint16_t oldest;
+    uint8_t slot;
+
+    memset(&outbox_statistics, 0, sizeof(outbox_statistics));
+    outbox_peeked = 0;
+    outbox_write_page = OUTBOX_FLASH_PAGES - 1;
+    outbox_write_slot = OUTBOX_SLOTS_PER_PAGE;
+    outbox_write_sequence = 0;
+
+    for (page = 0; page < OUTBOX_FLASH_PAGES; page++)
+    {
+        if (OUTBOX_is_page_used(page, &sequence) && (!is_any_page_used || sequence > outbox_write_sequence))
+        {
+            is_any_page_used = true;
+            outbox_write_page = page;
+            outbox_write_sequence = sequence;
+        }
+    }
+    if (!is_any_page_used)
+    {
+        outbox_read_page = outbox_write_page;
+        outbox_read_slot = outbox_write_slot;
+        return 0;
+    }
+
+    // behind the last slot that is not erased (a record cut off by a reset included)
+    outbox_write_slot = OUTBOX_SLOTS_PER_PAGE;
+    while (outbox_write_slot > 0)
+    {
+        OUTBOX_read_slot(outbox_write_page, (uint8_t)(outbox_write_slot - 1), data);
+        if (!OUTBOX_is_erased(data, OUTBOX_SLOT_SIZE))
+            break;
+        outbox_write_slot--;
+    }
+
+    // back from the write page as long as the pages are used
+    oldest = outbox_write_page;
+    for (page = 1; page < OUTBOX_FLASH_PAGES; page++)
+    {
+        uint16_t previous = (uint16_t)((outbox_write_page + OUTBOX_FLASH_PAGES - page) % OUTBOX_FLASH_PAGES);
+
+        if (!OUTBOX_is_page_used(previous, &sequence))
+            break;
+        oldest = previous;
+    }
+
+    // count, move the read position to the first pending record, find the highest sequence number
+    outbox_read_page = oldest;
+    outbox_read_slot = 0;
+    page = oldest;
+    slot = 0;
+    while (true)
+    {
+        if (slot >= OUTBOX_SLOTS_PER_PAGE && page != outbox_write_page)
+        {
+            page = (uint16_t)((page + 1) % OUTBOX_FLASH_PAGES);
+            slot = 0;
+        }
+        if (page == outbox_write_page && slot >= outbox_write_slot)
+            break;
+        OUTBOX_read_slot(page, slot, data);
+        if (OUTBOX_is_record(data) && OUTBOX_read_u32(data) >= next_sequence)
+            next_sequence = OUTBOX_read_u32(data) + 1; // record offset 0 (mw_frame.h)
+        if (OUTBOX_is_pending(data))
+        {
+            if (outbox_statistics.pending++ == 0)
+            {
+                outbox_read_page = page;
+                outbox_read_slot = slot;
+            }
+        }
+        else if (OUTBOX_is_erased(&data[OUTBOX_MARKER_OFFSET], OUTBOX_SLOT_SIZE - OUTBOX_MARKER_OFFSET))
+            outbox_statistics.corrupt++; // not sent, but the record is broken
+        slot++;
+    }
+    if (outbox_statistics.pending == 0)
+    {
+        outbox_read_page = outbox_write_page;
+        outbox_read_slot = outbox_write_slot;
+    }
+    return next_sequence;
+}
+
+/**
+ * Programs one record (4 double words, about 0.4 ms), opens a new page
+ * every OUTBOX_SLOTS_PER_PAGE records (erase, about 22 ms).
+ * @param encoded: FRAME_RECORD_SIZE bytes (FRAME_encode_record())
+ * @return false if the flash could not be programmed, the record is lost
+ */
+bool OUTBOX_append(const uint8_t *encoded)
+{
+    if (!OUTBOX_write(encoded, false))
+        return false;
+
+    if (outbox_statistics.pending == 0)
+    {
+        outbox_read_page = outbox_write_page;
+        outbox_read_slot = (uint8_t)(outbox_write_slot - 1);
+    }
+    outbox_statistics.pending++;
+    outbox_statistics.appended++;
+    return true;
+}
+
+/**
+ * Stores a sequence number as used without a record to send: OUTBOX_init()
+ * returns a higher one after a reset. Takes a slot that reads as sent.
+ * @return false if the flash could not be programmed
+ */
+bool OUTBOX_reserve_sequence(uint32_t sequence)
+{
+    uint8_t encoded[FRAME_RECORD_SIZE] = {0};
+
+    encoded[0] = (uint8_t)sequence;
+    encoded[1] = (uint8_t)(sequence >> 8);
+    encoded[2] = (uint8_t)(sequence >> 16);
+    encoded[3] = (uint8_t)(sequence >> 24);
+    return OUTBOX_write(encoded, true);
+}
+
+/**
+ * Adds the oldest pending records to the frame, without removing them.
+ * @param max: records at most (space left in the frame)
+ * @return number of records added
+ */
+uint8_t OUTBOX_peek_frame(FRAME_builder *builder, uint8_t max)
+{
+    uint8_t data[OUTBOX_SLOT_SIZE];
+    uint16_t page = outbox_read_page;
+    uint8_t slot = outbox_read_slot;
+    uint8_t count = 0;
+
+    while (count < max && OUTBOX_find_pending(&page, &slot, data))
+    {
+        if (!FRAME_add_encoded(builder, data))
+            break;
+        count++;
+        slot++;
+    }
+    outbox_peeked = count;
+    return count;
+}
+
+/**
+ * Marks the records of the last OUTBOX_peek_frame() as sent. Records
+ * dropped in between (ring full) are not marked twice.
+ */
+void OUTBOX_mark_sent()
+{
+    static const uint64_t sent = 0;
+    uint8_t data[OUTBOX_SLOT_SIZE];
+
+    while (outbox_peeked > 0 && OUTBOX_find_pending(&outbox_read_page, &outbox_read_slot, data))
+    {
+        // a failed marker is read as pending again after a reset: sent twice
+        PLATFORM_flash_program(OUTBOX_slot_offset(outbox_read_page, outbox_read_slot) + OUTBOX_MARKER_OFFSET, &sent,
+                               1);
+        outbox_read_slot++;
+        outbox_statistics.pending--;
+        outbox_statistics.sent++;
+        outbox_peeked--;
+    }
+    outbox_peeked = 0;
+}
+
+uint32_t OUTBOX_get_pending()
+{
+    return outbox_statistics.pending;
+}
+
+void OUTBOX_get_statistics(OUTBOX_statistics *statistics)
+{
+    *statistics = outbox_statistics;
+}
@@ -0,0 +1,170 @@
+#include "mw_peer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Fixed table of PEER_MAX_COUNT entries, the module allows only a few
+ * connections at the same time. The URC fields are parsed in place, no
+ * sscanf (code size).
+ */
+
+// ###### global variables
+
+static PEER_info peer_table[PEER_MAX_COUNT];
+static uint8_t peer_count = 0;
+
+// ###### private functions
+
+/**
+ * Reads a decimal field and the comma behind it.
+ * @return position behind the comma (or at the terminating zero), NULL if malformed
+ */
+static const char *PEER_parse_number(const char *text, uint32_t max, uint32_t *value)
+{
+    char *end;
+    unsigned long number;
+
+    if (*text < '0' || *text > '9')
+        return NULL;
+    number = strtoul(text, &end, 10);
+    if (number > max || (*end != ',' && *end != '\0'))
+        return NULL;
+    *value = (uint32_t)number;
+    return *end == ',' ? end + 1 : end;
+}
+
+// ###### functions
+
+/**
+ * @param urc: line starting with "+UUDPC:"
+ * @return false if a field is missing or out of range
+ */
+bool PEER_parse_connected(const char *urc, PEER_info *peer)
+{
+    const char *text = urc + 7;
+    const char *comma;
+    uint32_t value;
+    size_t length;
+
+    if (strncmp(urc, "+UUDPC:", 7) != 0)
+        return false;
+    memset(peer, 0, sizeof(*peer));
+
+    if ((text = PEER_parse_number(text, UINT8_MAX, &value)) == NULL || value == PEER_HANDLE_UNKNOWN)
+        return false;
+    peer->handle = (uint8_t)value;
+    if ((text = PEER_parse_number(text, UINT8_MAX, &value)) == NULL)
+        return false;
+    peer->type = (uint8_t)value;
+    if (peer->type != PEER_TYPE_BLUETOOTH)
+        return true; // IP connections carry other fields, handle and type are enough here
+
+    if ((text = PEER_parse_number(text, UINT8_MAX, &value)) == NULL)
+        return false;
+    peer->profile = (uint8_t)value;
+
+    comma = strchr(text, ',');
+    length = comma != NULL ? (size_t)(comma - text) : strlen(text);
+    if (length == 0 || length > PEER_ADDRESS_MAX_LENGTH)
+        return false;
+    memcpy(peer->address, text, length);
+    peer->address[length] = '\0';
+
+    // frame size is optional in older firmware versions of the module
+    if (comma != NULL)
+    {
+        if (PEER_parse_number(comma + 1, UINT16_MAX, &value) == NULL)
+            return false;
+        peer->frame_size = (uint16_t)value;
+    }
+    return true;
+}
+
+/**
+ * @param urc: line starting with "+UUDPD:"
+ */
+bool PEER_parse_disconnected(const char *urc, uint8_t *handle)
+{
+    uint32_t value;
+
+    if (strncmp(urc, "+UUDPD:", 7) != 0)
+        return false;
+    if (PEER_parse_number(urc + 7, UINT8_MAX, &value) == NULL || value == PEER_HANDLE_UNKNOWN)
+        return false;
+    *handle = (uint8_t)value;
+    return true;
+}
+
+void PEER_clear()
+{
+    peer_count = 0;
+}
+
+/**
+ * A peer with a handle already in the table replaces that entry (the URC of
+ * its disconnect was lost).
+ * @return false if the table is full
+ */
+bool PEER_add(const PEER_info *peer)
+{
+    uint8_t i;
+
+    for (i = 0; i < peer_count; i++)
+    {
+        if (peer_table[i].handle == peer->handle)
+        {
+            peer_table[i] = *peer;
+            return true;
+        }
+    }
+    if (peer_count >= PEER_MAX_COUNT)
+        return false;
+    peer_table[peer_count++] = *peer;
+    return true;
+}
+
+/**
+ * @param removed: optional, receives the entry
+ * @return false if the handle is not in the table
+ */
+bool PEER_remove(uint8_t handle, PEER_info *removed)
+{
+    uint8_t i;
+
+    for (i = 0; i < peer_count; i++)
+    {
+        if (peer_table[i].handle != handle)
+            continue;
+        if (removed != NULL)
+            *removed = peer_table[i];
+        peer_count--;
+        memmove(&peer_table[i], &peer_table[i + 1], (peer_count - i) * sizeof(PEER_info));
+        return true;
+    }
+    return false;
+}
+
+uint8_t PEER_get_count()
+{
+    return peer_count;
+}
+
+/**
+ * @return NULL if index >= PEER_get_count()
+ */
+const PEER_info *PEER_get(uint8_t index)
+{
+    return index < peer_count ? &peer_table[index] : NULL;
+}
+
+const PEER_info *PEER_find(uint8_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < peer_count; i++)
+    {
+        if (peer_table[i].handle == handle)
+            return &peer_table[i];
+    }
+    return NULL;
+}
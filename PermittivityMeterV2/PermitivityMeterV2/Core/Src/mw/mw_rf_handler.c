@@ -0,0 +1,763 @@
+#include "mw_rf_handler.h"
+#include <stddef.h>
+#include <string.h>
+#include "platform.h"
+#include "hal_nina.h"
+#include "hal_serial.h"
+#include "mw_at_pipeline.h"
+#include "mw_peer.h"
+
+/*
+ * AT command and mode handling of the NINA-W1 module, ported from the MSP430
+ * rf_handler.c ("NINA software von okorn").
+ * Differences to the MSP430 version:
+ * - responses come as tokens from the AT parser (hal_nina.c), every received
+ *   byte is looked at once instead of searching the buffer for each response
+ * - transmissions are queued (hal_serial.c, DMA), the UART paces itself with
+ *   RTS/CTS, nothing waits for single bytes
+ * - timeouts are tick based deadlines, the DTR pulse for data -> command mode
+ *   is timed by the one shot timer
+ * - after +STARTUP the UART is switched to RF_BAUD_RATE_FAST (AT+UMRS) and
+ *   checked with an AT echo, on failure the module is reset and stays at
+ *   115200
+ * - commands go through an AT command pipeline (mw_at_pipeline.c) with
+ *   retries and backoff per command instead of a fixed queue of strings
+ * - URCs are dispatched through a table, the peer URCs fill the peer
+ *   registry (mw_peer.c) and call the connect/disconnect callbacks
+ * RF_cyclic() has to be called every few milliseconds (APP_idle()).
+ */
+
+// ###### defines
+
+#define RF_STRINGIFY(x) #x
+#define RF_TO_STRING(x) RF_STRINGIFY(x)
+
+// ###### typedefs
+
+typedef enum
+{
+    RF_BAUD_IDLE,      // module not booted yet
+    RF_BAUD_REQUEST,   // AT+UMRS to be sent
+    RF_BAUD_REQUESTED, // waiting for its OK
+    RF_BAUD_SWITCH,    // OK (or lost OK), UART4 follows the module
+    RF_BAUD_SETTLING,  // new rate set, module still switching
+    RF_BAUD_VERIFYING, // AT echo at the new rate
+    RF_BAUD_DONE
+} RF_baud_state;
+
+typedef struct
+{
+    AT_token_type type;
+    void (*handler)(const AT_token *token);
+} RF_urc_handler;
+
+// ###### global variables
+
+// mode and status
+static bool rf_is_bt_enabled = false;
+static RF_status rf_status = RF_STATUS_UNINITIALIZED;
+static RF_mode rf_target_mode = RF_DATA_MODE;
+
+// command handling
+static ATP_pipeline rf_pipeline;
+
+// switching between command and data mode
+static bool rf_is_in_data_mode = false; // the module starts in command mode
+static bool rf_started_switching_modes = false;
+static bool rf_is_switching_modes = false;
+static bool rf_is_waiting_for_dtr_pulse = false;
+static bool rf_escape_returned_ok = false;
+static uint8_t rf_escape_attempts = 0;
+static uint32_t rf_mode_switch_deadline_ms = 0;
+
+// peers
+static RF_peer_callback rf_on_peer_connected = NULL;
+static RF_peer_callback rf_on_peer_disconnected = NULL;
+
+// data through the module
+static bool rf_is_transmitting_message = false;
+static uint8_t rf_message_to_transmit[RF_MESSAGE_MAX_LENGTH];
+static uint16_t rf_message_length = 0;
+static bool rf_was_last_transmission_successful = false;
+static char rf_received_cmd[AT_LINE_MAX_LENGTH + 1];
+static bool rf_has_received_cmd = false;
+
+// boot
+static bool rf_has_booted_successfully = false;
+static uint32_t rf_boot_deadline_ms = 0;
+static uint8_t rf_reboot_count = 0;
+
+// baud rate upgrade
+static RF_baud_state rf_baud_state = RF_BAUD_IDLE;
+static uint32_t rf_baud_deadline_ms = 0;
+static bool rf_baud_upgrade_failed = false;
+
+// command policies
+static const ATP_policy rf_policy_config = {RF_CMD_TIMEOUT_MS, RF_CMD_RETRIES, RF_CMD_BACKOFF_MS, NULL};
+// first command after +STARTUP, not repeated: the module may have switched already
+static const ATP_policy rf_policy_baud_request = {RF_CMD_TIMEOUT_BOOT_MS, 0, 0, NULL};
+static const ATP_policy rf_policy_baud_verify = {RF_CMD_TIMEOUT_MS, RF_BAUD_VERIFY_ATTEMPTS - 1, 0, NULL};
+// ATO1 is not repeated: after a lost OK the repetition would already go to the peer
+static const ATP_policy rf_policy_data_mode = {RF_CMD_TIMEOUT_MS, 0, 0, NULL};
+
+// commands (printf formats for the pipeline)
+static const char rf_cmd_set_connectable_yes[] = "AT+UBTCM=2\r\n";
+static const char rf_cmd_set_discoverable_general[] = "AT+UBTDM=3\r\n";
+static const char rf_cmd_set_pairable_yes[] = "AT+UBTPM=2\r\n";
+static const char rf_cmd_disable_ble[] = "AT+UBTLE=0\r\n";
+static const char rf_cmd_set_master_slave_policy_dontcare[] = "AT+UBTMSP=1\r\n";
+static const char rf_cmd_set_name[] = "AT+UBTLN=%s\r\n";
+static const char rf_cmd_disconnect_peer[] = "AT+UDCPC=%u\r\n";
+static const char rf_cmd_set_connectable_none[] = "AT+UBTCM=1\r\n";
+static const char rf_cmd_set_discoverable_none[] = "AT+UBTDM=1\r\n";
+static const char rf_cmd_enter_data_mode[] = "ATO1\r\n";
+static const char rf_cmd_attention[] = "AT\r\n";
+// baud rate, flow control on, 8 data bits, 1 stop bit, no parity, change after the OK
+static const char rf_cmd_set_baud_rate[] = "AT+UMRS=" RF_TO_STRING(RF_BAUD_RATE_FAST) ",1,8,1,1,1\r\n";
+
+// ###### private functions
+
+static bool RF_is_deadline_reached(uint32_t deadline_ms)
+{
+    return (int32_t)(PLATFORM_get_tick_ms() - deadline_ms) >= 0;
+}
+
+static void RF_switch_to_data_mode()
+{
+    // data mode only makes sense when a peer is connected
+    if (!rf_is_in_data_mode && RF_is_peer_connected() && !(rf_is_switching_modes && rf_target_mode == RF_DATA_MODE))
+    {
+        rf_target_mode = RF_DATA_MODE;
+        rf_started_switching_modes = true;
+    }
+}
+
+static void RF_switch_to_cmd_mode()
+{
+    if (rf_is_in_data_mode)
+    {
+        rf_target_mode = RF_CMD_MODE;
+        rf_started_switching_modes = true;
+    }
+}
+
+static void RF_callback_BT_enable(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    if (result == ATP_RESULT_OK)
+        rf_is_bt_enabled = true;
+    RF_switch_to_data_mode();
+}
+
+static void RF_callback_BT_finish_init(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    if (result == ATP_RESULT_OK)
+        rf_status = RF_STATUS_BT_INITIALIZED;
+    RF_switch_to_data_mode();
+}
+
+static void RF_callback_BT_disable(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    if (result == ATP_RESULT_OK)
+        rf_is_bt_enabled = false;
+}
+
+/**
+ * Answer to ATO1. On OK the following bytes already come from the peer, the
+ * parser is switched right here (inside the token handling). Without an
+ * answer the module most likely switched and only the OK was lost: data mode
+ * is assumed, a wrong guess is caught by the DTR escape (RF_ESCAPE_ATTEMPTS).
+ * After ERROR RF_cyclic() starts over later.
+ */
+static void RF_callback_data_mode(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    rf_is_switching_modes = false;
+    if (result == ATP_RESULT_OK || result == ATP_RESULT_TIMEOUT)
+    {
+        rf_is_in_data_mode = true;
+        NINA_set_data_mode(true);
+    }
+}
+
+static void RF_BT_init()
+{
+    if (rf_status == RF_STATUS_UNINITIALIZED)
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, RF_callback_BT_finish_init, NULL, rf_cmd_set_name, RF_BT_LOCAL_NAME);
+}
+
+/**
+ * Data -> command mode: DTR pulse, then the module answers OK.
+ * Command -> data mode: ATO1, the OK is handled in RF_handle_token().
+ */
+static void RF_handle_mode_switch()
+{
+    if (rf_is_in_data_mode && rf_target_mode == RF_CMD_MODE)
+    {
+        if (rf_started_switching_modes)
+        {
+            // first entry -> init
+            rf_started_switching_modes = false;
+            rf_is_switching_modes = true;
+            rf_is_waiting_for_dtr_pulse = true;
+            NINA_start_dtr_pulse(RF_DTR_PULSE_MS);
+        }
+        else if (rf_is_waiting_for_dtr_pulse)
+        {
+            if (NINA_is_dtr_pulse_done())
+            {
+                // what follows is the answer of the module, no longer peer data
+                rf_is_waiting_for_dtr_pulse = false;
+                rf_escape_returned_ok = false;
+                NINA_set_data_mode(false);
+                rf_mode_switch_deadline_ms = PLATFORM_get_tick_ms() + RF_MODE_SWITCH_TIMEOUT_MS;
+            }
+        }
+        else if (rf_escape_returned_ok)
+        {
+            // finished, the pipeline continues with what it was sending
+            rf_is_switching_modes = false;
+            rf_is_in_data_mode = false;
+            rf_escape_attempts = 0;
+        }
+        else if (RF_is_deadline_reached(rf_mode_switch_deadline_ms))
+        {
+            rf_is_switching_modes = false;
+            if (++rf_escape_attempts >= RF_ESCAPE_ATTEMPTS)
+            {
+                // never left command mode (lost OK to ATO1 was a wrong guess), the parser already is
+                rf_is_in_data_mode = false;
+                rf_escape_attempts = 0;
+            }
+            else
+            {
+                // no OK after the pulse, the module is probably still in data mode: try again
+                NINA_set_data_mode(true);
+                RF_switch_to_cmd_mode();
+            }
+        }
+    }
+    else if (!rf_is_in_data_mode && rf_target_mode == RF_DATA_MODE)
+    {
+        if (rf_started_switching_modes)
+        {
+            // first entry -> init, behind the commands already queued
+            if (ATP_enqueue(&rf_pipeline, &rf_policy_data_mode, RF_callback_data_mode, NULL, rf_cmd_enter_data_mode))
+            {
+                rf_started_switching_modes = false;
+                rf_is_switching_modes = true;
+            }
+        }
+        // else: ATO1 is in the pipeline, RF_callback_data_mode() finishes
+    }
+    else
+    {
+        // no reason to change the mode -> finished here
+        rf_is_switching_modes = false;
+        rf_started_switching_modes = false;
+    }
+}
+
+static void RF_add_peer(const PEER_info *peer)
+{
+    if (!PEER_add(peer))
+        return; // more connections than PEER_MAX_COUNT, this one is not tracked
+    if (rf_on_peer_connected != NULL)
+        rf_on_peer_connected(peer);
+}
+
+static void RF_remove_peer(uint8_t handle)
+{
+    PEER_info peer;
+
+    if (PEER_remove(handle, &peer) && rf_on_peer_disconnected != NULL)
+        rf_on_peer_disconnected(&peer);
+}
+
+/**
+ * All connections are gone (module reset, power off, blue LED off).
+ */
+static void RF_remove_all_peers()
+{
+    while (PEER_get_count() > 0)
+        RF_remove_peer(PEER_get(PEER_get_count() - 1)->handle);
+}
+
+/**
+ * In data mode there are no URCs, only the blue LED shows connects and
+ * disconnects. A peer connected there has no known handle.
+ */
+static void RF_update_peers_from_led()
+{
+    bool is_connected = NINA_is_led_blue_on();
+    PEER_info peer;
+
+    if (is_connected == RF_is_peer_connected())
+        return;
+    if (is_connected)
+    {
+        memset(&peer, 0, sizeof(peer));
+        peer.handle = PEER_HANDLE_UNKNOWN;
+        RF_add_peer(&peer);
+    }
+    else
+    {
+        RF_remove_all_peers();
+        RF_switch_to_cmd_mode(); // the next connect comes with its URC then
+    }
+}
+
+static void RF_on_startup(const AT_token *token)
+{
+    (void)token;
+    rf_has_booted_successfully = true;
+    rf_status = RF_STATUS_BT_INITIALIZED;
+    if (RF_BAUD_RATE_FAST != 0 && !rf_baud_upgrade_failed)
+        rf_baud_state = RF_BAUD_REQUEST;
+    else
+        rf_baud_state = RF_BAUD_DONE;
+}
+
+static void RF_on_ok(const AT_token *token)
+{
+    (void)token;
+    // no command on the line: answer to the DTR escape
+    rf_escape_returned_ok = true;
+}
+
+static void RF_on_peer_connected(const AT_token *token)
+{
+    PEER_info peer;
+
+    if (PEER_parse_connected(token->text, &peer))
+        RF_add_peer(&peer);
+}
+
+static void RF_on_peer_disconnected(const AT_token *token)
+{
+    uint8_t handle;
+
+    if (PEER_parse_disconnected(token->text, &handle))
+        RF_remove_peer(handle);
+}
+
+static void RF_on_peer_data(const AT_token *token)
+{
+    // a command from the peer, the newest one wins
+    memcpy(rf_received_cmd, token->text, token->length + 1u);
+    rf_has_received_cmd = true;
+}
+
+// everything the pipeline did not take, echo and information responses are ignored
+static const RF_urc_handler rf_urc_handlers[] = {
+    {AT_TOKEN_STARTUP, RF_on_startup},
+    {AT_TOKEN_OK, RF_on_ok},
+    {AT_TOKEN_PEER_CONNECTED, RF_on_peer_connected},
+    {AT_TOKEN_PEER_DISCONNECTED, RF_on_peer_disconnected},
+    {AT_TOKEN_DATA, RF_on_peer_data},
+};
+
+static void RF_handle_token(const AT_token *token)
+{
+    uint8_t i;
+
+    if (ATP_on_token(&rf_pipeline, token))
+        return; // answer to the command on the line
+
+    for (i = 0; i < sizeof(rf_urc_handlers) / sizeof(rf_urc_handlers[0]); i++)
+    {
+        if (rf_urc_handlers[i].type == token->type)
+        {
+            rf_urc_handlers[i].handler(token);
+            return;
+        }
+    }
+}
+
+static void RF_reset_NINA()
+{
+    // the module restarts at the default rate
+    if (SERIAL_get_baud_rate() != SERIAL_BAUD_RATE_DEFAULT)
+    {
+        SERIAL_flush(RF_CMD_TIMEOUT_MS);
+        SERIAL_set_baud_rate(SERIAL_BAUD_RATE_DEFAULT);
+    }
+    rf_boot_deadline_ms = PLATFORM_get_tick_ms() + RF_BOOT_TIMEOUT_MS;
+    rf_baud_state = RF_BAUD_IDLE;
+
+    // what was queued or switching is meaningless for the restarted module
+    ATP_clear(&rf_pipeline);
+    rf_is_in_data_mode = false;
+    rf_started_switching_modes = false;
+    rf_is_switching_modes = false;
+    rf_is_waiting_for_dtr_pulse = false;
+    PLATFORM_timer_stop();
+    RF_remove_all_peers();
+    NINA_reset();
+}
+
+static void RF_callback_baud_request(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    if (result == ATP_RESULT_OK || result == ATP_RESULT_TIMEOUT)
+        rf_baud_state = RF_BAUD_SWITCH; // without an answer the verification decides
+    else
+        rf_baud_state = RF_BAUD_DONE; // ERROR: rate not supported, the module has not changed it
+}
+
+static void RF_callback_baud_verify(ATP_result result, const char *response, void *context)
+{
+    (void)response;
+    (void)context;
+    if (result == ATP_RESULT_OK)
+        rf_baud_state = RF_BAUD_DONE;
+    else
+    {
+        // fall back to the default rate
+        rf_baud_upgrade_failed = true;
+        rf_has_booted_successfully = false;
+        RF_reset_NINA();
+    }
+}
+
+/**
+ * Baud rate upgrade after boot: AT+UMRS, switch UART4 after the OK, check
+ * the new rate with AT. If the module does not answer at the new rate it is
+ * reset (back to the default rate) and no upgrade is tried again.
+ */
+static void RF_handle_baud_upgrade()
+{
+    switch (rf_baud_state)
+    {
+    case RF_BAUD_REQUEST:
+        if (ATP_enqueue(&rf_pipeline, &rf_policy_baud_request, RF_callback_baud_request, NULL, rf_cmd_set_baud_rate))
+            rf_baud_state = RF_BAUD_REQUESTED;
+        break;
+    case RF_BAUD_SWITCH:
+        if (SERIAL_set_baud_rate(RF_BAUD_RATE_FAST))
+        {
+            rf_baud_deadline_ms = PLATFORM_get_tick_ms() + RF_BAUD_SWITCH_SETTLE_MS;
+            rf_baud_state = RF_BAUD_SETTLING;
+        }
+        break;
+    case RF_BAUD_SETTLING:
+        if (RF_is_deadline_reached(rf_baud_deadline_ms))
+        {
+            if (ATP_enqueue(&rf_pipeline, &rf_policy_baud_verify, RF_callback_baud_verify, NULL, rf_cmd_attention))
+                rf_baud_state = RF_BAUD_VERIFYING;
+        }
+        break;
+    default:
+        break; // REQUESTED, VERIFYING: the callbacks continue
+    }
+}
+
+// ###### functions
+
+void RF_init()
+{
+    ATP_init(&rf_pipeline);
+    PEER_clear();
+    NINA_init();
+    RF_NINA_power_on();
+}
+
+/**
+ * This function shall be called periodically.
+ * It handles the responses of the module and the batch sending of commands.
+ */
+void RF_cyclic()
+{
+    AT_token token;
+
+    while (NINA_get_token(&token))
+        RF_handle_token(&token);
+
+    // first handle bootup
+    if (!rf_has_booted_successfully)
+    {
+        if (NINA_is_powered_on() && RF_is_deadline_reached(rf_boot_deadline_ms))
+        {
+            // no +STARTUP from the module -> boot unsuccessful -> reboot
+            rf_reboot_count++;
+            if (rf_reboot_count >= RF_MAX_REBOOTS)
+            {
+                // given up: held in reset until RF_NINA_power_on(), the caller decides (RF_has_boot_failed())
+                rf_status = RF_STATUS_ERROR;
+                NINA_power_off();
+                return;
+            }
+            RF_reset_NINA();
+        }
+        return; // until we have booted successfully we do nothing else
+    }
+
+    // commands only in command mode, in data mode they would go to the peer
+    ATP_cyclic(&rf_pipeline, !rf_is_in_data_mode);
+
+    if (rf_baud_state != RF_BAUD_DONE)
+    {
+        RF_handle_baud_upgrade();
+        return; // nothing else until the rate is settled
+    }
+
+    if (rf_is_in_data_mode && !rf_is_switching_modes && !rf_started_switching_modes)
+        RF_update_peers_from_led();
+    if (!RF_is_peer_connected())
+    {
+        // without a peer the red LED tells the mode reliably
+        bool is_in_data_mode = NINA_is_led_red_on();
+
+        if (is_in_data_mode != rf_is_in_data_mode && !rf_is_switching_modes && !rf_started_switching_modes)
+        {
+            rf_is_in_data_mode = is_in_data_mode;
+            NINA_set_data_mode(is_in_data_mode);
+        }
+    }
+
+    if (rf_is_in_data_mode && !rf_is_switching_modes && !rf_started_switching_modes && rf_is_transmitting_message)
+    {
+        if (NINA_send_bytes((const char *)rf_message_to_transmit, rf_message_length))
+        {
+            rf_was_last_transmission_successful = true;
+            rf_is_transmitting_message = false;
+        }
+    }
+
+    // call async handlers
+    if (rf_is_switching_modes || rf_started_switching_modes)
+        RF_handle_mode_switch();
+    else if (!ATP_is_idle(&rf_pipeline))
+        RF_switch_to_cmd_mode(); // commands are waiting
+    else if (rf_status == RF_STATUS_UNINITIALIZED)
+        RF_BT_init();
+    else if (!rf_is_in_data_mode)
+        RF_switch_to_data_mode(); // go into default state (if not already in there)
+}
+
+/**
+ * Returns the last line the peer has sent in data mode.
+ * @return false if nothing was received since the last call
+ */
+bool RF_fetch_BT_cmd(char *buffer, uint16_t size)
+{
+    if (!rf_has_received_cmd || size == 0)
+        return false;
+    strncpy(buffer, rf_received_cmd, size - 1);
+    buffer[size - 1] = '\0';
+    rf_has_received_cmd = false;
+    return true;
+}
+
+/**
+ * Transmits a string through the module to a connected device (eg PC).
+ * Asynchronous because we may need to switch to data mode first
+ * -> check RF_was_last_message_transmission_successful().
+ * @param string: longer than RF_MESSAGE_MAX_LENGTH is cut
+ * @param override_last_transmission: replace a message that has not been sent yet
+ * @return false if not initialized or still transmitting the last message
+ */
+bool RF_send_string(const char *string, bool override_last_transmission)
+{
+    size_t length = strlen(string);
+
+    if (length > RF_MESSAGE_MAX_LENGTH)
+        length = RF_MESSAGE_MAX_LENGTH;
+    return RF_send_buffer((const uint8_t *)string, (uint16_t)length, override_last_transmission);
+}
+
+/**
+ * Same as RF_send_string() for binary data (result frames).
+ * @return false also if length exceeds RF_MESSAGE_MAX_LENGTH, nothing is sent then
+ */
+bool RF_send_buffer(const uint8_t *data, uint16_t length, bool override_last_transmission)
+{
+    if (rf_status != RF_STATUS_BT_INITIALIZED)
+    {
+        rf_is_transmitting_message = false;
+        return false;
+    }
+    if (length > RF_MESSAGE_MAX_LENGTH)
+        return false;
+    if (rf_is_transmitting_message && !override_last_transmission)
+        return false;
+
+    rf_was_last_transmission_successful = false;
+    rf_is_transmitting_message = true;
+
+    RF_switch_to_data_mode();
+    memcpy(rf_message_to_transmit, data, length);
+    rf_message_length = length;
+    return true;
+}
+
+/**
+ * Queues bytes for the peer, only in data mode.
+ * @return false if not connected or the transmit buffer is full
+ */
+bool RF_send_bytes(const char *buffer, uint16_t length)
+{
+    if (!RF_is_peer_connected() || !rf_is_in_data_mode)
+        return false;
+    return NINA_send_bytes(buffer, length);
+}
+
+void RF_NINA_power_off()
+{
+    NINA_power_off();
+    PLATFORM_timer_stop();
+
+    // reset everything
+    rf_is_bt_enabled = false;
+
+    ATP_clear(&rf_pipeline);
+
+    rf_is_in_data_mode = false;
+    rf_started_switching_modes = false;
+    rf_is_switching_modes = false;
+    rf_is_waiting_for_dtr_pulse = false;
+
+    RF_remove_all_peers();
+    rf_is_transmitting_message = false;
+    rf_was_last_transmission_successful = false;
+    rf_has_received_cmd = false;
+
+    rf_has_booted_successfully = false;
+    rf_baud_state = RF_BAUD_IDLE;
+    if (SERIAL_get_baud_rate() != SERIAL_BAUD_RATE_DEFAULT)
+        SERIAL_set_baud_rate(SERIAL_BAUD_RATE_DEFAULT);
+}
+
+void RF_NINA_power_on()
+{
+    rf_reboot_count = 0;
+    if (rf_status == RF_STATUS_ERROR)
+        rf_status = RF_STATUS_UNINITIALIZED;
+    rf_baud_upgrade_failed = false;
+    RF_reset_NINA();
+}
+
+bool RF_is_NINA_powered_on()
+{
+    return NINA_is_powered_on();
+}
+
+bool RF_is_in_command_mode()
+{
+    return !rf_is_in_data_mode;
+}
+
+bool RF_is_in_data_mode()
+{
+    return rf_is_in_data_mode;
+}
+
+bool RF_was_last_message_transmission_successful()
+{
+    return rf_was_last_transmission_successful;
+}
+
+bool RF_is_transmitting_message_through_nina()
+{
+    return rf_is_transmitting_message;
+}
+
+bool RF_is_booted()
+{
+    return rf_has_booted_successfully && rf_baud_state == RF_BAUD_DONE;
+}
+
+/**
+ * @return true if the module did not boot within RF_MAX_REBOOTS resets, it is
+ *         held in reset until the next RF_NINA_power_on()
+ */
+bool RF_has_boot_failed()
+{
+    return rf_status == RF_STATUS_ERROR;
+}
+
+bool RF_is_peer_connected()
+{
+    return PEER_get_count() > 0;
+}
+
+/**
+ * Both callbacks run inside RF_cyclic() (token handling), the peer is only
+ * valid during the call.
+ * @param on_connected: optional, also for a connect only seen on the blue LED (PEER_HANDLE_UNKNOWN)
+ * @param on_disconnected: optional
+ */
+void RF_set_peer_callbacks(RF_peer_callback on_connected, RF_peer_callback on_disconnected)
+{
+    rf_on_peer_connected = on_connected;
+    rf_on_peer_disconnected = on_disconnected;
+}
+
+bool RF_BT_is_enabled()
+{
+    return rf_is_bt_enabled;
+}
+
+bool RF_BT_is_initialized()
+{
+    return rf_status == RF_STATUS_BT_INITIALIZED;
+}
+
+/**
+ * Configures the module for:
+ * -) connectable: yes
+ * -) Master/Slave mode: dont care
+ * -) discoverable: general discoverability
+ * -) pairable: yes
+ * -) BLE: disabled
+ */
+void RF_BT_enable()
+{
+    if (!rf_is_bt_enabled)
+    {
+        ATP_begin_sequence(&rf_pipeline);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_set_connectable_yes);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_set_discoverable_general);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_set_pairable_yes);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_disable_ble);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_set_master_slave_policy_dontcare);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, RF_callback_BT_enable, NULL, rf_cmd_set_name, RF_BT_LOCAL_NAME);
+        ATP_end_sequence(&rf_pipeline); // pipeline full: not enabled, may be called again
+    }
+}
+
+/**
+ * Configures the module for:
+ * -) connectable: no
+ * -) discoverable: no discoverability
+ * and disconnects the peers
+ */
+void RF_BT_disable()
+{
+    uint8_t i;
+
+    if (rf_is_bt_enabled)
+    {
+        // not part of the sequence: ERROR for a peer that is already gone must not stop the rest
+        for (i = 0; i < PEER_get_count(); i++)
+        {
+            uint8_t handle = PEER_get(i)->handle;
+
+            // connected in data mode without a URC: the first handle the module hands out is the best guess
+            if (handle == PEER_HANDLE_UNKNOWN)
+                handle = 1u;
+            ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_disconnect_peer, (unsigned int)handle);
+        }
+        ATP_begin_sequence(&rf_pipeline);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, NULL, NULL, rf_cmd_set_connectable_none);
+        ATP_enqueue(&rf_pipeline, &rf_policy_config, RF_callback_BT_disable, NULL, rf_cmd_set_discoverable_none);
+        ATP_end_sequence(&rf_pipeline);
+    }
+}
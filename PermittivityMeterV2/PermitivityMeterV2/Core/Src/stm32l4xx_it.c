@@ -57,6 +57,10 @@
 /* External variables --------------------------------------------------------*/
 extern DMA_HandleTypeDef hdma_adc1;
 /* USER CODE BEGIN EV */
+extern DMA_HandleTypeDef hdma_uart4_tx;
+extern DMA_HandleTypeDef hdma_uart4_rx;
+extern UART_HandleTypeDef huart4;
+extern TIM_HandleTypeDef htim15;
 
 /* USER CODE END EV */
 
@@ -69,7 +73,9 @@ extern DMA_HandleTypeDef hdma_adc1;
 void NMI_Handler(void)
 {
   /* USER CODE BEGIN NonMaskableInt_IRQn 0 */
-
+  // a read of an outbox slot cut off by a reset: noted, the outbox repairs the slot
+  if (PLATFORM_on_nmi())
+    return;
   /* USER CODE END NonMaskableInt_IRQn 0 */
   /* USER CODE BEGIN NonMaskableInt_IRQn 1 */
    while (1)
@@ -214,4 +220,44 @@ void DMA1_Channel1_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles DMA2 channel3 global interrupt (UART4 TX).
+  */
+void DMA2_Channel3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_uart4_tx);
+}
+
+/**
+  * @brief This function handles DMA2 channel5 global interrupt (UART4 RX).
+  */
+void DMA2_Channel5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_uart4_rx);
+}
+
+/**
+  * @brief This function handles TIM1 break and TIM15 global interrupt (one shot timer).
+  */
+void TIM1_BRK_TIM15_IRQHandler(void)
+{
+  HAL_TIM_IRQHandler(&htim15);
+}
+
+/**
+  * @brief This function handles UART4 global interrupt.
+  */
+void UART4_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&huart4);
+}
+
+/**
+  * @brief This function handles EXTI lines 10 to 15 (B1 on PC13).
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(B1_Pin);
+}
+
 /* USER CODE END 1 */
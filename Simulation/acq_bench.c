@@ -0,0 +1,201 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "afe_sim.h"
+#include "platform_host.h"
+#include "meas_config.h"
+#include "hal_acq.h"
+
+/*
+ * Checks the block hand-off of hal_acq.c on the fake DMA of the host
+ * platform: every PLATFORM_wait_for_interrupt() lets the "DMA" complete the
+ * next half of the buffer, exactly like the half/full transfer interrupt.
+ * The application side is stepped through the cases of the ping-pong buffer:
+ * released in time, released late (the DMA wrote into the held block),
+ * held over a whole wrap, and blocks that were never fetched. At last the
+ * sample index, which places a DAC step inside a block, against the blocks.
+ *
+ *   acq_bench
+ *
+ * Exit code 1 if a case does not behave as expected.
+ */
+
+// ###### defines
+
+#define BENCH_BLOCKS 8
+
+// ###### global variables
+
+static uint16_t bench_copy[ACQ_BLOCK_SIZE];
+static bool bench_is_failed = false;
+
+// ###### private functions
+
+static void BENCH_expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        printf("  FAILED: %s\n", what);
+        bench_is_failed = true;
+    }
+}
+
+/**
+ * @return the DMA wrote into the block since bench_copy was taken
+ */
+static bool BENCH_is_changed(const ACQ_block *block)
+{
+    return memcmp(block->samples, bench_copy, sizeof(bench_copy)) != 0;
+}
+
+/**
+ * Blocks fetched as they come and released before the DMA completes the next
+ * half: consecutive sequence numbers, alternating halves, no overrun.
+ */
+static void BENCH_in_time()
+{
+    const uint16_t *previous = NULL;
+    uint32_t sequence = 0;
+    ACQ_block block;
+    uint8_t i;
+
+    printf("released in time\n");
+    for (i = 0; i < BENCH_BLOCKS; i++)
+    {
+        BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+        BENCH_expect(block.length == ACQ_BLOCK_SIZE, "block length");
+        BENCH_expect(sequence == 0 || block.sequence == sequence + 1, "consecutive sequence numbers");
+        BENCH_expect(block.samples != previous, "the halves alternate");
+        BENCH_expect(ACQ_release_block(), "release reports an intact block");
+        previous = block.samples;
+        sequence = block.sequence;
+    }
+    BENCH_expect(ACQ_get_overrun_count() == 0, "no overrun");
+}
+
+/**
+ * The DMA completes the other half while the block is held, it is writing
+ * into the held one now: ACQ_release_block() must report it. The completed
+ * half is still handed out.
+ */
+static void BENCH_late_release()
+{
+    ACQ_block block, next;
+
+    printf("released late\n");
+    ACQ_reset_overrun_count();
+    BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+    memcpy(bench_copy, block.samples, sizeof(bench_copy));
+
+    PLATFORM_wait_for_interrupt(); // other half complete, the DMA continues in ours
+    BENCH_expect(ACQ_get_overrun_count() == 1, "one overrun counted");
+    BENCH_expect(!ACQ_get_block(&next), "no second block while one is held");
+    BENCH_expect(!ACQ_release_block(), "release reports the overwritten block");
+
+    PLATFORM_wait_for_interrupt(); // the DMA filled our half completely
+    BENCH_expect(BENCH_is_changed(&block), "the block was really overwritten");
+    BENCH_expect(ACQ_get_block(&next), "the newest half is handed out");
+    BENCH_expect(next.sequence == block.sequence + 2, "sequence of the newest half");
+    BENCH_expect(ACQ_release_block(), "a block released in time is intact again");
+}
+
+/**
+ * Held over a whole wrap of the buffer: the DMA completed the other half
+ * and then the held one. Both completions count, and so does the half that
+ * could not be handed out.
+ */
+static void BENCH_held_over_wrap()
+{
+    ACQ_block block, next;
+
+    printf("held over a wrap\n");
+    ACQ_reset_overrun_count();
+    BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+    PLATFORM_wait_for_interrupt();
+    PLATFORM_wait_for_interrupt();
+    BENCH_expect(ACQ_get_overrun_count() == 3, "three overruns counted");
+    BENCH_expect(!ACQ_release_block(), "release reports the overwritten block");
+    BENCH_expect(!ACQ_get_block(&next), "no block pending after the wrap");
+    BENCH_expect(ACQ_wait_block(&next, 50), "the next block comes");
+    BENCH_expect(next.sequence == block.sequence + 3, "sequence of the next block");
+    BENCH_expect(ACQ_release_block(), "a block released in time is intact again");
+}
+
+/**
+ * Nothing fetched for two completions: the older block is lost and counted,
+ * the newer one is handed out intact.
+ */
+static void BENCH_not_fetched()
+{
+    ACQ_block block;
+    uint32_t sequence;
+
+    printf("not fetched\n");
+    BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+    sequence = block.sequence;
+    BENCH_expect(ACQ_release_block(), "release reports an intact block");
+    ACQ_reset_overrun_count();
+
+    PLATFORM_wait_for_interrupt();
+    PLATFORM_wait_for_interrupt();
+    BENCH_expect(ACQ_get_overrun_count() == 1, "the lost block is counted");
+    BENCH_expect(ACQ_get_block(&block), "the newer block is pending");
+    BENCH_expect(block.sequence == sequence + 2, "sequence of the newer block");
+    memcpy(bench_copy, block.samples, sizeof(bench_copy));
+    BENCH_expect(ACQ_release_block(), "release reports an intact block");
+    BENCH_expect(!BENCH_is_changed(&block), "the block was not touched while held");
+}
+
+/**
+ * ACQ_get_sample_index() between two completions: the block with sequence s
+ * starts at sample (s - 1) * ACQ_BLOCK_SIZE, time in between moves the index
+ * by the samples taken.
+ */
+static void BENCH_sample_index()
+{
+    ACQ_block block;
+    uint32_t index;
+    uint8_t i;
+
+    printf("sample index\n");
+    for (i = 0; i < 2; i++)
+    {
+        BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+        BENCH_expect(ACQ_release_block(), "release reports an intact block");
+        index = ACQ_get_sample_index();
+        BENCH_expect(index == block.sequence * ACQ_BLOCK_SIZE, "the index starts the next block");
+
+        PLATFORM_delay_ms(1); // less than a block
+        BENCH_expect(ACQ_get_sample_index() > index, "the index moves on");
+        BENCH_expect(ACQ_get_sample_index() < index + ACQ_BLOCK_SIZE, "the index stays in the block");
+        BENCH_expect(ACQ_wait_block(&block, 50), "block within the timeout");
+        BENCH_expect((block.sequence - 1) * ACQ_BLOCK_SIZE == index, "the block starts at the index");
+        ACQ_release_block();
+    }
+}
+
+// ###### functions
+
+int main()
+{
+    AFESIM_params params;
+    static AFESIM sim;
+
+    AFESIM_default_params(&params);
+    AFESIM_init(&sim, &params);
+    HOST_platform_init(&sim, -1);
+
+    ACQ_init();
+    ACQ_start();
+    BENCH_in_time();
+    BENCH_late_release();
+    BENCH_held_over_wrap();
+    BENCH_not_fetched();
+    BENCH_sample_index();
+    ACQ_stop();
+
+    printf("%s\n", bench_is_failed ? "FAILED" : "ok");
+    return bench_is_failed ? EXIT_FAILURE : 0;
+}
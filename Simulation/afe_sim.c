@@ -0,0 +1,363 @@
+#include "afe_sim.h"
+#include <math.h>
+#include <stddef.h>
+
+/*
+ * Twin-T notch as a second order section with zeros and poles at the tuning
+ * frequency wz:
+ *
+ *           wz^2 - w^2 + j w wz dz
+ *   H(jw) = ----------------------        dz = zero damping, dp = pole damping
+ *           wz^2 - w^2 + j w wz dp
+ *
+ *   wz = 1 / sqrt(L Ctot)
+ *   Ctot = Cfixed + p Csens eps' + C(D1) + k C(D2)
+ *   dz = dfixed + dloss eps'' - dC C(D2)
+ *
+ * The notch is perfect (H = 0) when wz equals the excitation and dz is zero,
+ * i.e. D1 compensates eps' and D2 compensates the losses.
+ *
+ * The ADC samples coherently at fs = 80 MHz / 653, the 20 MHz excitation and
+ * its 3rd harmonic both alias to fs / 4. The harmonic therefore ends up in the
+ * alias bin and sets a floor for the notch depth, as on the board.
+ */
+
+// ###### defines
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define AFESIM_DAC_CODE_MAX 4095
+
+// ###### private functions
+
+static uint64_t AFESIM_random(AFESIM *sim)
+{
+    // xorshift64*, reproducible for a given seed
+    sim->rng_state ^= sim->rng_state >> 12;
+    sim->rng_state ^= sim->rng_state << 25;
+    sim->rng_state ^= sim->rng_state >> 27;
+    return sim->rng_state * 2685821657736338717ULL;
+}
+
+/**
+ * Box-Muller, each pair of uniform numbers gives two normal samples.
+ */
+static double AFESIM_gaussian(AFESIM *sim)
+{
+    double u1, u2, radius;
+
+    if (sim->has_spare_gaussian)
+    {
+        sim->has_spare_gaussian = false;
+        return sim->spare_gaussian;
+    }
+
+    u1 = ((double)(AFESIM_random(sim) >> 11) + 1.0) / 9007199254740993.0; // (0, 1]
+    u2 = (double)(AFESIM_random(sim) >> 11) / 9007199254740992.0;
+    radius = sqrt(-2.0 * log(u1));
+
+    sim->spare_gaussian = radius * sin(2.0 * M_PI * u2);
+    sim->has_spare_gaussian = true;
+    return radius * cos(2.0 * M_PI * u2);
+}
+
+static double AFESIM_varactor_capacitance(const AFESIM_params *params, double bias_v)
+{
+    if (bias_v < 0.0)
+        bias_v = 0.0;
+    return params->varactor_cj0_f / pow(1.0 + bias_v / params->varactor_vj, params->varactor_m);
+}
+
+/**
+ * Inverse of AFESIM_varactor_capacitance().
+ * @return bias voltage, negative if the capacitance can not be reached
+ */
+static double AFESIM_varactor_bias(const AFESIM_params *params, double capacitance_f)
+{
+    if (capacitance_f <= 0.0 || capacitance_f > params->varactor_cj0_f)
+        return -1.0;
+    return params->varactor_vj * (pow(params->varactor_cj0_f / capacitance_f, 1.0 / params->varactor_m) - 1.0);
+}
+
+static double AFESIM_code_to_bias(const AFESIM_params *params, uint16_t code)
+{
+    return (double)code / AFESIM_DAC_CODE_MAX * params->dac_vref * params->bias_gain;
+}
+
+/**
+ * Complex transfer function of the notch at the angular frequency w.
+ */
+static void AFESIM_notch(const AFESIM *sim, double bias_d1_v, double bias_d2_v, double w, double *re, double *im)
+{
+    const AFESIM_params *params = &sim->params;
+    double c_d2 = AFESIM_varactor_capacitance(params, bias_d2_v);
+    double c_total = params->fixed_capacitance_f
+                     + params->sensor_participation * params->sensor_capacitance_f * sim->permittivity_real
+                     + AFESIM_varactor_capacitance(params, bias_d1_v) + params->d2_frequency_coupling * c_d2;
+    double wz = 1.0 / sqrt(params->inductance_h * c_total);
+    double dz = params->damping_fixed + params->damping_per_loss * sim->permittivity_imag
+                - params->damping_per_farad * c_d2;
+    double real = wz * wz - w * w;
+    double num_im = w * wz * dz;
+    double den_im = w * wz * params->pole_damping;
+    double den = real * real + den_im * den_im;
+
+    // (real + j num_im) / (real + j den_im)
+    *re = (real * real + num_im * den_im) / den;
+    *im = (num_im * real - real * den_im) / den;
+}
+
+/**
+ * Peak voltage of the excitation (fundamental and 3rd harmonic) at the notch input.
+ */
+static void AFESIM_notch_input(const AFESIM_params *params, double *fundamental_v, double *harmonic_v)
+{
+    double square_v = 0.5 * params->mco_vpp * 4.0 / M_PI;
+
+    *fundamental_v = square_v * params->lc_gain * params->preamp_gain;
+    *harmonic_v = *fundamental_v / 3.0 * pow(10.0, params->lc_third_harmonic_db / 20.0);
+}
+
+// ###### functions
+
+/**
+ * Board values from the signal path documentation. The inductance puts the
+ * notch to 20 MHz in air with D1 at 0.5 V bias, D2 nulls air at 2.5 V.
+ */
+void AFESIM_default_params(AFESIM_params *params)
+{
+    params->excitation_hz = 20e6;
+    params->mco_vpp = 3.3;
+    params->lc_gain = 0.18;
+    params->lc_third_harmonic_db = -60.0;
+    params->preamp_gain = 2.0;
+
+    params->inductance_h = 1.49e-6;
+    params->fixed_capacitance_f = 20e-12;
+    params->sensor_capacitance_f = 48e-12;
+    params->sensor_participation = 0.1;
+    params->d2_frequency_coupling = 0.1;
+    params->damping_fixed = 0.05;
+    params->damping_per_loss = 0.2;
+    params->damping_per_farad = 6.0e9;
+    params->pole_damping = 4.0;
+
+    params->varactor_cj0_f = 25e-12;
+    params->varactor_vj = 0.75;
+    params->varactor_m = 0.75;
+
+    params->dac_vref = 2.5;
+    params->bias_gain = 2.0;
+    params->bias_tau_s = 100e-6;
+
+    params->gain_factors[0] = 1.0;
+    params->gain_factors[1] = 10.0;
+    params->gain_factors[2] = 100.0;
+    params->output_offset_v = 1.25;
+    params->output_min_v = 0.0;
+    params->output_max_v = 2.5;
+
+    params->sample_rate_hz = 80e6 / 653.0;
+    params->adc_vref = 3.3;
+    params->adc_bits = 12;
+    params->noise_lsb = 1.5;
+    params->seed = 1;
+}
+
+/**
+ * Starts the simulation in air, both DACs at 0, gain 1x, biases settled.
+ */
+void AFESIM_init(AFESIM *sim, const AFESIM_params *params)
+{
+    sim->params = *params;
+    sim->permittivity_real = 1.0;
+    sim->permittivity_imag = 0.0;
+    sim->dac_codes[0] = 0;
+    sim->dac_codes[1] = 0;
+    sim->bias_v[0] = 0.0;
+    sim->bias_v[1] = 0.0;
+    sim->gain_index = 0;
+    sim->sample_index = 0;
+    sim->rng_state = ((uint64_t)params->seed << 1) | 1u; // xorshift state must not be 0
+    sim->has_spare_gaussian = false;
+}
+
+void AFESIM_set_snow(AFESIM *sim, double permittivity_real, double permittivity_imag)
+{
+    sim->permittivity_real = permittivity_real;
+    sim->permittivity_imag = permittivity_imag;
+}
+
+/**
+ * New DAC code, the varactor bias follows with bias_tau_s.
+ * @param channel: 0 = DAC1 OUT1 (D1, FRQ_TN), 1 = DAC1 OUT2 (D2, Q_FACT_TN)
+ */
+void AFESIM_set_dac(AFESIM *sim, uint8_t channel, uint16_t code)
+{
+    if (channel > 1)
+        return;
+    sim->dac_codes[channel] = (code > AFESIM_DAC_CODE_MAX) ? AFESIM_DAC_CODE_MAX : code;
+}
+
+/**
+ * Same decoding as hal_gain.c: 1x both low, 10x GAIN_SLCT_1, 100x both high.
+ */
+void AFESIM_set_gain_pins(AFESIM *sim, bool gain_slct_1, bool gain_slct_2)
+{
+    if (gain_slct_1 && gain_slct_2)
+        sim->gain_index = 2;
+    else if (gain_slct_1 || gain_slct_2)
+        sim->gain_index = 1;
+    else
+        sim->gain_index = 0;
+}
+
+/**
+ * Produces the next count ADC1 samples, continuing from the previous call.
+ * @param samples: right aligned raw ADC codes, as written by the DMA
+ */
+void AFESIM_generate(AFESIM *sim, uint16_t *samples, uint32_t count)
+{
+    const AFESIM_params *params = &sim->params;
+    double w = 2.0 * M_PI * params->excitation_hz;
+    double cycles_per_sample = params->excitation_hz / params->sample_rate_hz;
+    double settle = 1.0 - exp(-1.0 / (params->sample_rate_hz * params->bias_tau_s));
+    double lsb_per_volt = (double)(1u << params->adc_bits) / params->adc_vref;
+    double code_max = (double)((1u << params->adc_bits) - 1u);
+    double gain = params->gain_factors[sim->gain_index];
+    double fundamental_v, harmonic_v;
+    double h1_re = 0.0, h1_im = 0.0, h3_re = 0.0, h3_im = 0.0;
+    double phase = 2.0 * M_PI * fmod((double)sim->sample_index * cycles_per_sample, 1.0);
+    double step = 2.0 * M_PI * fmod(cycles_per_sample, 1.0);
+    double rot_re = cos(step), rot_im = sin(step);
+    double ph_re = cos(phase), ph_im = sin(phase); // e^(j phase) of the current sample
+    bool is_settled = false;
+    uint32_t i;
+    uint8_t ch;
+
+    AFESIM_notch_input(params, &fundamental_v, &harmonic_v);
+
+    for (i = 0; i < count; i++)
+    {
+        double ph3_re, ph3_im, v, code, next_re;
+
+        if (!is_settled)
+        {
+            is_settled = true;
+            for (ch = 0; ch < 2; ch++)
+            {
+                double target = AFESIM_code_to_bias(params, sim->dac_codes[ch]);
+
+                sim->bias_v[ch] += (target - sim->bias_v[ch]) * settle;
+                if (fabs(target - sim->bias_v[ch]) > 1e-7)
+                    is_settled = false;
+                else
+                    sim->bias_v[ch] = target;
+            }
+            AFESIM_notch(sim, sim->bias_v[0], sim->bias_v[1], w, &h1_re, &h1_im);
+            AFESIM_notch(sim, sim->bias_v[0], sim->bias_v[1], 3.0 * w, &h3_re, &h3_im);
+        }
+
+        // cos/sin of 3 phase from the fundamental phasor
+        ph3_re = ph_re * (4.0 * ph_re * ph_re - 3.0);
+        ph3_im = ph_im * (3.0 - 4.0 * ph_im * ph_im);
+        v = fundamental_v * (h1_re * ph_re - h1_im * ph_im) + harmonic_v * (h3_re * ph3_re - h3_im * ph3_im);
+
+        // rotate to the next sample; the phasor restarts exactly with every call
+        next_re = ph_re * rot_re - ph_im * rot_im;
+        ph_im = ph_re * rot_im + ph_im * rot_re;
+        ph_re = next_re;
+
+        v = v * gain + params->output_offset_v;
+        if (v < params->output_min_v)
+            v = params->output_min_v;
+        if (v > params->output_max_v)
+            v = params->output_max_v;
+
+        code = floor(v * lsb_per_volt + params->noise_lsb * AFESIM_gaussian(sim) + 0.5);
+        if (code < 0.0)
+            code = 0.0;
+        if (code > code_max)
+            code = code_max;
+
+        samples[i] = (uint16_t)code;
+        sim->sample_index++;
+    }
+}
+
+/**
+ * Advances the time by count samples without producing them (DAC settling).
+ */
+void AFESIM_skip(AFESIM *sim, uint32_t count)
+{
+    double settle = exp(-(double)count / (sim->params.sample_rate_hz * sim->params.bias_tau_s));
+    uint8_t ch;
+
+    for (ch = 0; ch < 2; ch++)
+    {
+        double target = AFESIM_code_to_bias(&sim->params, sim->dac_codes[ch]);
+
+        sim->bias_v[ch] = target + (sim->bias_v[ch] - target) * settle;
+    }
+    sim->sample_index += count;
+}
+
+/**
+ * |H| of the notch at the excitation frequency for the given varactor biases.
+ */
+double AFESIM_notch_gain(const AFESIM *sim, double bias_d1_v, double bias_d2_v)
+{
+    double re, im;
+
+    AFESIM_notch(sim, bias_d1_v, bias_d2_v, 2.0 * M_PI * sim->params.excitation_hz, &re, &im);
+    return sqrt(re * re + im * im);
+}
+
+/**
+ * Noise free peak amplitude of the excitation tone in ADC LSB, with settled
+ * biases, at the current gain and without clipping. Reference for detectors.
+ */
+double AFESIM_tone_amplitude_lsb(const AFESIM *sim, uint16_t code_d1, uint16_t code_d2)
+{
+    const AFESIM_params *params = &sim->params;
+    double fundamental_v, harmonic_v;
+    double notch = AFESIM_notch_gain(sim, AFESIM_code_to_bias(params, code_d1), AFESIM_code_to_bias(params, code_d2));
+
+    AFESIM_notch_input(params, &fundamental_v, &harmonic_v);
+    return fundamental_v * notch * params->gain_factors[sim->gain_index] * (double)(1u << params->adc_bits)
+           / params->adc_vref;
+}
+
+/**
+ * DAC codes (not rounded) of the perfect notch for the current snow.
+ * D2 cancels the zero damping, D1 then tunes the notch onto the excitation.
+ * @return false if the notch can not be reached within the DAC range
+ */
+bool AFESIM_ideal_codes(const AFESIM *sim, double *code_d1, double *code_d2)
+{
+    const AFESIM_params *params = &sim->params;
+    double w = 2.0 * M_PI * params->excitation_hz;
+    double bias_max = params->dac_vref * params->bias_gain;
+    double c_d2 = (params->damping_fixed + params->damping_per_loss * sim->permittivity_imag)
+                  / params->damping_per_farad;
+    double c_d1 = 1.0 / (w * w * params->inductance_h) - params->fixed_capacitance_f
+                  - params->sensor_participation * params->sensor_capacitance_f * sim->permittivity_real
+                  - params->d2_frequency_coupling * c_d2;
+    double bias_d1 = AFESIM_varactor_bias(params, c_d1);
+    double bias_d2 = AFESIM_varactor_bias(params, c_d2);
+
+    *code_d1 = bias_d1 / bias_max * AFESIM_DAC_CODE_MAX;
+    *code_d2 = bias_d2 / bias_max * AFESIM_DAC_CODE_MAX;
+
+    return bias_d1 >= 0.0 && bias_d1 <= bias_max && bias_d2 >= 0.0 && bias_d2 <= bias_max;
+}
+
+/**
+ * Simulated time since AFESIM_init().
+ */
+double AFESIM_elapsed_s(const AFESIM *sim)
+{
+    return (double)sim->sample_index / sim->params.sample_rate_hz;
+}
@@ -0,0 +1,96 @@
+#ifndef SIM_AFE_SIM_H_
+#define SIM_AFE_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host model of the analog front end (see Dokumentation/Signal Path):
+ *
+ *   MCO 20 MHz -> LC filter -> OPA836 x2 -> Twin-T notch (BB135 D1/D2, Csens)
+ *   -> OPA2690 1x/10x/100x -> OPA836 buffer + 1.25 V -> ADC1 (12 bit, noise)
+ *
+ * Lumped model meant for testing the tuning loop, not for circuit design:
+ * D1 and the sensor capacitance set the notch frequency, D2 and the snow
+ * losses set the notch depth. Both are reached through the same DAC codes
+ * and settling as on the board.
+ */
+
+// ###### typedefs
+
+typedef struct
+{
+    // excitation and LC filter
+    double excitation_hz;          // MCO1
+    double mco_vpp;                // square wave at PA8
+    double lc_gain;                // gain of the LC filter for the fundamental
+    double lc_third_harmonic_db;   // residual 3rd harmonic after the LC filter, relative to the fundamental
+    double preamp_gain;            // OPA836, non inverting +2
+
+    // Twin-T notch
+    double inductance_h;           // sets the notch frequency together with the capacitances below
+    double fixed_capacitance_f;
+    double sensor_capacitance_f;   // Csens in air
+    double sensor_participation;   // fraction of Csens that appears in the tuning node
+    double d2_frequency_coupling;  // fraction of C(D2) that also detunes the notch frequency
+    double damping_fixed;          // zero damping without sensor losses and without D2
+    double damping_per_loss;       // zero damping added per unit of eps''
+    double damping_per_farad;      // zero damping removed per farad of C(D2)
+    double pole_damping;           // passive Twin-T: 4 (Q = 0.25)
+
+    // BB135 varactors, C = cj0 / (1 + V / vj)^m
+    double varactor_cj0_f;
+    double varactor_vj;
+    double varactor_m;
+
+    // DAC bias path
+    double dac_vref;
+    double bias_gain;              // 0-2.5 V DAC -> 0-5 V varactor bias
+    double bias_tau_s;             // time constant of the bias filter
+
+    // gain stages and buffer
+    double gain_factors[3];        // GAIN_SLCT_1/2: none, 1, 1 and 2
+    double output_offset_v;
+    double output_min_v;
+    double output_max_v;
+
+    // ADC1
+    double sample_rate_hz;
+    double adc_vref;
+    uint8_t adc_bits;
+    double noise_lsb;              // rms white noise at the ADC input
+    uint32_t seed;
+} AFESIM_params;
+
+typedef struct
+{
+    AFESIM_params params;
+    double permittivity_real;      // eps'
+    double permittivity_imag;      // eps''
+    uint16_t dac_codes[2];
+    double bias_v[2];              // varactor bias including the settling
+    uint8_t gain_index;
+    uint64_t sample_index;
+    uint64_t rng_state;
+    double spare_gaussian;
+    bool has_spare_gaussian;
+} AFESIM;
+
+// ###### functions
+
+void AFESIM_default_params(AFESIM_params *params);
+void AFESIM_init(AFESIM *sim, const AFESIM_params *params);
+
+void AFESIM_set_snow(AFESIM *sim, double permittivity_real, double permittivity_imag);
+void AFESIM_set_dac(AFESIM *sim, uint8_t channel, uint16_t code);
+void AFESIM_set_gain_pins(AFESIM *sim, bool gain_slct_1, bool gain_slct_2);
+
+void AFESIM_generate(AFESIM *sim, uint16_t *samples, uint32_t count);
+void AFESIM_skip(AFESIM *sim, uint32_t count);
+
+double AFESIM_notch_gain(const AFESIM *sim, double bias_d1_v, double bias_d2_v);
+double AFESIM_tone_amplitude_lsb(const AFESIM *sim, uint16_t code_d1, uint16_t code_d2);
+bool AFESIM_ideal_codes(const AFESIM *sim, double *code_d1, double *code_d2);
+double AFESIM_elapsed_s(const AFESIM *sim);
+
+#endif /* SIM_AFE_SIM_H_ */
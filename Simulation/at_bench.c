@@ -0,0 +1,281 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "meas_config.h"
+#include "mw_at_parser.h"
+
+/*
+ * Replays NINA UART transcripts (see transcripts/) through the AT parser of
+ * the firmware and measures the parse cost per received byte. For comparison
+ * the same bytes go through the scheme of the MSP430 rf_handler.c: every poll
+ * (1 ms = 12 bytes at 115200 baud) the receive buffer is searched for each
+ * expected response until one is found, the buffer is only cleared when a
+ * command is sent. Polls without new bytes are not counted.
+ *
+ *   at_bench transcript...
+ *
+ * Transcript lines: "< bytes" received, "> bytes" sent, "! dsr" DSR pulse
+ * (data -> command mode), "#" comment. \r \n \\ \xHH are escapes.
+ */
+
+// ###### defines
+
+#define BENCH_MAX_BYTES 16384
+#define BENCH_MAX_SEGMENTS 256
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_POLL_BYTES 12          // received per 1 ms poll at 115200 baud
+#define BENCH_LEGACY_BUFFER_SIZE 256 // MAX_UART_BUFFER of the MSP430 code
+
+// ###### typedefs
+
+typedef enum
+{
+    BENCH_RX,
+    BENCH_TX,
+    BENCH_DSR
+} BENCH_direction;
+
+typedef struct
+{
+    BENCH_direction direction;
+    uint32_t offset; // into bytes[]
+    uint32_t length;
+} BENCH_segment;
+
+typedef struct
+{
+    uint8_t bytes[BENCH_MAX_BYTES];
+    uint32_t byte_count;
+    uint32_t rx_count;
+    BENCH_segment segments[BENCH_MAX_SEGMENTS];
+    uint32_t segment_count;
+} BENCH_transcript;
+
+// ###### global variables
+
+static const char *bench_token_names[] = {"OK", "ERROR", "STARTUP", "UUDPC", "UUDPD", "LINE", "DATA"};
+// in the order RF_cyclic() checks them
+static const char *bench_legacy_delimiters[] = {"+STARTUP\r", "ERROR\r\n", "OK\r\n", "+UUDPC:", "+UUDPD:"};
+
+static volatile uint32_t bench_sink; // keeps the compiler from dropping the replays
+
+// ###### private functions
+
+static double BENCH_now_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t BENCH_unescape(const char *text, uint8_t *out)
+{
+    uint32_t length = 0;
+
+    while (*text != '\0' && *text != '\n')
+    {
+        if (text[0] == '\\' && text[1] != '\0')
+        {
+            switch (text[1])
+            {
+            case 'r':
+                out[length++] = '\r';
+                text += 2;
+                continue;
+            case 'n':
+                out[length++] = '\n';
+                text += 2;
+                continue;
+            case 'x':
+                out[length++] = (uint8_t)strtoul((char[]){text[2], text[3], '\0'}, NULL, 16);
+                text += 4;
+                continue;
+            default:
+                out[length++] = (uint8_t)text[1];
+                text += 2;
+                continue;
+            }
+        }
+        out[length++] = (uint8_t)*text++;
+    }
+    return length;
+}
+
+static void BENCH_load(const char *path, BENCH_transcript *transcript)
+{
+    char line[1024];
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    memset(transcript, 0, sizeof(*transcript));
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        BENCH_segment *segment = &transcript->segments[transcript->segment_count];
+
+        if (line[0] != '<' && line[0] != '>' && line[0] != '!')
+            continue;
+        if (transcript->segment_count == BENCH_MAX_SEGMENTS || transcript->byte_count + sizeof(line) > BENCH_MAX_BYTES)
+        {
+            fprintf(stderr, "%s: transcript too long\n", path);
+            exit(EXIT_FAILURE);
+        }
+        segment->direction = (line[0] == '<') ? BENCH_RX : (line[0] == '>') ? BENCH_TX : BENCH_DSR;
+        segment->offset = transcript->byte_count;
+        segment->length = (segment->direction == BENCH_DSR) ? 0 : BENCH_unescape(&line[2], &transcript->bytes[segment->offset]);
+        transcript->byte_count += segment->length;
+        if (segment->direction == BENCH_RX)
+            transcript->rx_count += segment->length;
+        transcript->segment_count++;
+    }
+    fclose(file);
+}
+
+/**
+ * Runs the received bytes through the firmware parser. Data mode follows the
+ * firmware: entered with the OK to ATO1, left with the DSR pulse.
+ */
+static void BENCH_replay(const BENCH_transcript *transcript, uint32_t counts[], bool print)
+{
+    AT_parser parser;
+    AT_token token;
+    bool ato_pending = false;
+    uint32_t s, i;
+
+    AT_parser_init(&parser);
+    for (s = 0; s < transcript->segment_count; s++)
+    {
+        const BENCH_segment *segment = &transcript->segments[s];
+        const uint8_t *bytes = &transcript->bytes[segment->offset];
+
+        if (segment->direction == BENCH_TX)
+        {
+            ato_pending = (segment->length >= 4 && memcmp(bytes, "ATO1", 4) == 0);
+            continue;
+        }
+        if (segment->direction == BENCH_DSR)
+        {
+            AT_parser_set_data_mode(&parser, false);
+            continue;
+        }
+        for (i = 0; i < segment->length; i++)
+        {
+            if (!AT_parser_feed(&parser, bytes[i], &token))
+                continue;
+            counts[token.type]++;
+            if (print)
+                printf("  %-8s %s\n", bench_token_names[token.type], token.text);
+            if (token.type == AT_TOKEN_OK && ato_pending)
+            {
+                ato_pending = false;
+                AT_parser_set_data_mode(&parser, true);
+            }
+        }
+    }
+}
+
+/**
+ * The MSP430 scheme: bytes are appended to a fixed buffer (dropped when it is
+ * full), every poll runs the delimiter searches of RF_cyclic() over it.
+ */
+static uint32_t BENCH_replay_legacy(const BENCH_transcript *transcript)
+{
+    char buffer[BENCH_LEGACY_BUFFER_SIZE + 1];
+    uint32_t length = 0;
+    uint32_t hits = 0;
+    uint32_t s, i, d;
+
+    for (s = 0; s < transcript->segment_count; s++)
+    {
+        const BENCH_segment *segment = &transcript->segments[s];
+
+        if (segment->direction == BENCH_TX)
+        {
+            length = 0; // reset_uart_buffer() before a command
+            continue;
+        }
+        if (segment->direction != BENCH_RX)
+            continue;
+        for (i = 0; i < segment->length; i++)
+        {
+            if (length < BENCH_LEGACY_BUFFER_SIZE)
+                buffer[length++] = (char)transcript->bytes[segment->offset + i];
+            if ((i + 1) % BENCH_POLL_BYTES != 0 && i + 1 != segment->length)
+                continue;
+
+            buffer[length] = '\0';
+            for (d = 0; d < sizeof(bench_legacy_delimiters) / sizeof(bench_legacy_delimiters[0]); d++)
+            {
+                if (strstr(buffer, bench_legacy_delimiters[d]) != NULL)
+                {
+                    hits++;
+                    break;
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+static double BENCH_time_per_byte_ns(const BENCH_transcript *transcript, bool legacy)
+{
+    uint32_t counts[AT_TOKEN_DATA + 1];
+    uint32_t repetitions = 0;
+    double start = BENCH_now_s();
+    double elapsed;
+
+    do
+    {
+        if (legacy)
+            bench_sink += BENCH_replay_legacy(transcript);
+        else
+        {
+            memset(counts, 0, sizeof(counts));
+            BENCH_replay(transcript, counts, false);
+            bench_sink += counts[AT_TOKEN_OK];
+        }
+        repetitions++;
+        elapsed = BENCH_now_s() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    return elapsed * 1e9 / ((double)repetitions * transcript->rx_count);
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    static BENCH_transcript transcript;
+    int a;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s transcript...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (a = 1; a < argc; a++)
+    {
+        uint32_t counts[AT_TOKEN_DATA + 1] = {0};
+        uint32_t t;
+
+        BENCH_load(argv[a], &transcript);
+        printf("%s (%u bytes received)\n", argv[a], transcript.rx_count);
+        BENCH_replay(&transcript, counts, true);
+
+        printf("  tokens  ");
+        for (t = 0; t <= AT_TOKEN_DATA; t++)
+            printf(" %s=%u", bench_token_names[t], counts[t]);
+        printf("\n  parser   %6.2f ns/byte\n", BENCH_time_per_byte_ns(&transcript, false));
+        printf("  legacy   %6.2f ns/byte (buffer search every %u bytes)\n\n", BENCH_time_per_byte_ns(&transcript, true),
+               BENCH_POLL_BYTES);
+    }
+    return 0;
+}
@@ -0,0 +1,687 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "afe_sim.h"
+#include "meas_config.h"
+#include "dsp_fft.h"
+#include "dsp_goertzel.h"
+#include "dsp_lockin.h"
+#include "dsp_q15.h"
+#include "dsp_rfft.h"
+#include "dsp_sdft.h"
+
+/*
+ * Checks the real FFT and magnitude functions of dsp_rfft.h and the fixed
+ * point block pipeline of dsp_q15.h against a DFT in double precision and
+ * measures them. The lock-in of dsp_lockin.h is checked against the DFT and
+ * on the notch response of the model. The blocks come from the front-end
+ * model (tone on the alias bin, harmonics, noise) plus full scale white noise
+ * for the q15 scaling. Only DSP_BACKEND_PORTABLE has been built and checked,
+ * CMSIS-DSP is not in the tree.
+ *
+ *   dsp_bench [seed]
+ *
+ * Exit code 1 if a tolerance is exceeded.
+ */
+
+// ###### defines
+
+#define BENCH_BLOCKS 8
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_F32_TOLERANCE 1e-5      // error relative to the largest bin
+#define BENCH_Q15_TOLERANCE 8.0       // LSB of X(k) / length in q15
+#define BENCH_MAG_TOLERANCE 1.0       // LSB of the 2.14 magnitude
+#define BENCH_TONE_TOLERANCE 1e-3     // q15 single bin, relative
+#define BENCH_SPECTRUM_TOLERANCE 3.0  // q15 spectrum, magnitude steps (rounding of the q15 FFT stages)
+#define BENCH_ODD_LENGTH (ACQ_BLOCK_SIZE - 64) // even but no power of two, too much for the real FFT
+#define BENCH_SDFT_TOLERANCE 1e-4     // sliding DFT against the DFT of the same window, relative
+#define BENCH_SDFT_CHUNK 32           // samples per push, a short DMA half-block
+#define BENCH_SDFT_LONG_RUN 10000000UL
+#define BENCH_SDFT_SETTLED 0.01       // step response: within 1 % of the final amplitude
+#define BENCH_SDFT_STEP_AT (2 * ACQ_BLOCK_SIZE + 200) // sample the DAC step falls on, within a block
+#define BENCH_GOERTZEL_LONG 1580      // longest block DSP_goertzel_init() accepts for bin 1
+#define BENCH_GOERTZEL_TOLERANCE 0.1  // LSB against the DFT (Q30 rounding), an overflow is off by far more
+#define BENCH_LOCKIN_TOLERANCE 1e-4   // lock-in against the DFT of the same samples, relative
+#define BENCH_LOCKIN_SPAN 256         // D1 codes on each side of the notch
+#define BENCH_LOCKIN_STEP 4
+#define BENCH_LOCKIN_MARGIN 8         // codes around the minimum where the side may be wrong (noise)
+#define BENCH_LOCKIN_D2_OFFSET 100    // D2 off its ideal code, the minimum is not a zero then
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### global variables
+
+static uint16_t bench_blocks[BENCH_BLOCKS][ACQ_BLOCK_SIZE];
+static volatile float bench_sink; // keeps the compiler from dropping the transforms
+static DSP_q15 bench_q15[2];      // rectangular, Hann
+
+// ###### private functions
+
+static double BENCH_now_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void BENCH_generate(uint32_t seed)
+{
+    AFESIM_params params;
+    static AFESIM sim;
+    uint16_t b, i;
+
+    AFESIM_default_params(&params);
+    params.seed = seed;
+    AFESIM_init(&sim, &params);
+    srand(seed);
+    for (b = 0; b < BENCH_BLOCKS; b++)
+    {
+        if (b == BENCH_BLOCKS - 1)
+        {
+            for (i = 0; i < ACQ_BLOCK_SIZE; i++)
+                bench_blocks[b][i] = (uint16_t)(rand() % 4096);
+            continue;
+        }
+        // from deep in the notch to far off it
+        AFESIM_set_dac(&sim, 1, (uint16_t)(300 + b * 400));
+        AFESIM_set_dac(&sim, 2, 1500);
+        AFESIM_skip(&sim, 4 * ACQ_BLOCK_SIZE);
+        AFESIM_generate(&sim, bench_blocks[b], ACQ_BLOCK_SIZE);
+    }
+}
+
+static void BENCH_dft(const double *x, uint16_t length, uint16_t k, double *re, double *im)
+{
+    uint16_t n;
+
+    *re = 0.0;
+    *im = 0.0;
+    for (n = 0; n < length; n++)
+    {
+        double w = 2.0 * M_PI * (double)((uint32_t)k * n % length) / length;
+
+        *re += x[n] * cos(w);
+        *im -= x[n] * sin(w);
+    }
+}
+
+/**
+ * Goertzel detector on bin 1 of the longest block it accepts, with the
+ * inputs that drive its state furthest: a block at full scale DC and a full
+ * scale tone on the bin. An overflow of the 32 bit state shows up as an
+ * amplitude far off the DFT.
+ * @return largest amplitude error in LSB
+ */
+static double BENCH_check_goertzel_range()
+{
+    static uint16_t samples[BENCH_GOERTZEL_LONG];
+    static double x[BENCH_GOERTZEL_LONG];
+    DSP_goertzel goertzel;
+    DSP_tone tone;
+    double re, im, error = 0.0;
+    uint16_t n;
+    int signal;
+
+    if (!DSP_goertzel_init(&goertzel, 1, BENCH_GOERTZEL_LONG))
+        return INFINITY;
+    for (signal = 0; signal < 2; signal++)
+    {
+        for (n = 0; n < BENCH_GOERTZEL_LONG; n++)
+        {
+            double phase = 2.0 * M_PI * n / BENCH_GOERTZEL_LONG;
+
+            samples[n] = signal == 0 ? 4095 : (uint16_t)lround(2047.5 + 2047.5 * cos(phase));
+            x[n] = samples[n];
+        }
+        DSP_goertzel_process(&goertzel, samples, &tone);
+        BENCH_dft(x, BENCH_GOERTZEL_LONG, 1, &re, &im);
+        error = fmax(error, fabs(tone.amplitude - 2.0 * hypot(re, im) / BENCH_GOERTZEL_LONG));
+    }
+    return error;
+}
+
+/**
+ * @return largest error of one length over all blocks, relative (f32) / in LSB (q15, magnitude)
+ */
+static void BENCH_check(uint16_t length, double *f32_error, double *q15_error, double *mag_error)
+{
+    static double x[ACQ_BLOCK_SIZE];
+    static float samples[ACQ_BLOCK_SIZE];
+    static float spectrum[ACQ_BLOCK_SIZE];
+    static int16_t samples_q15[ACQ_BLOCK_SIZE];
+    static int16_t spectrum_q15[ACQ_BLOCK_SIZE + 2];
+    static int16_t magnitudes_q15[ACQ_BLOCK_SIZE / 2 + 1];
+    DSP_rfft rfft;
+    uint16_t b, k, n;
+
+    *f32_error = *q15_error = *mag_error = 0.0;
+    if (!DSP_rfft_init(&rfft, length))
+    {
+        *f32_error = *q15_error = *mag_error = HUGE_VAL;
+        return;
+    }
+    for (b = 0; b < BENCH_BLOCKS; b++)
+    {
+        double largest = 0.0;
+        double error = 0.0;
+
+        // q15: 12-bit ADC value around mid scale, shifted to full scale
+        for (n = 0; n < length; n++)
+        {
+            samples_q15[n] = (int16_t)(((int32_t)bench_blocks[b][n] - 2048) * 16);
+            x[n] = samples_q15[n];
+            samples[n] = (float)x[n];
+        }
+        DSP_rfft_f32(&rfft, samples, spectrum);
+        DSP_rfft_q15(&rfft, samples_q15, spectrum_q15);
+        DSP_cmplx_mag_q15(spectrum_q15, magnitudes_q15, length / 2 + 1);
+
+        for (k = 0; k <= length / 2; k++)
+        {
+            double re, im, got_re, got_im, magnitude;
+
+            BENCH_dft(x, length, k, &re, &im);
+            got_re = k == 0 ? spectrum[0] : k == length / 2 ? spectrum[1] : spectrum[2 * k];
+            got_im = k == 0 || k == length / 2 ? 0.0 : spectrum[2 * k + 1];
+            error = fmax(error, hypot(got_re - re, got_im - im));
+            largest = fmax(largest, hypot(re, im));
+
+            *q15_error = fmax(*q15_error, fabs(spectrum_q15[2 * k] - re / length));
+            *q15_error = fmax(*q15_error, fabs(spectrum_q15[2 * k + 1] - im / length));
+            magnitude = hypot(spectrum_q15[2 * k], spectrum_q15[2 * k + 1]) / 2.0;
+            *mag_error = fmax(*mag_error, fabs(magnitudes_q15[k] - magnitude));
+        }
+        *f32_error = fmax(*f32_error, error / largest);
+    }
+}
+
+static double BENCH_time_ns(uint16_t length, bool q15)
+{
+    static float samples[ACQ_BLOCK_SIZE];
+    static float spectrum[ACQ_BLOCK_SIZE];
+    static float magnitudes[ACQ_BLOCK_SIZE / 2];
+    static int16_t samples_q15[ACQ_BLOCK_SIZE];
+    static int16_t spectrum_q15[ACQ_BLOCK_SIZE + 2];
+    static int16_t magnitudes_q15[ACQ_BLOCK_SIZE / 2 + 1];
+    DSP_rfft rfft;
+    uint32_t runs = 0;
+    double start_s = BENCH_now_s();
+    double elapsed_s;
+    uint16_t n;
+
+    if (!DSP_rfft_init(&rfft, length))
+        return HUGE_VAL;
+    do
+    {
+        if (q15)
+        {
+            // the input is the work buffer of arm_rfft_q15
+            for (n = 0; n < length; n++)
+                samples_q15[n] = (int16_t)(((int32_t)bench_blocks[0][n] - 2048) * 16);
+            DSP_rfft_q15(&rfft, samples_q15, spectrum_q15);
+            DSP_cmplx_mag_q15(spectrum_q15, magnitudes_q15, length / 2 + 1);
+            bench_sink = magnitudes_q15[length / 4];
+        }
+        else
+        {
+            for (n = 0; n < length; n++)
+                samples[n] = (float)bench_blocks[0][n];
+            DSP_rfft_f32(&rfft, samples, spectrum);
+            DSP_cmplx_mag_f32(spectrum, magnitudes, length / 2);
+            bench_sink = magnitudes[length / 4];
+        }
+        runs++;
+        elapsed_s = BENCH_now_s() - start_s;
+    } while (elapsed_s < BENCH_MIN_SECONDS);
+    return elapsed_s * 1e9 / runs;
+}
+
+/**
+ * The q15 pipeline on the raw blocks against the windowed DFT of the block
+ * without its mean, in double.
+ * @param tone_error: largest relative error of the alias bin amplitude
+ * @param spectrum_error: largest error of the spectrum in ADC LSB
+ */
+static void BENCH_check_q15(const DSP_q15 *q15, double *tone_error, double *spectrum_error)
+{
+    static double x[ACQ_BLOCK_SIZE];
+    static int16_t magnitudes[ACQ_BLOCK_SIZE / 2 + 1];
+    double window_sum = 0.0;
+    uint16_t b, k, n;
+
+    *tone_error = *spectrum_error = 0.0;
+    for (n = 0; n < ACQ_BLOCK_SIZE; n++)
+        window_sum += q15->window_q15[n];
+    for (b = 0; b < BENCH_BLOCKS; b++)
+    {
+        double mean = 0.0;
+        double re, im, amplitude;
+        DSP_tone tone;
+
+        for (n = 0; n < ACQ_BLOCK_SIZE; n++)
+            mean += bench_blocks[b][n];
+        mean /= ACQ_BLOCK_SIZE;
+        for (n = 0; n < ACQ_BLOCK_SIZE; n++)
+            x[n] = (bench_blocks[b][n] - mean) * q15->window_q15[n];
+
+        DSP_q15_tone(q15, bench_blocks[b], &tone);
+        BENCH_dft(x, ACQ_BLOCK_SIZE, ACQ_ALIAS_BIN, &re, &im);
+        amplitude = 2.0 * hypot(re, im) / window_sum;
+        *tone_error = fmax(*tone_error, fabs(tone.amplitude - amplitude) / amplitude);
+
+        if (!DSP_q15_spectrum((DSP_q15 *)q15, bench_blocks[b], magnitudes))
+        {
+            *spectrum_error = HUGE_VAL;
+            return;
+        }
+        for (k = 1; k < ACQ_BLOCK_SIZE / 2; k++)
+        {
+            BENCH_dft(x, ACQ_BLOCK_SIZE, k, &re, &im);
+            amplitude = 2.0 * hypot(re, im) / window_sum;
+            *spectrum_error =
+                fmax(*spectrum_error, fabs(magnitudes[k] * DSP_q15_get_lsb_per_magnitude(q15) - amplitude));
+        }
+    }
+}
+
+/**
+ * The sliding DFT pushed in chunks over the model blocks one after the other
+ * (a stream with jumps between the blocks), after every chunk against the DFT
+ * of the last window in double, then after BENCH_SDFT_LONG_RUN noise samples
+ * against the sum recomputed from the window.
+ * @param error: largest relative error of the amplitude, phase error in rad
+ * @return the long run sums are exact
+ */
+static bool BENCH_check_sdft(DSP_sdft *sdft, double *error, double *phase_error)
+{
+    static uint16_t stream[(BENCH_BLOCKS - 1) * ACQ_BLOCK_SIZE];
+    static uint16_t noise[BENCH_SDFT_CHUNK];
+    static double x[SDFT_WINDOW_LENGTH];
+    uint32_t count = (BENCH_BLOCKS - 1) * ACQ_BLOCK_SIZE;
+    uint32_t n, i;
+    int64_t re = 0, im = 0;
+
+    *error = *phase_error = 0.0;
+    for (n = 0; n < count; n++)
+        stream[n] = bench_blocks[n / ACQ_BLOCK_SIZE][n % ACQ_BLOCK_SIZE];
+
+    if (!DSP_sdft_init(sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, SDFT_WINDOW_LENGTH))
+        return false;
+    for (n = 0; n < count; n += BENCH_SDFT_CHUNK)
+    {
+        double dft_re, dft_im, amplitude;
+        DSP_tone tone;
+
+        DSP_sdft_push(sdft, &stream[n], BENCH_SDFT_CHUNK);
+        if (!DSP_sdft_is_valid(sdft))
+            continue;
+        for (i = 0; i < SDFT_WINDOW_LENGTH; i++)
+            x[i] = stream[n + BENCH_SDFT_CHUNK - SDFT_WINDOW_LENGTH + i];
+        BENCH_dft(x, SDFT_WINDOW_LENGTH, ACQ_ALIAS_BIN * SDFT_WINDOW_LENGTH / ACQ_BLOCK_SIZE, &dft_re, &dft_im);
+        amplitude = 2.0 * hypot(dft_re, dft_im) / SDFT_WINDOW_LENGTH;
+        DSP_sdft_get_tone(sdft, &tone);
+        *error = fmax(*error, fabs(tone.amplitude - amplitude) / amplitude);
+        *phase_error = fmax(*phase_error, fabs(remainder(tone.phase - atan2(dft_im, dft_re), 2.0 * M_PI)));
+    }
+
+    for (n = 0; n < BENCH_SDFT_LONG_RUN; n += BENCH_SDFT_CHUNK)
+    {
+        for (i = 0; i < BENCH_SDFT_CHUNK; i++)
+            noise[i] = (uint16_t)(rand() % 4096);
+        DSP_sdft_push(sdft, noise, BENCH_SDFT_CHUNK);
+    }
+    // history[position] is the oldest sample, it met the reference at phase
+    for (i = 0; i < SDFT_WINDOW_LENGTH; i++)
+    {
+        uint16_t sample = sdft->history[(sdft->position + i) % SDFT_WINDOW_LENGTH];
+        uint16_t phase = (uint16_t)((sdft->phase + i) % sdft->period);
+
+        re += (int64_t)sample * sdft->cos_q15[phase];
+        im += (int64_t)sample * sdft->sin_q15[phase];
+    }
+    return re == sdft->re && im == sdft->im;
+}
+
+/**
+ * Step of DAC 1 on the front-end model from the notch to off it, within a
+ * block as the tuning writes it at any time: time from the step until the
+ * sliding DFT (one update per BENCH_SDFT_CHUNK) and the block Goertzel (one
+ * update per ACQ_BLOCK_SIZE) report within BENCH_SDFT_SETTLED of the final amplitude.
+ */
+static void BENCH_sdft_step(DSP_sdft *sdft, uint16_t window, double *sdft_us, double *block_us)
+{
+    static uint16_t samples[40 * ACQ_BLOCK_SIZE];
+    uint32_t count = sizeof(samples) / sizeof(samples[0]);
+    AFESIM_params params;
+    static AFESIM sim;
+    DSP_goertzel goertzel;
+    DSP_tone tone;
+    double final_amplitude;
+    uint32_t n;
+
+    AFESIM_default_params(&params);
+    AFESIM_init(&sim, &params);
+    AFESIM_set_dac(&sim, 1, 300);
+    AFESIM_set_dac(&sim, 2, 1500);
+    AFESIM_skip(&sim, 40 * ACQ_BLOCK_SIZE);
+    AFESIM_generate(&sim, samples, BENCH_SDFT_STEP_AT);
+    AFESIM_set_dac(&sim, 1, 1500);
+    AFESIM_generate(&sim, &samples[BENCH_SDFT_STEP_AT], count - BENCH_SDFT_STEP_AT);
+
+    DSP_goertzel_init(&goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE);
+    DSP_goertzel_process(&goertzel, &samples[count - ACQ_BLOCK_SIZE], &tone);
+    final_amplitude = tone.amplitude;
+
+    *block_us = *sdft_us = -1.0;
+    for (n = BENCH_SDFT_STEP_AT - BENCH_SDFT_STEP_AT % ACQ_BLOCK_SIZE + ACQ_BLOCK_SIZE; n <= count && *block_us < 0.0;
+         n += ACQ_BLOCK_SIZE)
+    {
+        DSP_goertzel_process(&goertzel, &samples[n - ACQ_BLOCK_SIZE], &tone);
+        if (fabs(tone.amplitude - final_amplitude) < BENCH_SDFT_SETTLED * final_amplitude)
+            *block_us = (n - BENCH_SDFT_STEP_AT) * 1e6 / ACQ_SAMPLE_RATE_HZ;
+    }
+    if (!DSP_sdft_init(sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, window))
+        return;
+    for (n = 0; n + BENCH_SDFT_CHUNK <= count && *sdft_us < 0.0; n += BENCH_SDFT_CHUNK)
+    {
+        DSP_sdft_push(sdft, &samples[n], BENCH_SDFT_CHUNK);
+        if (!DSP_sdft_is_valid(sdft))
+            continue;
+        DSP_sdft_get_tone(sdft, &tone);
+        if (n + BENCH_SDFT_CHUNK > BENCH_SDFT_STEP_AT
+            && fabs(tone.amplitude - final_amplitude) < BENCH_SDFT_SETTLED * final_amplitude)
+            *sdft_us = (n + BENCH_SDFT_CHUNK - BENCH_SDFT_STEP_AT) * 1e6 / ACQ_SAMPLE_RATE_HZ;
+    }
+}
+
+/**
+ * Lock-in phasor of the model tone with D1 at code, after the bias settled.
+ * Blocks start at multiples of ACQ_BLOCK_SIZE, so the phases are comparable.
+ */
+static void BENCH_lockin_at(AFESIM *sim, DSP_lockin *lockin, uint16_t code, DSP_lockin_result *result)
+{
+    static uint16_t block[ACQ_BLOCK_SIZE];
+
+    AFESIM_set_dac(sim, 0, code);
+    AFESIM_skip(sim, 4 * ACQ_BLOCK_SIZE);
+    AFESIM_generate(sim, block, ACQ_BLOCK_SIZE);
+    DSP_lockin_process(lockin, block, ACQ_BLOCK_SIZE, result);
+}
+
+/**
+ * The lock-in on the model blocks against the DFT of the alias bin, on whole
+ * blocks and one sample short (only whole reference periods may count, the
+ * rest of the buffer is set to full scale). Then on a notch response: D1
+ * stepped across the notch with D2 off its ideal code and the reference
+ * perpendicular to the chord between the phasors at both ends, as in
+ * TUNING_search_phase(). DSP_lockin_notch_side() has to point to the minimum
+ * of the model amplitude at every code further than BENCH_LOCKIN_MARGIN.
+ * @param error: largest relative error of the amplitude, phase error in rad
+ * @return number of codes with the wrong side
+ */
+static uint16_t BENCH_check_lockin(double *error, double *phase_error)
+{
+    static uint16_t samples[ACQ_BLOCK_SIZE];
+    static double x[ACQ_BLOCK_SIZE];
+    static AFESIM sim;
+    AFESIM_params params;
+    DSP_lockin lockin;
+    DSP_lockin_result result, lower_result, upper_result;
+    double ideal_d1, ideal_d2, chord_re, chord_im;
+    double smallest = INFINITY;
+    uint16_t lower, upper, minimum = 0, code, wrong = 0;
+    uint16_t b, n, length, used;
+
+    *error = *phase_error = 0.0;
+    if (!DSP_lockin_init(&lockin, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, 0))
+        return UINT16_MAX;
+    for (b = 0; b < BENCH_BLOCKS; b++)
+    {
+        for (length = ACQ_BLOCK_SIZE - 1; length <= ACQ_BLOCK_SIZE; length++)
+        {
+            double re, im, amplitude;
+
+            used = length - length % lockin.period;
+            for (n = 0; n < ACQ_BLOCK_SIZE; n++)
+                samples[n] = n < used ? bench_blocks[b][n] : 4095;
+            for (n = 0; n < used; n++)
+                x[n] = samples[n];
+            DSP_lockin_process(&lockin, samples, length, &result);
+            BENCH_dft(x, used, (uint16_t)((uint32_t)ACQ_ALIAS_BIN * used / ACQ_BLOCK_SIZE), &re, &im);
+            amplitude = 2.0 * hypot(re, im) / used;
+            *error = fmax(*error, fabs(result.magnitude - amplitude) / amplitude);
+            *phase_error = fmax(*phase_error, fabs(remainder(result.phase - atan2(im, re), 2.0 * M_PI)));
+        }
+    }
+
+    AFESIM_default_params(&params);
+    AFESIM_init(&sim, &params);
+    AFESIM_ideal_codes(&sim, &ideal_d1, &ideal_d2);
+    AFESIM_set_dac(&sim, 1, (uint16_t)lround(ideal_d2 + BENCH_LOCKIN_D2_OFFSET));
+    lower = (uint16_t)lround(ideal_d1 - BENCH_LOCKIN_SPAN);
+    upper = (uint16_t)lround(ideal_d1 + BENCH_LOCKIN_SPAN);
+    for (code = lower; code <= upper; code += BENCH_LOCKIN_STEP)
+    {
+        double amplitude = AFESIM_tone_amplitude_lsb(&sim, code, sim.dac_codes[1]);
+
+        if (amplitude < smallest)
+        {
+            smallest = amplitude;
+            minimum = code;
+        }
+    }
+
+    BENCH_lockin_at(&sim, &lockin, lower, &lower_result);
+    BENCH_lockin_at(&sim, &lockin, upper, &upper_result);
+    chord_re = upper_result.magnitude * cos(upper_result.phase) - lower_result.magnitude * cos(lower_result.phase);
+    chord_im = upper_result.magnitude * sin(upper_result.phase) - lower_result.magnitude * sin(lower_result.phase);
+    DSP_lockin_set_reference(&lockin, (float)(atan2(chord_im, chord_re) - 0.5 * M_PI));
+    for (code = lower; code <= upper; code += BENCH_LOCKIN_STEP)
+    {
+        int8_t expected = code + BENCH_LOCKIN_MARGIN < minimum ? -1 : code > minimum + BENCH_LOCKIN_MARGIN ? 1 : 0;
+
+        BENCH_lockin_at(&sim, &lockin, code, &result);
+        if (expected != 0 && DSP_lockin_notch_side(&result) != expected)
+            wrong++;
+    }
+    return wrong;
+}
+
+typedef enum
+{
+    BENCH_GOERTZEL,
+    BENCH_Q15_TONE,
+    BENCH_Q15_TONE_HANN,
+    BENCH_F32_SPECTRUM,
+    BENCH_Q15_SPECTRUM
+} BENCH_detector;
+
+/**
+ * @return host time per raw ACQ_BLOCK_SIZE block
+ */
+static double BENCH_time_block_ns(BENCH_detector detector)
+{
+    static float magnitudes[ACQ_BLOCK_SIZE / 2];
+    static int16_t magnitudes_q15[ACQ_BLOCK_SIZE / 2 + 1];
+    DSP_goertzel goertzel;
+    DSP_tone tone = {0};
+    uint32_t runs = 0;
+    double start_s = BENCH_now_s();
+    double elapsed_s;
+
+    DSP_goertzel_init(&goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE);
+    do
+    {
+        const uint16_t *samples = bench_blocks[runs % BENCH_BLOCKS];
+
+        switch (detector)
+        {
+        case BENCH_GOERTZEL:
+            DSP_goertzel_process(&goertzel, samples, &tone);
+            break;
+        case BENCH_Q15_TONE:
+            DSP_q15_tone(&bench_q15[0], samples, &tone);
+            break;
+        case BENCH_Q15_TONE_HANN:
+            DSP_q15_tone(&bench_q15[1], samples, &tone);
+            break;
+        case BENCH_F32_SPECTRUM:
+            DSP_fft_spectrum(samples, ACQ_BLOCK_SIZE, magnitudes);
+            tone.amplitude = magnitudes[ACQ_ALIAS_BIN];
+            break;
+        case BENCH_Q15_SPECTRUM:
+            DSP_q15_spectrum(&bench_q15[0], samples, magnitudes_q15);
+            tone.amplitude = magnitudes_q15[ACQ_ALIAS_BIN];
+            break;
+        }
+        bench_sink = tone.amplitude;
+        runs++;
+        elapsed_s = BENCH_now_s() - start_s;
+    } while (elapsed_s < BENCH_MIN_SECONDS);
+    return elapsed_s * 1e9 / runs;
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1;
+    bool is_failed = false;
+    DSP_goertzel goertzel;
+    DSP_tone fft_tone, goertzel_tone;
+    double tone_error = 0.0;
+    uint16_t length, b;
+
+    BENCH_generate(seed);
+
+    printf("length  f32 error  q15 error  mag error   f32 ns    q15 ns\n");
+    for (length = 32; length <= ACQ_BLOCK_SIZE; length *= 2)
+    {
+        double f32_error, q15_error, mag_error;
+
+        BENCH_check(length, &f32_error, &q15_error, &mag_error);
+        printf("%6u  %9.2e  %6.1f LSB  %5.1f LSB  %7.0f  %7.0f\n", length, f32_error, q15_error, mag_error,
+               BENCH_time_ns(length, false), BENCH_time_ns(length, true));
+        if (f32_error > BENCH_F32_TOLERANCE || q15_error > BENCH_Q15_TOLERANCE || mag_error > BENCH_MAG_TOLERANCE)
+            is_failed = true;
+    }
+
+    // the FFT tone detector on top of the wrapper against the Goertzel detector
+    if (!DSP_goertzel_init(&goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE))
+        is_failed = true;
+    for (b = 0; b < BENCH_BLOCKS - 1; b++)
+    {
+        DSP_fft_tone(bench_blocks[b], ACQ_BLOCK_SIZE, ACQ_ALIAS_BIN, &fft_tone);
+        DSP_goertzel_process(&goertzel, bench_blocks[b], &goertzel_tone);
+        tone_error = fmax(tone_error, fabs(fft_tone.amplitude - goertzel_tone.amplitude) / goertzel_tone.amplitude);
+    }
+    printf("alias bin %u: FFT and Goertzel amplitude within %.1e\n", (unsigned)ACQ_ALIAS_BIN, tone_error);
+    if (tone_error > 1e-4)
+        is_failed = true;
+
+    // a length the real FFT does not support has to be refused, not transformed
+    {
+        static int16_t magnitudes_q15[ACQ_BLOCK_SIZE / 2 + 1];
+        DSP_rfft rfft;
+        bool is_refused;
+
+        DSP_q15_init(&bench_q15[0], ACQ_ALIAS_BIN, BENCH_ODD_LENGTH, false);
+        is_refused = !DSP_rfft_init(&rfft, BENCH_ODD_LENGTH) && rfft.length == 0
+                     && !DSP_fft_tone(bench_blocks[0], BENCH_ODD_LENGTH, ACQ_ALIAS_BIN, &fft_tone)
+                     && !DSP_q15_spectrum(&bench_q15[0], bench_blocks[0], magnitudes_q15);
+        printf("length %u (no power of two): FFT %s\n", BENCH_ODD_LENGTH, is_refused ? "refused" : "ACCEPTED");
+        if (!is_refused)
+            is_failed = true;
+    }
+
+    // fixed point pipeline from the raw block
+    DSP_q15_init(&bench_q15[0], ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, false);
+    DSP_q15_init(&bench_q15[1], ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, true);
+    printf("\nraw block of %u   tone error  spectrum error (step)\n", ACQ_BLOCK_SIZE);
+    for (b = 0; b < 2; b++)
+    {
+        double tone_q15_error, spectrum_error;
+        double step = DSP_q15_get_lsb_per_magnitude(&bench_q15[b]);
+
+        BENCH_check_q15(&bench_q15[b], &tone_q15_error, &spectrum_error);
+        printf("q15 %-12s  %9.1e  %9.3f LSB (%.2f LSB)\n", b == 0 ? "rectangular" : "Hann", tone_q15_error,
+               spectrum_error, step);
+        if (tone_q15_error > BENCH_TONE_TOLERANCE || spectrum_error > BENCH_SPECTRUM_TOLERANCE * step)
+            is_failed = true;
+    }
+    printf("ns per block: Goertzel %.0f, q15 tone %.0f, q15 tone Hann %.0f, f32 spectrum %.0f, q15 spectrum %.0f\n",
+           BENCH_time_block_ns(BENCH_GOERTZEL), BENCH_time_block_ns(BENCH_Q15_TONE),
+           BENCH_time_block_ns(BENCH_Q15_TONE_HANN), BENCH_time_block_ns(BENCH_F32_SPECTRUM),
+           BENCH_time_block_ns(BENCH_Q15_SPECTRUM));
+
+    // sliding DFT, continuous over the stream
+    {
+        static DSP_sdft sdft;
+        double sdft_error, phase_error, sdft_us, block_us;
+        bool is_exact = BENCH_check_sdft(&sdft, &sdft_error, &phase_error);
+        bool is_refused;
+        double start_s = BENCH_now_s();
+        uint32_t runs;
+
+        printf("\nsliding DFT, window %u, pushed by %u: amplitude within %.1e, phase within %.1e rad\n",
+               SDFT_WINDOW_LENGTH, BENCH_SDFT_CHUNK, sdft_error, phase_error);
+        printf("after %lu samples the sums are %s\n", (unsigned long)BENCH_SDFT_LONG_RUN,
+               is_exact ? "exact" : "off (drift)");
+        if (sdft_error > BENCH_SDFT_TOLERANCE || !is_exact)
+            is_failed = true;
+
+        for (runs = 0; BENCH_now_s() - start_s < BENCH_MIN_SECONDS; runs++)
+            DSP_sdft_push(&sdft, bench_blocks[runs % BENCH_BLOCKS], ACQ_BLOCK_SIZE);
+        bench_sink = (float)sdft.re;
+        printf("ns per block: %.0f\n", (BENCH_now_s() - start_s) * 1e9 / runs);
+
+        BENCH_sdft_step(&sdft, SDFT_WINDOW_LENGTH, &sdft_us, &block_us);
+        printf("DAC step, within %.0f %% after: block detector %.0f us, sliding DFT %.0f us", BENCH_SDFT_SETTLED * 100.0,
+               block_us, sdft_us);
+        BENCH_sdft_step(&sdft, SDFT_WINDOW_LENGTH / 4, &sdft_us, &block_us);
+        printf(", window %u %.0f us\n", SDFT_WINDOW_LENGTH / 4, sdft_us);
+
+        // windows that overflow the history or cut a period must be refused
+        is_refused = !DSP_sdft_init(&sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, SDFT_WINDOW_LENGTH + 4)
+                     && !DSP_sdft_init(&sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, SDFT_WINDOW_LENGTH / 4 + 1)
+                     && !DSP_sdft_init(&sdft, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE, 0);
+        printf("window too long, not whole periods or empty: %s\n", is_refused ? "refused" : "ACCEPTED");
+        if (!is_refused)
+            is_failed = true;
+    }
+
+    // Goertzel at the limit of its 32 bit state, longer blocks or other bins must be refused
+    {
+        double goertzel_error = BENCH_check_goertzel_range();
+        bool is_refused = !DSP_goertzel_init(&goertzel, 1, BENCH_GOERTZEL_LONG + 1)
+                          && !DSP_goertzel_init(&goertzel, 1, 4096) && !DSP_goertzel_init(&goertzel, 0, ACQ_BLOCK_SIZE)
+                          && !DSP_goertzel_init(&goertzel, ACQ_BLOCK_SIZE / 2, ACQ_BLOCK_SIZE);
+
+        printf("\nGoertzel bin 1 of %u at full scale: amplitude within %.1e LSB\n", BENCH_GOERTZEL_LONG,
+               goertzel_error);
+        printf("bin 1 of %u or 4096, bin 0 or length / 2: %s\n", BENCH_GOERTZEL_LONG + 1,
+               is_refused ? "refused" : "ACCEPTED");
+        if (goertzel_error > BENCH_GOERTZEL_TOLERANCE || !is_refused)
+            is_failed = true;
+    }
+
+    // lock-in, against the DFT and on the notch response
+    {
+        double lockin_error, phase_error;
+        uint16_t wrong = BENCH_check_lockin(&lockin_error, &phase_error);
+
+        printf("\nlock-in: amplitude within %.1e, phase within %.1e rad, notch side wrong at %u of %u codes\n",
+               lockin_error, phase_error, wrong, 2 * BENCH_LOCKIN_SPAN / BENCH_LOCKIN_STEP + 1);
+        if (lockin_error > BENCH_LOCKIN_TOLERANCE || phase_error > BENCH_LOCKIN_TOLERANCE || wrong > 0)
+            is_failed = true;
+    }
+
+    printf("%s\n", is_failed ? "FAILED" : "ok");
+    return is_failed ? EXIT_FAILURE : 0;
+}
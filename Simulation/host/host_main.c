@@ -0,0 +1,411 @@
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "afe_sim.h"
+#include "nina_emu.h"
+#include "platform_host.h"
+#include "al_app.h"
+#include "mw_outbox.h"
+#include "al_radio.h"
+#include "al_dspbench.h"
+#include "al_track.h"
+#include "al_warmstart.h"
+
+/*
+ * Runs the firmware measure-and-transmit cycle (al_app.c) as a Linux process
+ * against the front end model, as fast as the host allows.
+ *
+ *   host_firmware [-n cycles] [-s seed] [-d drift] [-p] [-w pause]
+ *                 [-e] [-c connect] [-r period] [-L latency] [-E error] [-X silence] [-D drop] [-B baud]
+ *                 [-F flash] [-K words] [-o peer] [-a] [-b press] [-k]
+ *
+ *   -n  number of cycles (default 1000)
+ *   -s  seed of the ADC noise
+ *   -d  random walk of eps' per cycle (default 0.002, snow slowly changing)
+ *   -p  connect UART4 to a pty, its name is printed on stderr
+ *   -w  pause between cycles in ms (APP_idle(), serves the NINA link), default 0:
+ *       without a module answering the firmware gives up after RF_MAX_REBOOTS
+ *       boot timeouts (fatal error, with the radio duty cycle the session ends)
+ *   -e  emulated NINA module on UART4 (nina_emu.c) instead of the pty, needs -w
+ *   -c  time in s the emulated peer connects (default 2)
+ *   -r  the peer disconnects after this many s and reconnects 1 s later (default 0: stays)
+ *   -L  answer latency of the module in ms (default 2)
+ *   -E  probability of ERROR instead of the answer, per command
+ *   -X  probability of a lost answer, per command
+ *   -D  probability of a lost byte module -> board
+ *   -B  highest baud rate the module accepts with AT+UMRS (115200: no upgrade)
+ *   -F  image of the outbox flash, loaded at the start and saved at the end:
+ *       consecutive runs behave like the board across a reset
+ *   -K  a reset cuts off the programming of this double word of the outbox
+ *       flash (counted after APP_init(), 1 = first), the run ends with that
+ *       cycle; with -F the next run starts from there
+ *   -o  file for the bytes the emulated peer receives (Tools/frame_decoder)
+ *   -a  the emulated peer is in range and connects by itself whenever the
+ *       module is connectable (radio duty cycle), instead of -c / -r
+ *   -b  time in s B1 is pressed
+ *   -k  cold search every cycle, the warm start point is dropped before it
+ *       (like after a power loss)
+ *
+ * Prints host throughput (cycles per second of CPU time) and the simulated
+ * latency of a cycle on the board, with -e also the link statistics.
+ */
+
+// ###### private functions
+
+static int HOST_open_pty()
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        perror("pty");
+        exit(EXIT_FAILURE);
+    }
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "UART4 on %s\n", ptsname(fd));
+    return fd;
+}
+
+static void HOST_print_nina(const NINAEMU *nina, double elapsed_s)
+{
+    const NINAEMU_statistics *statistics = &nina->statistics;
+
+    printf("NINA                %u boots, %llu commands, %u escapes\n", statistics->boots,
+           (unsigned long long)statistics->commands, statistics->escapes);
+    printf("injected            %llu ERROR, %llu lost answers, %llu lost bytes\n",
+           (unsigned long long)statistics->injected_errors, (unsigned long long)statistics->injected_silences,
+           (unsigned long long)statistics->dropped_bytes);
+    printf("wrong baud rate     %llu bytes\n", (unsigned long long)statistics->garbled_bytes);
+    printf("peer                %llu bytes (%.0f B/s), %u connects\n", (unsigned long long)statistics->peer_bytes,
+           statistics->peer_bytes / elapsed_s, statistics->connections);
+    if (statistics->recoveries > 0)
+        printf("connect -> data     %.3f s mean, %.3f s max\n", statistics->recovery_sum_s / statistics->recoveries,
+               statistics->recovery_max_s);
+}
+
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX
+static void HOST_print_outbox()
+{
+    OUTBOX_statistics statistics;
+
+    OUTBOX_get_statistics(&statistics);
+    printf("outbox              %u appended, %u sent, %u pending, %u dropped, %u corrupt, %u flash errors\n",
+           statistics.appended, statistics.sent, statistics.pending, statistics.dropped, statistics.corrupt,
+           HOST_platform_get_flash_errors());
+}
+
+#if APP_RADIO_DUTY_CYCLE
+static void HOST_print_radio(double elapsed_s)
+{
+    RADIO_statistics statistics;
+    uint32_t booted;
+    uint32_t connected;
+
+    RADIO_get_statistics(&statistics);
+    booted = statistics.sessions - statistics.boot_failures;
+    connected = booted - statistics.failed_sessions;
+    printf("radio               %u sessions (%u without peer, %u boot failures), on %.1f%% of the time, %.0f mJ\n",
+           statistics.sessions, statistics.failed_sessions, statistics.boot_failures,
+           0.1 * statistics.on_ms / elapsed_s, statistics.energy_mj);
+    if (statistics.sessions == 0)
+        return;
+    printf("radio session       boot %.0f ms, connect %.0f ms mean, %.1f mJ mean\n",
+           booted > 0 ? (double)statistics.boot_ms / booted : 0.0,
+           connected > 0 ? (double)statistics.connect_ms / connected : 0.0,
+           statistics.energy_mj / statistics.sessions);
+}
+#endif
+#endif
+
+#if APP_TRACKING
+static void HOST_print_tracking(uint32_t tracked, double tracked_amplitude_sum, double searched_amplitude_sum,
+                                uint32_t cycles)
+{
+    TRACK_statistics statistics;
+
+    TRACK_get_statistics(&statistics);
+    printf("tracking            %u of %u cycles, %u slope probes, %u locks lost\n", tracked, cycles,
+           statistics.identifications, statistics.losses);
+    printf("notch amplitude     %.2f LSB tracked, %.2f LSB searched (mean)\n",
+           tracked > 0 ? tracked_amplitude_sum / tracked : 0.0,
+           cycles > tracked ? searched_amplitude_sum / (cycles - tracked) : 0.0);
+}
+#endif
+
+#if APP_DSP_BENCHMARK
+static void HOST_print_dsp_benchmark()
+{
+    DSPBENCH_result result;
+
+    DSPBENCH_get_result(&result);
+    printf("block detectors     host time in 80 MHz cycles per block (DSPBENCH_run on the board: CPU cycles)\n");
+    printf("  single bin        Goertzel %u, lock-in %u, q15 %u, q15 Hann %u\n", result.goertzel, result.lockin,
+           result.q15_tone, result.q15_tone_hann);
+    printf("  spectrum          f32 %u, q15 %u\n", result.f32_spectrum, result.q15_spectrum);
+    printf("  amplitude         Goertzel %.2f LSB, q15 %.2f LSB\n", result.goertzel_amplitude, result.q15_amplitude);
+}
+#endif
+
+/**
+ * Hands what the peer received to the output file (if any).
+ */
+static void HOST_read_peer(NINAEMU *nina, FILE *output)
+{
+    uint8_t received[256];
+    uint32_t count;
+
+    while ((count = NINAEMU_peer_read(nina, received, sizeof(received))) > 0)
+    {
+        if (output != NULL)
+            fwrite(received, 1, count, output);
+    }
+}
+
+static double HOST_now_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    AFESIM_params params;
+    AFESIM sim;
+    NINAEMU_params nina_params;
+    static NINAEMU nina;
+    bool use_nina = false;
+    double connect_s = 2.0;
+    double reconnect_period_s = 0.0;
+    double peer_event_s;
+    APP_report report;
+    uint32_t cycles = 1000;
+    uint32_t pause_ms = 0;
+    double drift = 0.002;
+    double permittivity_real = 1.6;
+    double latency_sum_ms = 0.0;
+    uint32_t latency_max_ms = 0;
+    uint64_t evaluations = 0;
+    uint32_t warm_starts = 0;
+    uint32_t tracked = 0;
+    double tracked_amplitude_sum = 0.0;
+    double searched_amplitude_sum = 0.0;
+    double wall_start, wall_s;
+    int uart_fd = -1;
+    const char *flash_path = NULL;
+    uint32_t cut_words = 0;
+    FILE *peer_output = NULL;
+    bool peer_in_range = false;
+    double button_s = -1.0;
+    bool is_cold = false;
+    double amplitude_max = 0.0;
+    uint32_t i;
+    int option;
+
+    AFESIM_default_params(&params);
+    NINAEMU_default_params(&nina_params);
+    while ((option = getopt(argc, argv, "n:s:d:pw:ec:r:L:E:X:D:B:F:K:o:ab:k")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            cycles = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            params.seed = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            drift = atof(optarg);
+            break;
+        case 'p':
+            uart_fd = HOST_open_pty();
+            break;
+        case 'w':
+            pause_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            use_nina = true;
+            break;
+        case 'c':
+            connect_s = atof(optarg);
+            break;
+        case 'r':
+            reconnect_period_s = atof(optarg);
+            break;
+        case 'L':
+            nina_params.latency_s = atof(optarg) * 1e-3;
+            break;
+        case 'E':
+            nina_params.error_probability = atof(optarg);
+            break;
+        case 'X':
+            nina_params.silence_probability = atof(optarg);
+            break;
+        case 'D':
+            nina_params.drop_probability = atof(optarg);
+            break;
+        case 'B':
+            nina_params.max_baud_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'F':
+            flash_path = optarg;
+            break;
+        case 'K':
+            cut_words = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            peer_output = fopen(optarg, "wb");
+            if (peer_output == NULL)
+            {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'a':
+            peer_in_range = true;
+            break;
+        case 'b':
+            button_s = atof(optarg);
+            break;
+        case 'k':
+            is_cold = true;
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-n cycles] [-s seed] [-d drift] [-p] [-w pause]\n"
+                    "       [-e] [-c connect] [-r period] [-L latency] [-E error] [-X silence] [-D drop] [-B baud]\n"
+                    "       [-F flash] [-K words] [-o peer] [-a] [-b press] [-k]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    AFESIM_init(&sim, &params);
+    AFESIM_set_snow(&sim, permittivity_real, 0.05);
+    HOST_platform_init(&sim, uart_fd);
+    if (flash_path != NULL && !HOST_platform_load_flash(flash_path))
+    {
+        fprintf(stderr, "%s: not an outbox image\n", flash_path);
+        return EXIT_FAILURE;
+    }
+    if (use_nina)
+    {
+        nina_params.seed = params.seed;
+        NINAEMU_init(&nina, &nina_params);
+        HOST_platform_attach_nina(&nina);
+        NINAEMU_set_peer_in_range(&nina, peer_in_range, 0.0);
+    }
+    peer_event_s = peer_in_range ? 1e30 : connect_s;
+    srand(params.seed);
+
+    APP_init();
+    HOST_platform_cut_flash(cut_words);
+
+    wall_start = HOST_now_s();
+    for (i = 0; i < cycles; i++)
+    {
+        permittivity_real += drift * (2.0 * rand() / RAND_MAX - 1.0);
+        AFESIM_set_snow(&sim, permittivity_real, 0.05);
+
+        if (is_cold)
+            WARMSTART_invalidate();
+        APP_cycle(&report);
+        if (pause_ms > 0)
+            APP_idle(pause_ms);
+
+        if (button_s >= 0.0 && AFESIM_elapsed_s(&sim) >= button_s)
+        {
+            HOST_platform_press_button();
+            button_s = -1.0;
+        }
+        if (use_nina)
+            HOST_read_peer(&nina, peer_output);
+        if (use_nina && AFESIM_elapsed_s(&sim) >= peer_event_s)
+        {
+            if (!nina.peer_connected)
+            {
+                NINAEMU_connect_peer(&nina, AFESIM_elapsed_s(&sim));
+                peer_event_s = reconnect_period_s > 0.0 ? AFESIM_elapsed_s(&sim) + reconnect_period_s : 1e30;
+            }
+            else
+            {
+                NINAEMU_disconnect_peer(&nina, AFESIM_elapsed_s(&sim));
+                peer_event_s = AFESIM_elapsed_s(&sim) + 1.0;
+            }
+        }
+
+        latency_sum_ms += report.telemetry.duration_ms;
+        if (report.telemetry.duration_ms > latency_max_ms)
+            latency_max_ms = report.telemetry.duration_ms;
+        evaluations += report.telemetry.evaluations;
+        if (report.telemetry.warm_start)
+            warm_starts++;
+        if (report.is_tracked)
+        {
+            tracked++;
+            tracked_amplitude_sum += report.result.amplitude;
+        }
+        else
+            searched_amplitude_sum += report.result.amplitude;
+        if (report.result.amplitude > amplitude_max)
+            amplitude_max = report.result.amplitude;
+        if (HOST_platform_is_flash_cut())
+        {
+            cycles = i + 1;
+            break;
+        }
+    }
+    wall_s = HOST_now_s() - wall_start;
+
+    printf("cycles              %u%s\n", cycles,
+           HOST_platform_is_flash_cut() ? ", then a reset while programming the flash" : "");
+    printf("host time           %.3f s (%.0f cycles/s)\n", wall_s, cycles / wall_s);
+    printf("board latency       %.1f ms mean, %u ms max\n", latency_sum_ms / cycles, latency_max_ms);
+    printf("evaluations         %.1f per cycle\n", (double)evaluations / cycles);
+    printf("warm starts         %u of %u\n", warm_starts, cycles);
+    printf("notch amplitude     %.2f LSB mean, %.2f max\n",
+           (tracked_amplitude_sum + searched_amplitude_sum) / cycles, amplitude_max);
+    printf("UART4               %llu bytes, %u baud at the end, busy %.2f%%\n",
+           (unsigned long long)HOST_platform_get_uart_bytes(), HOST_platform_get_uart_baud_rate(),
+           100.0 * HOST_platform_get_uart_busy_s() / AFESIM_elapsed_s(&sim));
+    printf("simulated time      %.1f s\n", AFESIM_elapsed_s(&sim));
+    if (use_nina)
+        HOST_print_nina(&nina, AFESIM_elapsed_s(&sim));
+#if APP_TRACKING
+    HOST_print_tracking(tracked, tracked_amplitude_sum, searched_amplitude_sum, cycles);
+#endif
+#if APP_DSP_BENCHMARK
+    HOST_print_dsp_benchmark();
+#endif
+#if APP_OUTPUT_FORMAT == APP_OUTPUT_FRAME && APP_OUTBOX
+    HOST_print_outbox();
+#if APP_RADIO_DUTY_CYCLE
+    HOST_print_radio(AFESIM_elapsed_s(&sim));
+#endif
+#endif
+
+    if (flash_path != NULL && !HOST_platform_save_flash(flash_path))
+        perror(flash_path);
+    if (peer_output != NULL)
+        fclose(peer_output);
+
+    if (uart_fd >= 0)
+        close(uart_fd);
+    return 0;
+}
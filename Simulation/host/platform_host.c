@@ -0,0 +1,596 @@
+#include "platform_host.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+#include "meas_config.h"
+#include "hal_acq.h"
+#include "hal_sweep.h"
+#include "hal_serial.h"
+#include "nina_emu.h"
+
+/*
+ * Linux implementation of platform.h (and of the hardware sweep in hal_sweep.h).
+ * There is no real time: the clock is the sample counter of the front end
+ * model. Waiting for an interrupt or delaying produces the ADC samples of that
+ * time span directly into the "DMA" buffer and signals the half/full
+ * completions to hal_acq.c exactly like the DMA interrupt does. Bytes from
+ * the pty (or from the attached NINA emulator) are delivered to hal_serial.c
+ * whenever simulated time passes.
+ */
+
+// ###### defines
+
+#define HOST_UART_BITS_PER_BYTE 10 // 8N1
+#define HOST_FLASH_SIZE ((uint32_t)OUTBOX_FLASH_PAGES * PLATFORM_FLASH_PAGE_SIZE)
+#define HOST_FLASH_ERASE_S 22e-3 // page erase, STM32L476 datasheet
+#define HOST_FLASH_PROGRAM_S 82e-6 // one double word
+
+// ###### global variables
+
+static AFESIM *host_sim = NULL;
+static int host_uart_fd = -1;
+static NINAEMU *host_nina = NULL;
+static uint64_t host_uart_bytes = 0;
+static double host_uart_busy_s = 0.0;
+static uint32_t host_uart_baud_rate = SERIAL_BAUD_RATE_DEFAULT;
+static uint64_t host_uart_tx_remaining = 0; // samples until the running transfer is done
+static bool host_uart_tx_active = false;
+static uint8_t *host_uart_rx_buffer = NULL;
+static uint16_t host_uart_rx_length = 0;
+static uint16_t host_uart_rx_position = 0; // next byte the "DMA" writes
+static double host_time_remainder = 0.0; // fraction of a sample left over by delays
+static bool host_pins[PLATFORM_PIN_COUNT];
+
+static PLATFORM_timer_callback host_timer_callback = NULL;
+static uint64_t host_timer_remaining = 0; // samples until the one shot timer fires
+
+static uint16_t *host_adc_buffer = NULL;
+static uint32_t host_adc_length = 0;
+static uint32_t host_adc_position = 0;
+static bool host_adc_running = false;
+
+static const uint16_t *host_sweep_codes = NULL;
+static uint16_t host_sweep_length = 0;
+static uint16_t host_sweep_step = 0;
+static uint32_t host_sweep_samples = 0; // samples into the current step
+static uint8_t host_sweep_output = 0;
+static bool host_sweep_active = false;
+
+static bool host_is_button_pressed = false;
+
+static uint8_t host_flash[HOST_FLASH_SIZE];
+static uint32_t host_flash_errors = 0; // programming a double word that is neither erased nor set to zero
+static bool host_flash_ecc_errors[HOST_FLASH_SIZE / 8]; // double words a reset cut off while programming
+static uint32_t host_flash_cut_words = 0; // double words programmed until the reset of HOST_platform_cut_flash()
+static bool host_is_flash_cut = false;
+
+// ###### private functions
+
+/**
+ * Moves what has arrived on the pty into the circular receive buffer and
+ * reports the new position like the idle line interrupt does.
+ */
+static void HOST_poll_uart_rx()
+{
+    ssize_t count;
+
+    if ((host_uart_fd < 0 && host_nina == NULL) || host_uart_rx_buffer == NULL)
+        return;
+
+    do
+    {
+        uint8_t *target = &host_uart_rx_buffer[host_uart_rx_position];
+        uint16_t space = host_uart_rx_length - host_uart_rx_position;
+
+        if (host_nina != NULL)
+            count = NINAEMU_transmit(host_nina, target, space, host_uart_baud_rate, AFESIM_elapsed_s(host_sim));
+        else
+            count = read(host_uart_fd, target, space); // fd is non blocking
+        if (count <= 0)
+            return;
+        host_uart_rx_position = (uint16_t)((host_uart_rx_position + count) % host_uart_rx_length);
+        SERIAL_on_rx_event(host_uart_rx_position);
+    } while (host_uart_rx_position == 0); // wrapped, more may be waiting
+}
+
+/**
+ * Lets time pass: with a running ADC the samples are generated into the
+ * buffer, every completed half is reported to hal_acq.c. The end of a UART
+ * transfer is reported to hal_serial.c at its sample.
+ */
+static void HOST_advance(uint64_t samples)
+{
+    while (samples > 0)
+    {
+        uint32_t half = host_adc_length / 2;
+        bool adc_running = host_adc_running && half > 0;
+        uint64_t chunk = samples;
+
+        if (adc_running)
+        {
+            if (chunk > half - host_adc_position % half)
+                chunk = half - host_adc_position % half;
+            if (host_sweep_active && chunk > TUNING_SWEEP_SAMPLES_PER_STEP - host_sweep_samples)
+                chunk = TUNING_SWEEP_SAMPLES_PER_STEP - host_sweep_samples;
+        }
+        if (host_uart_tx_active && chunk > host_uart_tx_remaining)
+            chunk = host_uart_tx_remaining;
+        if (host_timer_callback != NULL && chunk > host_timer_remaining)
+            chunk = host_timer_remaining;
+        samples -= chunk;
+
+        if (!adc_running)
+            AFESIM_skip(host_sim, (uint32_t)chunk);
+        else
+        {
+            AFESIM_generate(host_sim, &host_adc_buffer[host_adc_position], (uint32_t)chunk);
+            host_adc_position += (uint32_t)chunk;
+
+            // staircase: next code after every TUNING_SWEEP_SAMPLES_PER_STEP samples
+            if (host_sweep_active)
+            {
+                host_sweep_samples += (uint32_t)chunk;
+                if (host_sweep_samples == TUNING_SWEEP_SAMPLES_PER_STEP)
+                {
+                    host_sweep_samples = 0;
+                    if (host_sweep_step + 1 < host_sweep_length)
+                        AFESIM_set_dac(host_sim, host_sweep_output, host_sweep_codes[++host_sweep_step]);
+                }
+            }
+        }
+
+        if (host_uart_tx_active)
+        {
+            host_uart_tx_remaining -= chunk;
+            if (host_uart_tx_remaining == 0)
+            {
+                host_uart_tx_active = false;
+                SERIAL_on_tx_complete(); // may start the next transfer
+            }
+        }
+
+        if (host_timer_callback != NULL)
+        {
+            host_timer_remaining -= chunk;
+            if (host_timer_remaining == 0)
+            {
+                PLATFORM_timer_callback callback = host_timer_callback;
+
+                host_timer_callback = NULL;
+                callback();
+            }
+        }
+
+        HOST_poll_uart_rx();
+
+        if (adc_running && host_adc_position % half == 0)
+        {
+            uint8_t completed = (host_adc_position == half) ? 0 : 1;
+
+            if (host_adc_position == host_adc_length)
+                host_adc_position = 0;
+            ACQ_on_dma_block_complete(completed);
+        }
+    }
+}
+
+static void HOST_advance_seconds(double seconds)
+{
+    double samples = seconds * host_sim->params.sample_rate_hz + host_time_remainder;
+    uint64_t whole = (uint64_t)samples;
+
+    host_time_remainder = samples - (double)whole;
+    HOST_advance(whole);
+}
+
+// ###### functions
+
+/**
+ * @param sim: front end model that produces the ADC samples
+ * @param uart_fd: file descriptor UART4 is connected to (pty master), -1 to discard
+ */
+void HOST_platform_init(AFESIM *sim, int uart_fd)
+{
+    host_sim = sim;
+    host_uart_fd = uart_fd;
+    // status LEDs of the NINA module are active low: off
+    host_pins[PLATFORM_PIN_NINA_LED_RED] = true;
+    host_pins[PLATFORM_PIN_NINA_LED_BLUE] = true;
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    memset(host_flash_ecc_errors, 0, sizeof(host_flash_ecc_errors));
+}
+
+/**
+ * Loads the outbox flash from an image written by HOST_platform_save_flash(),
+ * the state a reset leaves behind. A missing file is erased flash. The map
+ * of double ECC errors follows the flash contents, an image without it has
+ * none.
+ */
+bool HOST_platform_load_flash(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    bool is_complete;
+
+    if (file == NULL)
+        return errno == ENOENT;
+    is_complete = fread(host_flash, 1, sizeof(host_flash), file) == sizeof(host_flash);
+    if (fread(host_flash_ecc_errors, 1, sizeof(host_flash_ecc_errors), file) != sizeof(host_flash_ecc_errors))
+        memset(host_flash_ecc_errors, 0, sizeof(host_flash_ecc_errors));
+    fclose(file);
+    return is_complete;
+}
+
+bool HOST_platform_save_flash(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    bool is_complete;
+
+    if (file == NULL)
+        return false;
+    is_complete = fwrite(host_flash, 1, sizeof(host_flash), file) == sizeof(host_flash) &&
+                  fwrite(host_flash_ecc_errors, 1, sizeof(host_flash_ecc_errors), file) ==
+                      sizeof(host_flash_ecc_errors);
+    return fclose(file) == 0 && is_complete;
+}
+
+/**
+ * A reset cuts off the programming of the given double word, counted from
+ * now: half of it is written and it has a double ECC error. From then on the
+ * flash takes no writes or erases, the board is in reset. The run is meant
+ * to end there (HOST_platform_is_flash_cut()) and go on from the saved image.
+ */
+void HOST_platform_cut_flash(uint32_t words)
+{
+    host_flash_cut_words = words;
+}
+
+bool HOST_platform_is_flash_cut()
+{
+    return host_is_flash_cut;
+}
+
+uint32_t HOST_platform_get_flash_errors()
+{
+    return host_flash_errors;
+}
+
+void HOST_platform_press_button()
+{
+    host_is_button_pressed = true;
+}
+
+/**
+ * Connects UART4, RST, DTR and the status LED inputs to the emulated module
+ * instead of the pty.
+ */
+void HOST_platform_attach_nina(NINAEMU *nina)
+{
+    host_nina = nina;
+}
+
+uint64_t HOST_platform_get_uart_bytes()
+{
+    return host_uart_bytes;
+}
+
+/**
+ * @return time UART4 has been transmitting
+ */
+double HOST_platform_get_uart_busy_s()
+{
+    return host_uart_busy_s;
+}
+
+uint32_t HOST_platform_get_uart_baud_rate()
+{
+    return host_uart_baud_rate;
+}
+
+bool HOST_platform_get_pin(PLATFORM_pin pin)
+{
+    return host_pins[pin];
+}
+
+/**
+ * Drives an input pin (NINA status LEDs).
+ */
+void HOST_platform_set_pin(PLATFORM_pin pin, bool level)
+{
+    host_pins[pin] = level;
+}
+
+// ###### platform.h
+
+uint32_t PLATFORM_get_tick_ms()
+{
+    return (uint32_t)(AFESIM_elapsed_s(host_sim) * 1000.0);
+}
+
+void PLATFORM_delay_ms(uint32_t delay_ms)
+{
+    HOST_advance_seconds(delay_ms * 1e-3);
+}
+
+/**
+ * Host CPU time (not simulated time) in cycles of the 80 MHz core clock, so
+ * cycle counts measured with it are host time, not Cortex-M4 cycles.
+ */
+uint32_t PLATFORM_get_cycle_count()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec) * (ACQ_TRIGGER_CLOCK_HZ / 1000000UL) / 1000ULL);
+}
+
+/**
+ * Sleeps until the next "interrupt": the next DMA half completion, the end of
+ * a UART transfer, the one shot timer, or the next SysTick if none is pending.
+ */
+void PLATFORM_wait_for_interrupt()
+{
+    uint64_t samples = 0;
+
+    if (host_adc_running && host_adc_length > 0)
+        samples = host_adc_length / 2 - host_adc_position % (host_adc_length / 2);
+    if (host_uart_tx_active && (samples == 0 || host_uart_tx_remaining < samples))
+        samples = host_uart_tx_remaining;
+    if (host_timer_callback != NULL && (samples == 0 || host_timer_remaining < samples))
+        samples = host_timer_remaining;
+
+    if (samples > 0)
+        HOST_advance(samples);
+    else
+        HOST_advance_seconds(1e-3);
+}
+
+void PLATFORM_irq_disable()
+{
+    // single threaded, the "interrupts" only run inside HOST_advance()
+}
+
+void PLATFORM_irq_enable()
+{
+}
+
+void PLATFORM_fatal_error()
+{
+    fprintf(stderr, "fatal error at t = %.3f s\n", AFESIM_elapsed_s(host_sim));
+    exit(EXIT_FAILURE);
+}
+
+void PLATFORM_pin_write(PLATFORM_pin pin, bool level)
+{
+    host_pins[pin] = level;
+    if (pin == PLATFORM_PIN_GAIN_SLCT_1 || pin == PLATFORM_PIN_GAIN_SLCT_2)
+        AFESIM_set_gain_pins(host_sim, host_pins[PLATFORM_PIN_GAIN_SLCT_1], host_pins[PLATFORM_PIN_GAIN_SLCT_2]);
+    if (host_nina != NULL && pin == PLATFORM_PIN_NINA_RST)
+        NINAEMU_set_reset(host_nina, level, AFESIM_elapsed_s(host_sim));
+    if (host_nina != NULL && pin == PLATFORM_PIN_NINA_DTR)
+        NINAEMU_set_dtr(host_nina, level, AFESIM_elapsed_s(host_sim));
+}
+
+void PLATFORM_pin_toggle(PLATFORM_pin pin)
+{
+    PLATFORM_pin_write(pin, !host_pins[pin]);
+}
+
+bool PLATFORM_pin_read(PLATFORM_pin pin)
+{
+    // status LEDs of the module are active low
+    if (host_nina != NULL && pin == PLATFORM_PIN_NINA_LED_RED)
+        return !NINAEMU_is_led_red_on(host_nina);
+    if (host_nina != NULL && pin == PLATFORM_PIN_NINA_LED_BLUE)
+        return !NINAEMU_is_led_blue_on(host_nina);
+    return host_pins[pin];
+}
+
+void PLATFORM_timer_start(uint16_t duration_ms, PLATFORM_timer_callback callback)
+{
+    host_timer_remaining = (uint64_t)ceil(duration_ms * 1e-3 * host_sim->params.sample_rate_hz);
+    if (host_timer_remaining == 0)
+        host_timer_remaining = 1;
+    host_timer_callback = callback;
+}
+
+void PLATFORM_timer_stop()
+{
+    host_timer_callback = NULL;
+}
+
+void PLATFORM_dac_write(uint8_t channel, uint16_t code)
+{
+    AFESIM_set_dac(host_sim, channel, code);
+}
+
+void PLATFORM_adc_init()
+{
+}
+
+void PLATFORM_adc_arm(uint16_t *buffer, uint32_t length)
+{
+    host_adc_buffer = buffer;
+    host_adc_length = length;
+    host_adc_position = 0;
+}
+
+void PLATFORM_adc_trigger_start()
+{
+    host_adc_running = true;
+}
+
+void PLATFORM_adc_stop()
+{
+    host_adc_running = false;
+}
+
+uint32_t PLATFORM_adc_get_position()
+{
+    return host_adc_position;
+}
+
+void PLATFORM_uart_init()
+{
+}
+
+/**
+ * Like HAL_UART_Transmit_DMA(): the bytes go to the pty (emulator) at once,
+ * the completion follows after their transmission time at the set baud rate.
+ */
+void PLATFORM_uart_transmit_start(const uint8_t *data, uint16_t length)
+{
+    double duration_s = (double)length * HOST_UART_BITS_PER_BYTE / host_uart_baud_rate;
+
+    host_uart_bytes += length;
+    host_uart_busy_s += duration_s;
+    if (host_nina != NULL)
+        NINAEMU_receive(host_nina, data, length, host_uart_baud_rate, AFESIM_elapsed_s(host_sim) + duration_s);
+    else if (host_uart_fd >= 0)
+    {
+        while (length > 0)
+        {
+            ssize_t written = write(host_uart_fd, data, length);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break; // nobody reads the pty (full) or it was closed: bytes are lost like on an open line
+            }
+            data += written;
+            length -= (uint16_t)written;
+        }
+    }
+    host_uart_tx_remaining = (uint64_t)ceil(duration_s * host_sim->params.sample_rate_hz);
+    if (host_uart_tx_remaining == 0)
+        host_uart_tx_remaining = 1;
+    host_uart_tx_active = true;
+}
+
+/**
+ * The pty has no baud rate, only the transmission time changes.
+ */
+void PLATFORM_uart_set_baud_rate(uint32_t baud_rate)
+{
+    host_uart_baud_rate = baud_rate;
+    host_uart_rx_buffer = NULL; // reception stopped
+}
+
+void PLATFORM_uart_receive_start(uint8_t *buffer, uint16_t length)
+{
+    host_uart_rx_buffer = buffer;
+    host_uart_rx_length = length;
+    host_uart_rx_position = 0;
+}
+
+void PLATFORM_button_init()
+{
+    host_is_button_pressed = false;
+}
+
+bool PLATFORM_button_fetch_press()
+{
+    bool is_pressed = host_is_button_pressed;
+
+    host_is_button_pressed = false;
+    return is_pressed;
+}
+
+/**
+ * Reports the double ECC errors the NMI reports on the board.
+ */
+bool PLATFORM_flash_read(uint32_t offset, void *data, uint16_t length)
+{
+    uint32_t word;
+
+    if (length == 0 || offset + length > HOST_FLASH_SIZE)
+        return false;
+    memcpy(data, &host_flash[offset], length);
+    for (word = offset / 8; word <= (offset + length - 1) / 8; word++)
+    {
+        if (host_flash_ecc_errors[word])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Takes the time of the erase, like the blocking HAL call.
+ */
+bool PLATFORM_flash_erase_page(uint16_t page)
+{
+    if (page >= OUTBOX_FLASH_PAGES || host_is_flash_cut)
+        return false;
+    memset(&host_flash[(uint32_t)page * PLATFORM_FLASH_PAGE_SIZE], 0xFF, PLATFORM_FLASH_PAGE_SIZE);
+    memset(&host_flash_ecc_errors[(uint32_t)page * PLATFORM_FLASH_PAGE_SIZE / 8], 0, PLATFORM_FLASH_PAGE_SIZE / 8);
+    HOST_advance_seconds(HOST_FLASH_ERASE_S);
+    return true;
+}
+
+/**
+ * Checks what the flash controller checks: alignment, and that a double
+ * word is either erased or programmed to zero. Zero also clears a double
+ * ECC error.
+ */
+bool PLATFORM_flash_program(uint32_t offset, const uint64_t *data, uint16_t count)
+{
+    uint16_t i;
+
+    if (offset % 8 != 0 || offset + 8u * count > HOST_FLASH_SIZE || host_is_flash_cut)
+        return false;
+    for (i = 0; i < count; i++)
+    {
+        uint8_t *target = &host_flash[offset + 8u * i];
+        uint64_t erased = UINT64_MAX;
+
+        if (data[i] != 0 && memcmp(target, &erased, 8) != 0)
+        {
+            host_flash_errors++;
+            return false;
+        }
+        if (host_flash_cut_words > 0 && --host_flash_cut_words == 0)
+        {
+            memcpy(target, &data[i], 4);
+            host_flash_ecc_errors[(offset + 8u * i) / 8] = true;
+            host_is_flash_cut = true;
+            return false;
+        }
+        memcpy(target, &data[i], 8);
+        host_flash_ecc_errors[(offset + 8u * i) / 8] = false;
+    }
+    HOST_advance_seconds(HOST_FLASH_PROGRAM_S * count);
+    return true;
+}
+
+// ###### hal_sweep.h
+
+void SWEEP_init()
+{
+}
+
+void SWEEP_start(uint8_t dac_output, const uint16_t *codes, uint16_t length)
+{
+    ACQ_stop();
+
+    host_sweep_codes = codes;
+    host_sweep_length = length;
+    host_sweep_output = dac_output;
+    host_sweep_step = 0;
+    host_sweep_samples = 0;
+    AFESIM_set_dac(host_sim, dac_output, codes[0]);
+    host_sweep_active = true;
+
+    ACQ_arm();
+    ACQ_start();
+}
+
+void SWEEP_stop()
+{
+    host_sweep_active = false;
+}
@@ -0,0 +1,25 @@
+#ifndef SIM_PLATFORM_HOST_H_
+#define SIM_PLATFORM_HOST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "afe_sim.h"
+#include "nina_emu.h"
+#include "platform.h"
+
+void HOST_platform_init(AFESIM *sim, int uart_fd);
+void HOST_platform_attach_nina(NINAEMU *nina);
+uint64_t HOST_platform_get_uart_bytes();
+double HOST_platform_get_uart_busy_s();
+uint32_t HOST_platform_get_uart_baud_rate();
+bool HOST_platform_get_pin(PLATFORM_pin pin);
+void HOST_platform_set_pin(PLATFORM_pin pin, bool level);
+bool HOST_platform_load_flash(const char *path);
+bool HOST_platform_save_flash(const char *path);
+uint32_t HOST_platform_get_flash_errors();
+void HOST_platform_cut_flash(uint32_t words);
+bool HOST_platform_is_flash_cut();
+void HOST_platform_press_button();
+
+#endif /* SIM_PLATFORM_HOST_H_ */
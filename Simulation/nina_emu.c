@@ -0,0 +1,526 @@
+#include "nina_emu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Command mode: bytes from the host are collected up to CR and executed,
+ * the echo and the answer are queued with their line time. Data mode: bytes
+ * go to the peer until a DTR pulse ends it. URCs are only sent in command
+ * mode, in data mode the LEDs show what happens (like the module).
+ */
+
+// ###### defines
+
+#define NINAEMU_DEFAULT_BAUD_RATE 115200
+#define NINAEMU_BITS_PER_BYTE 10 // 8N1
+#define NINAEMU_PEER_FRAME_SIZE 651
+
+// ###### typedefs
+
+typedef struct
+{
+    const char *name;
+    uint8_t *value;
+    uint8_t min;
+    uint8_t max;
+} NINAEMU_setting;
+
+// ###### private functions
+
+static uint64_t NINAEMU_random(NINAEMU *emu)
+{
+    // xorshift64*, reproducible for a given seed
+    emu->rng_state ^= emu->rng_state >> 12;
+    emu->rng_state ^= emu->rng_state << 25;
+    emu->rng_state ^= emu->rng_state >> 27;
+    return emu->rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double NINAEMU_uniform(NINAEMU *emu)
+{
+    return (double)(NINAEMU_random(emu) >> 11) / 9007199254740992.0; // [0, 1)
+}
+
+static bool NINAEMU_chance(NINAEMU *emu, double probability)
+{
+    return probability > 0.0 && NINAEMU_uniform(emu) < probability;
+}
+
+/**
+ * Queues bytes to the host: first byte after the latency (or when the line
+ * is free), then one byte time per byte at the current baud rate.
+ */
+static void NINAEMU_queue(NINAEMU *emu, const char *data, uint32_t length, double now_s)
+{
+    double byte_s = (double)NINAEMU_BITS_PER_BYTE / emu->baud_rate;
+    double at_s = now_s + emu->params.latency_s + emu->params.latency_jitter_s * NINAEMU_uniform(emu);
+    uint32_t i;
+
+    if (at_s < emu->output_free_at_s)
+        at_s = emu->output_free_at_s;
+    for (i = 0; i < length; i++)
+    {
+        uint32_t next = (emu->output_tail + 1) % NINAEMU_OUTPUT_SIZE;
+
+        at_s += byte_s;
+        if (next == emu->output_head)
+        {
+            emu->statistics.dropped_bytes++; // nobody reads the host side
+            continue;
+        }
+        emu->output[emu->output_tail] = (uint8_t)data[i];
+        emu->output_at_s[emu->output_tail] = at_s;
+        emu->output_tail = next;
+    }
+    emu->output_free_at_s = at_s;
+}
+
+static void NINAEMU_queue_string(NINAEMU *emu, const char *text, double now_s)
+{
+    NINAEMU_queue(emu, text, (uint32_t)strlen(text), now_s);
+}
+
+static void NINAEMU_update_baud_rate(NINAEMU *emu, double now_s)
+{
+    if (emu->pending_baud_rate != 0 && now_s > emu->pending_baud_at_s)
+    {
+        emu->baud_rate = emu->pending_baud_rate;
+        emu->pending_baud_rate = 0;
+    }
+}
+
+static void NINAEMU_connect(NINAEMU *emu, double now_s)
+{
+    char urc[64];
+
+    emu->peer_handle = (uint8_t)(emu->peer_handle % 255 + 1);
+    emu->peer_connected = true;
+    emu->connected_at_s = now_s;
+    emu->waiting_for_recovery = true;
+    emu->statistics.connections++;
+    if (!emu->data_mode)
+    {
+        snprintf(urc, sizeof(urc), "\r\n+UUDPC:%u,1,1,%s,%u\r\n", emu->peer_handle, emu->params.peer_address,
+                 NINAEMU_PEER_FRAME_SIZE);
+        NINAEMU_queue_string(emu, urc, now_s);
+    }
+}
+
+/**
+ * Boot, baud rate change and the connect of a peer in range happen at their
+ * time, checked whenever the emulator is called.
+ */
+static void NINAEMU_update(NINAEMU *emu, double now_s)
+{
+    if (!emu->in_reset && !emu->booted && now_s >= emu->boot_at_s)
+    {
+        emu->booted = true;
+        emu->statistics.boots++;
+        NINAEMU_queue_string(emu, "\r\n+STARTUP\r\n", emu->boot_at_s);
+    }
+    NINAEMU_update_baud_rate(emu, now_s);
+
+    if (!emu->peer_in_range || !emu->booted || emu->connectable != 2 || emu->peer_connected)
+        emu->connectable_at_s = -1.0;
+    else if (emu->connectable_at_s < 0.0)
+        emu->connectable_at_s = now_s;
+    else if (now_s >= emu->connectable_at_s + emu->params.peer_connect_s)
+        NINAEMU_connect(emu, now_s);
+}
+
+static bool NINAEMU_parse_number(const char *text, long *value)
+{
+    char *end;
+
+    if (*text == '\0')
+        return false;
+    *value = strtol(text, &end, 10);
+    return *end == '\0' || *end == ',';
+}
+
+/**
+ * Executes one command line.
+ * @param info: receives an information response line, empty if none
+ * @return false for ERROR
+ */
+static bool NINAEMU_execute(NINAEMU *emu, const char *line, char *info, size_t info_size)
+{
+    NINAEMU_setting settings[] = {
+        {"UBTCM", &emu->connectable, 1, 3},
+        {"UBTDM", &emu->discoverable, 1, 3},
+        {"UBTPM", &emu->pairable, 1, 2},
+        {"UBTLE", &emu->low_energy, 0, 3},
+        {"UBTMSP", &emu->master_slave_policy, 0, 1},
+    };
+    const char *name;
+    size_t name_length;
+    long value;
+    size_t i;
+
+    info[0] = '\0';
+    if (strcmp(line, "AT") == 0)
+        return true;
+    if (strcmp(line, "ATE0") == 0 || strcmp(line, "ATE1") == 0)
+    {
+        emu->echo = line[3] == '1';
+        return true;
+    }
+    if (strcmp(line, "ATO1") == 0 || strcmp(line, "ATO") == 0)
+        return true; // data mode after the OK, see NINAEMU_run_line()
+    if (strncmp(line, "AT+", 3) != 0)
+        return false;
+
+    name = line + 3;
+    name_length = strcspn(name, "=?");
+    for (i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        if (strlen(settings[i].name) != name_length || strncmp(name, settings[i].name, name_length) != 0)
+            continue;
+        if (strcmp(name + name_length, "?") == 0)
+        {
+            snprintf(info, info_size, "+%s:%u", settings[i].name, *settings[i].value);
+            return true;
+        }
+        if (name[name_length] != '=' || !NINAEMU_parse_number(name + name_length + 1, &value) ||
+            value < settings[i].min || value > settings[i].max)
+            return false;
+        *settings[i].value = (uint8_t)value;
+        return true;
+    }
+
+    if (strncmp(name, "UBTLN=", 6) == 0)
+    {
+        if (strlen(name + 6) > NINAEMU_NAME_MAX_LENGTH)
+            return false;
+        strcpy(emu->name, name + 6);
+        return true;
+    }
+    if (strcmp(name, "UBTLN?") == 0)
+    {
+        snprintf(info, info_size, "+UBTLN:\"%s\"", emu->name);
+        return true;
+    }
+    if (strncmp(name, "UDCPC=", 6) == 0)
+    {
+        if (!NINAEMU_parse_number(name + 6, &value) || !emu->peer_connected || value != emu->peer_handle)
+            return false;
+        return true; // disconnect after the OK, see NINAEMU_run_line()
+    }
+    if (strncmp(name, "UMRS=", 5) == 0)
+    {
+        // <baud>,<flow control>,<data bits>,<stop bits>,<parity>,<change after confirmation>
+        return NINAEMU_parse_number(name + 5, &value) && value >= 19200 && value <= (long)emu->params.max_baud_rate;
+    }
+    return false;
+}
+
+/**
+ * Command line complete: echo, fault injection, answer, effects that
+ * follow the answer.
+ */
+static void NINAEMU_run_line(NINAEMU *emu, double now_s)
+{
+    char info[NINAEMU_LINE_MAX_LENGTH + 32];
+    bool silent;
+    bool ok;
+
+    emu->line[emu->line_length] = '\0';
+    emu->statistics.commands++;
+    if (emu->echo)
+    {
+        NINAEMU_queue(emu, emu->line, emu->line_length, now_s);
+        NINAEMU_queue_string(emu, "\r", now_s);
+    }
+
+    if (NINAEMU_chance(emu, emu->params.error_probability))
+    {
+        emu->statistics.injected_errors++;
+        NINAEMU_queue_string(emu, "\r\nERROR\r\n", now_s);
+        return;
+    }
+    silent = NINAEMU_chance(emu, emu->params.silence_probability);
+    if (silent)
+        emu->statistics.injected_silences++;
+
+    ok = NINAEMU_execute(emu, emu->line, info, sizeof(info));
+    if (!silent)
+    {
+        NINAEMU_queue_string(emu, "\r\n", now_s);
+        if (info[0] != '\0')
+        {
+            NINAEMU_queue_string(emu, info, now_s);
+            NINAEMU_queue_string(emu, "\r\n", now_s);
+        }
+        NINAEMU_queue_string(emu, ok ? "OK\r\n" : "ERROR\r\n", now_s);
+    }
+    if (!ok)
+        return;
+
+    if (strncmp(emu->line, "AT+UMRS=", 8) == 0)
+    {
+        // new rate once the OK is out (last parameter 1), also if the OK was lost
+        emu->pending_baud_rate = (uint32_t)strtoul(emu->line + 8, NULL, 10);
+        emu->pending_baud_at_s = emu->output_free_at_s > now_s ? emu->output_free_at_s : now_s;
+    }
+    else if (strncmp(emu->line, "ATO", 3) == 0)
+        emu->data_mode = true;
+    else if (strncmp(emu->line, "AT+UDCPC=", 9) == 0)
+        NINAEMU_disconnect_peer(emu, now_s);
+}
+
+static void NINAEMU_to_peer(NINAEMU *emu, uint8_t byte, double now_s)
+{
+    uint32_t next = (emu->peer_tail + 1) % NINAEMU_PEER_SIZE;
+
+    if (!emu->peer_connected)
+        return; // data mode without a peer: lost
+    emu->statistics.peer_bytes++;
+    if (emu->waiting_for_recovery)
+    {
+        double recovery_s = now_s - emu->connected_at_s;
+
+        emu->waiting_for_recovery = false;
+        emu->statistics.recoveries++;
+        emu->statistics.recovery_sum_s += recovery_s;
+        if (recovery_s > emu->statistics.recovery_max_s)
+            emu->statistics.recovery_max_s = recovery_s;
+    }
+    if (next == emu->peer_head)
+        emu->peer_head = (emu->peer_head + 1) % NINAEMU_PEER_SIZE; // oldest byte is overwritten
+    emu->peer[emu->peer_tail] = byte;
+    emu->peer_tail = next;
+}
+
+// ###### functions
+
+void NINAEMU_default_params(NINAEMU_params *params)
+{
+    params->boot_s = 0.8;
+    params->latency_s = 0.002;
+    params->latency_jitter_s = 0.001;
+    params->error_probability = 0.0;
+    params->silence_probability = 0.0;
+    params->drop_probability = 0.0;
+    params->max_baud_rate = 921600;
+    params->peer_address = "D8A01D5C2E14p";
+    params->peer_connect_s = 1.5;
+    params->seed = 1;
+}
+
+/**
+ * The module starts in reset (RST low), like after power on of the board.
+ */
+void NINAEMU_init(NINAEMU *emu, const NINAEMU_params *params)
+{
+    memset(emu, 0, sizeof(*emu));
+    emu->params = *params;
+    emu->rng_state = ((uint64_t)params->seed << 1) | 1u; // xorshift state must not be 0
+    emu->in_reset = true;
+    emu->echo = true;
+    emu->baud_rate = NINAEMU_DEFAULT_BAUD_RATE;
+    emu->connectable = 1;
+    emu->connectable_at_s = -1.0;
+    emu->discoverable = 1;
+    emu->pairable = 1;
+    emu->low_energy = 1;
+    emu->master_slave_policy = 1;
+    strcpy(emu->name, "NINA-W1");
+}
+
+/**
+ * RST is active low: low holds the module in reset, the rising edge starts
+ * the boot. Everything not stored in the module is lost.
+ */
+void NINAEMU_set_reset(NINAEMU *emu, bool level, double now_s)
+{
+    NINAEMU_update(emu, now_s);
+    if (!level)
+    {
+        emu->in_reset = true;
+        emu->booted = false;
+        emu->data_mode = false;
+        emu->echo = true;
+        emu->baud_rate = NINAEMU_DEFAULT_BAUD_RATE;
+        emu->pending_baud_rate = 0;
+        emu->peer_connected = false;
+        emu->waiting_for_recovery = false;
+        emu->line_length = 0;
+        emu->output_head = emu->output_tail;
+        emu->output_free_at_s = now_s;
+    }
+    else if (emu->in_reset)
+    {
+        emu->in_reset = false;
+        emu->boot_at_s = now_s + emu->params.boot_s;
+    }
+}
+
+/**
+ * The end of a DTR pulse switches from data to command mode, answered with OK.
+ */
+void NINAEMU_set_dtr(NINAEMU *emu, bool level, double now_s)
+{
+    NINAEMU_update(emu, now_s);
+    if (emu->dtr && !level && emu->booted && emu->data_mode)
+    {
+        emu->data_mode = false;
+        emu->statistics.escapes++;
+        emu->line_length = 0;
+        NINAEMU_queue_string(emu, "\r\nOK\r\n", now_s);
+    }
+    emu->dtr = level;
+}
+
+/**
+ * Bytes from the host (UART4 TX of the board).
+ * @param baud_rate: of the host, bytes at another rate than the module's are garbage, 0: no rate (pty)
+ * @param now_s: time the last byte is received
+ */
+void NINAEMU_receive(NINAEMU *emu, const uint8_t *data, uint32_t length, uint32_t baud_rate, double now_s)
+{
+    uint32_t i;
+
+    NINAEMU_update(emu, now_s);
+    if (!emu->booted)
+        return;
+    if (baud_rate != 0 && baud_rate != emu->baud_rate)
+    {
+        emu->statistics.garbled_bytes += length;
+        emu->line_length = 0;
+        return;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        uint8_t byte = data[i];
+
+        if (emu->data_mode)
+        {
+            NINAEMU_to_peer(emu, byte, now_s);
+            continue;
+        }
+        if (byte == '\r')
+        {
+            if (emu->line_length > 0)
+                NINAEMU_run_line(emu, now_s);
+            emu->line_length = 0;
+            if (emu->data_mode && i + 1 < length && data[i + 1] == '\n')
+                i++; // LF of "ATO1\r\n" is not peer data
+        }
+        else if (byte == '\n')
+            continue; // the module ends commands at CR
+        else if (emu->line_length < NINAEMU_LINE_MAX_LENGTH)
+            emu->line[emu->line_length++] = (char)byte;
+    }
+}
+
+/**
+ * Bytes to the host that are completely on the line at now_s.
+ * @param baud_rate: of the host, if it differs from the module's the bytes are garbage, 0: no rate (pty)
+ * @return number of bytes in buffer
+ */
+uint32_t NINAEMU_transmit(NINAEMU *emu, uint8_t *buffer, uint32_t size, uint32_t baud_rate, double now_s)
+{
+    uint32_t count = 0;
+
+    if (!emu->booted)
+        NINAEMU_update(emu, now_s);
+    while (count < size && emu->output_head != emu->output_tail && emu->output_at_s[emu->output_head] <= now_s)
+    {
+        uint8_t byte = emu->output[emu->output_head];
+
+        // the OK to AT+UMRS still leaves at the old rate
+        NINAEMU_update_baud_rate(emu, emu->output_at_s[emu->output_head]);
+        emu->output_head = (emu->output_head + 1) % NINAEMU_OUTPUT_SIZE;
+        if (NINAEMU_chance(emu, emu->params.drop_probability))
+        {
+            emu->statistics.dropped_bytes++;
+            continue;
+        }
+        if (baud_rate != 0 && baud_rate != emu->baud_rate)
+        {
+            emu->statistics.garbled_bytes++;
+            byte = 0xFF; // framing error, the host sees noise
+        }
+        buffer[count++] = byte;
+    }
+    NINAEMU_update(emu, now_s);
+    return count;
+}
+
+void NINAEMU_connect_peer(NINAEMU *emu, double now_s)
+{
+    NINAEMU_update(emu, now_s);
+    if (emu->booted && !emu->peer_connected)
+        NINAEMU_connect(emu, now_s);
+}
+
+/**
+ * A peer in range connects by itself params.peer_connect_s after the module
+ * has become connectable (AT+UBTCM=2), and again after every disconnect.
+ */
+void NINAEMU_set_peer_in_range(NINAEMU *emu, bool in_range, double now_s)
+{
+    NINAEMU_update(emu, now_s);
+    emu->peer_in_range = in_range;
+}
+
+void NINAEMU_disconnect_peer(NINAEMU *emu, double now_s)
+{
+    char urc[32];
+
+    NINAEMU_update(emu, now_s);
+    if (!emu->peer_connected)
+        return;
+    emu->peer_connected = false;
+    emu->waiting_for_recovery = false;
+    if (!emu->data_mode)
+    {
+        snprintf(urc, sizeof(urc), "\r\n+UUDPD:%u,1\r\n", emu->peer_handle);
+        NINAEMU_queue_string(emu, urc, now_s);
+    }
+}
+
+/**
+ * Bytes from the peer, they reach the host in data mode only.
+ */
+void NINAEMU_peer_send(NINAEMU *emu, const uint8_t *data, uint32_t length, double now_s)
+{
+    NINAEMU_update(emu, now_s);
+    if (emu->booted && emu->peer_connected && emu->data_mode)
+        NINAEMU_queue(emu, (const char *)data, length, now_s);
+}
+
+/**
+ * Bytes the peer has received since the last call.
+ */
+uint32_t NINAEMU_peer_read(NINAEMU *emu, uint8_t *buffer, uint32_t size)
+{
+    uint32_t count = 0;
+
+    while (count < size && emu->peer_head != emu->peer_tail)
+    {
+        buffer[count++] = emu->peer[emu->peer_head];
+        emu->peer_head = (emu->peer_head + 1) % NINAEMU_PEER_SIZE;
+    }
+    return count;
+}
+
+/**
+ * Red: data mode. Blue: peer connected.
+ */
+bool NINAEMU_is_led_red_on(const NINAEMU *emu)
+{
+    return emu->booted && emu->data_mode;
+}
+
+bool NINAEMU_is_led_blue_on(const NINAEMU *emu)
+{
+    return emu->booted && emu->peer_connected;
+}
+
+uint32_t NINAEMU_get_baud_rate(const NINAEMU *emu)
+{
+    return emu->baud_rate;
+}
@@ -0,0 +1,132 @@
+#ifndef SIM_NINA_EMU_H_
+#define SIM_NINA_EMU_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Emulator of the NINA-W1 module on UART4, the subset of u-connectXpress
+ * that mw_rf_handler.c uses:
+ *
+ *   +STARTUP after reset, AT, ATE0/1, AT+UBTCM/UBTDM/UBTPM/UBTLE/UBTMSP
+ *   (set and query), AT+UBTLN, ATO1, AT+UDCPC, AT+UMRS, the peer URCs
+ *   +UUDPC/+UUDPD, the DTR pulse from data to command mode and the
+ *   red/blue status LEDs.
+ *
+ * Time is passed in by the caller (seconds), so the same emulator runs
+ * inside host_firmware on the simulated clock and behind a pty on the wall
+ * clock (nina_emu_pty.c). Responses leave after a latency at the line rate
+ * of the current baud rate. Faults are drawn per command (ERROR, no answer)
+ * and per byte (dropped) from a seeded generator.
+ */
+
+// ###### defines
+
+#define NINAEMU_OUTPUT_SIZE 4096
+#define NINAEMU_PEER_SIZE 65536 // a drained outbox arrives within one cycle
+#define NINAEMU_LINE_MAX_LENGTH 256
+#define NINAEMU_NAME_MAX_LENGTH 64
+
+// ###### typedefs
+
+typedef struct
+{
+    double boot_s;              // reset -> +STARTUP
+    double latency_s;           // command received -> first byte of the answer
+    double latency_jitter_s;    // uniform 0..jitter added to the latency
+    double error_probability;   // command answered with ERROR and not executed
+    double silence_probability; // command executed, but its answer is lost
+    double drop_probability;    // every byte to the host is lost with this probability
+    uint32_t max_baud_rate;     // AT+UMRS above is answered with ERROR
+    const char *peer_address;   // Bluetooth address in the +UUDPC URC
+    double peer_connect_s;      // connectable -> a peer in range connects
+    uint32_t seed;
+} NINAEMU_params;
+
+typedef struct
+{
+    uint64_t commands;
+    uint64_t injected_errors;
+    uint64_t injected_silences;
+    uint64_t dropped_bytes;
+    uint64_t garbled_bytes; // host and module at different baud rates
+    uint64_t peer_bytes;    // received by the peer in data mode
+    uint32_t boots;
+    uint32_t escapes;      // DTR pulses that ended data mode
+    uint32_t connections;  // peer connects
+    uint32_t recoveries;   // connects followed by peer data
+    double recovery_sum_s; // connect -> first byte at the peer
+    double recovery_max_s;
+} NINAEMU_statistics;
+
+typedef struct
+{
+    NINAEMU_params params;
+    NINAEMU_statistics statistics;
+    uint64_t rng_state;
+
+    // power and mode
+    bool in_reset;
+    bool booted;
+    double boot_at_s;
+    bool data_mode;
+    bool echo;
+    bool dtr;
+    uint32_t baud_rate;
+    uint32_t pending_baud_rate; // AT+UMRS, changes once its OK is out
+    double pending_baud_at_s;
+
+    // settings
+    uint8_t connectable;
+    uint8_t discoverable;
+    uint8_t pairable;
+    uint8_t low_energy;
+    uint8_t master_slave_policy;
+    char name[NINAEMU_NAME_MAX_LENGTH + 1];
+
+    // peer
+    bool peer_connected;
+    bool peer_in_range;
+    double connectable_at_s; // < 0: not connectable for a peer in range
+    uint8_t peer_handle;
+    double connected_at_s;
+    bool waiting_for_recovery;
+
+    // command line from the host
+    char line[NINAEMU_LINE_MAX_LENGTH + 1];
+    uint16_t line_length;
+
+    // bytes to the host, each with the time it is completely on the line
+    uint8_t output[NINAEMU_OUTPUT_SIZE];
+    double output_at_s[NINAEMU_OUTPUT_SIZE];
+    uint32_t output_head;
+    uint32_t output_tail;
+    double output_free_at_s; // line busy until
+
+    // bytes the peer received
+    uint8_t peer[NINAEMU_PEER_SIZE];
+    uint32_t peer_head;
+    uint32_t peer_tail;
+} NINAEMU;
+
+// ###### functions
+
+void NINAEMU_default_params(NINAEMU_params *params);
+void NINAEMU_init(NINAEMU *emu, const NINAEMU_params *params);
+
+void NINAEMU_set_reset(NINAEMU *emu, bool level, double now_s);
+void NINAEMU_set_dtr(NINAEMU *emu, bool level, double now_s);
+void NINAEMU_receive(NINAEMU *emu, const uint8_t *data, uint32_t length, uint32_t baud_rate, double now_s);
+uint32_t NINAEMU_transmit(NINAEMU *emu, uint8_t *buffer, uint32_t size, uint32_t baud_rate, double now_s);
+
+void NINAEMU_connect_peer(NINAEMU *emu, double now_s);
+void NINAEMU_set_peer_in_range(NINAEMU *emu, bool in_range, double now_s);
+void NINAEMU_disconnect_peer(NINAEMU *emu, double now_s);
+void NINAEMU_peer_send(NINAEMU *emu, const uint8_t *data, uint32_t length, double now_s);
+uint32_t NINAEMU_peer_read(NINAEMU *emu, uint8_t *buffer, uint32_t size);
+
+bool NINAEMU_is_led_red_on(const NINAEMU *emu);
+bool NINAEMU_is_led_blue_on(const NINAEMU *emu);
+uint32_t NINAEMU_get_baud_rate(const NINAEMU *emu);
+
+#endif /* SIM_NINA_EMU_H_ */
@@ -0,0 +1,205 @@
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nina_emu.h"
+
+/*
+ * The NINA emulator (nina_emu.c) behind a pty on the wall clock, for
+ * anything that talks to a serial port (terminal, scripts, the AT parser
+ * benchmark captures).
+ *
+ *   nina_emu_pty [-l latency] [-j jitter] [-e error] [-x silence] [-d drop] [-b baud] [-t boot] [-s seed]
+ *
+ *   -l, -j  answer latency and its jitter in ms (default 2, 1)
+ *   -e, -x  probability of ERROR / of a lost answer per command
+ *   -d      probability of a lost byte to the client
+ *   -b      highest baud rate accepted with AT+UMRS
+ *   -t      boot time in s until +STARTUP (default 0.8)
+ *
+ * The pty name is printed on stderr. A pty has no DTR, no RST and no LEDs,
+ * those are commands on stdin instead:
+ *
+ *   connect | disconnect     peer connects / disconnects (URC in command mode)
+ *   send <text>              peer sends a line (reaches the client in data mode)
+ *   dtr                      DTR pulse (data -> command mode)
+ *   reset                    RST pulse, +STARTUP follows
+ *   status                   mode, LEDs and statistics
+ *
+ * What the peer receives in data mode is printed on stdout.
+ */
+
+// ###### private functions
+
+static double PTY_now_s()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int PTY_open()
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        perror("pty");
+        exit(EXIT_FAILURE);
+    }
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "NINA on %s\n", ptsname(fd));
+    return fd;
+}
+
+static void PTY_print_status(const NINAEMU *emu)
+{
+    const NINAEMU_statistics *statistics = &emu->statistics;
+
+    fprintf(stderr, "%s, %s mode, red LED %s, blue LED %s, %u baud\n", emu->booted ? "booted" : "booting",
+            emu->data_mode ? "data" : "command", NINAEMU_is_led_red_on(emu) ? "on" : "off",
+            NINAEMU_is_led_blue_on(emu) ? "on" : "off", NINAEMU_get_baud_rate(emu));
+    fprintf(stderr, "%llu commands, %llu ERROR / %llu lost answers / %llu lost bytes injected, %llu peer bytes\n",
+            (unsigned long long)statistics->commands, (unsigned long long)statistics->injected_errors,
+            (unsigned long long)statistics->injected_silences, (unsigned long long)statistics->dropped_bytes,
+            (unsigned long long)statistics->peer_bytes);
+}
+
+static void PTY_handle_command(NINAEMU *emu, char *command, double now_s)
+{
+    command[strcspn(command, "\r\n")] = '\0';
+
+    if (strcmp(command, "connect") == 0)
+        NINAEMU_connect_peer(emu, now_s);
+    else if (strcmp(command, "disconnect") == 0)
+        NINAEMU_disconnect_peer(emu, now_s);
+    else if (strncmp(command, "send ", 5) == 0)
+    {
+        strcat(command, "\r\n");
+        NINAEMU_peer_send(emu, (const uint8_t *)command + 5, (uint32_t)strlen(command + 5), now_s);
+    }
+    else if (strcmp(command, "dtr") == 0)
+    {
+        NINAEMU_set_dtr(emu, true, now_s);
+        NINAEMU_set_dtr(emu, false, now_s);
+    }
+    else if (strcmp(command, "reset") == 0)
+    {
+        NINAEMU_set_reset(emu, false, now_s);
+        NINAEMU_set_reset(emu, true, now_s);
+    }
+    else if (strcmp(command, "status") == 0)
+        PTY_print_status(emu);
+    else if (command[0] != '\0')
+        fprintf(stderr, "commands: connect, disconnect, send <text>, dtr, reset, status\n");
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    NINAEMU_params params;
+    static NINAEMU emu;
+    uint8_t buffer[512];
+    char command[NINAEMU_LINE_MAX_LENGTH];
+    double start_s = PTY_now_s();
+    int fd;
+    int option;
+
+    NINAEMU_default_params(&params);
+    params.seed = (uint32_t)time(NULL);
+    while ((option = getopt(argc, argv, "l:j:e:x:d:b:t:s:")) != -1)
+    {
+        switch (option)
+        {
+        case 'l':
+            params.latency_s = atof(optarg) * 1e-3;
+            break;
+        case 'j':
+            params.latency_jitter_s = atof(optarg) * 1e-3;
+            break;
+        case 'e':
+            params.error_probability = atof(optarg);
+            break;
+        case 'x':
+            params.silence_probability = atof(optarg);
+            break;
+        case 'd':
+            params.drop_probability = atof(optarg);
+            break;
+        case 'b':
+            params.max_baud_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            params.boot_s = atof(optarg);
+            break;
+        case 's':
+            params.seed = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [-l latency] [-j jitter] [-e error] [-x silence] [-d drop] [-b baud] [-t boot] "
+                    "[-s seed]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fd = PTY_open();
+    NINAEMU_init(&emu, &params);
+    NINAEMU_set_reset(&emu, true, 0.0); // powered on
+
+    while (true)
+    {
+        struct timeval timeout = {0, 1000};
+        double now_s;
+        uint32_t count;
+        ssize_t received;
+        fd_set fds;
+
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        FD_SET(STDIN_FILENO, &fds);
+        select(fd + 1, &fds, NULL, NULL, &timeout);
+        now_s = PTY_now_s() - start_s;
+
+        // the pty has no baud rate (0): the client is always at the module's rate
+        while ((received = read(fd, buffer, sizeof(buffer))) > 0)
+            NINAEMU_receive(&emu, buffer, (uint32_t)received, 0, now_s);
+
+        if (FD_ISSET(STDIN_FILENO, &fds))
+        {
+            if (fgets(command, sizeof(command) - 2, stdin) == NULL)
+                break; // stdin closed
+            PTY_handle_command(&emu, command, now_s);
+        }
+
+        while ((count = NINAEMU_transmit(&emu, buffer, sizeof(buffer), 0, now_s)) > 0)
+        {
+            if (write(fd, buffer, count) < 0)
+                break; // no client yet: lost like on an open line
+        }
+
+        while ((count = NINAEMU_peer_read(&emu, buffer, sizeof(buffer))) > 0)
+            fwrite(buffer, 1, count, stdout);
+        fflush(stdout);
+    }
+
+    PTY_print_status(&emu);
+    close(fd);
+    return 0;
+}
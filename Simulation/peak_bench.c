@@ -0,0 +1,188 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "meas_config.h"
+#include "dsp_fft.h"
+#include "dsp_peak.h"
+
+/*
+ * Accuracy of the peak estimators of dsp_peak.c over the block length, on
+ * synthetic tones anywhere between two bins: 12 bit ADC codes around the
+ * bias, white noise as in the front end model, random phase. For every
+ * length and method the frequency error (in bins and Hz), the amplitude
+ * error and how well the estimated error matches the real one.
+ *
+ *   peak_bench [seed]
+ *
+ * Without noise only the 12 bit rounding is left, the error is then the bias
+ * of the method; it has to stay below bench_bias_tolerance for every length,
+ * else the exit code is 1. Without a window the bias comes from the leakage
+ * of the negative frequency, largest for tones close to DC or Nyquist.
+ */
+
+// ###### defines
+
+#define BENCH_TRIALS 2000
+#define BENCH_AMPLITUDE_LSB 200.0
+#define BENCH_OFFSET_LSB 2048.0
+#define BENCH_NOISE_LSB 1.5       // rms, AFESIM default
+#define BENCH_EDGE_BINS 4         // tones stay this far from DC and Nyquist
+#define BENCH_TARGET_HZ 20.0      // rms frequency error the summary asks for
+#define BENCH_METHODS 4
+#define BENCH_LENGTHS 5           // 32 .. ACQ_BLOCK_SIZE
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ###### typedefs
+
+typedef struct
+{
+    double frequency_sum;  // squared frequency errors [bins^2]
+    double frequency_max;  // [bins]
+    double amplitude_sum;  // squared relative amplitude errors
+    double amplitude_max;
+    double estimate_sum;   // squared estimated errors [bins^2]
+} BENCH_stats;
+
+// ###### global variables
+
+static const char *const bench_method_names[BENCH_METHODS] = {"bin", "quadratic", "Jacobsen", "Jacobsen Hann"};
+// largest error without noise [bins], in the order of DSP_peak_method
+static const double bench_bias_tolerance[BENCH_METHODS] = {0.55, 0.06, 0.035, 0.005};
+
+// ###### private functions
+
+static double BENCH_uniform()
+{
+    return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static double BENCH_gaussian()
+{
+    return sqrt(-2.0 * log(BENCH_uniform())) * cos(2.0 * M_PI * BENCH_uniform());
+}
+
+/**
+ * One block of ADC codes with a tone at a bin between BENCH_EDGE_BINS and length / 2 - BENCH_EDGE_BINS.
+ * @return frequency of the tone in bins
+ */
+static double BENCH_generate(uint16_t *samples, uint16_t length, double noise_lsb)
+{
+    double bin = BENCH_EDGE_BINS + (length / 2 - 2 * BENCH_EDGE_BINS) * BENCH_uniform();
+    double phase = 2.0 * M_PI * BENCH_uniform();
+    uint16_t n;
+
+    for (n = 0; n < length; n++)
+    {
+        double v = BENCH_OFFSET_LSB + BENCH_AMPLITUDE_LSB * cos(2.0 * M_PI * bin * n / length + phase);
+
+        samples[n] = (uint16_t)floor(v + noise_lsb * BENCH_gaussian() + 0.5);
+    }
+    return bin;
+}
+
+/**
+ * All methods on the same BENCH_TRIALS blocks of one length.
+ * @param stats: one entry per DSP_peak_method
+ */
+static void BENCH_run(uint16_t length, double noise_lsb, BENCH_stats stats[BENCH_METHODS])
+{
+    static uint16_t samples[ACQ_BLOCK_SIZE];
+    uint32_t trial;
+    uint8_t m;
+
+    for (m = 0; m < BENCH_METHODS; m++)
+        stats[m] = (BENCH_stats){0};
+
+    for (trial = 0; trial < BENCH_TRIALS; trial++)
+    {
+        double bin = BENCH_generate(samples, length, noise_lsb);
+
+        for (m = 0; m < BENCH_METHODS; m++)
+        {
+            DSP_peak peak = {0};
+            double frequency_error, amplitude_error;
+
+            DSP_fft_peak(samples, length, (DSP_peak_method)m, &peak);
+            frequency_error = fabs(peak.bin - bin);
+            amplitude_error = fabs(peak.amplitude - BENCH_AMPLITUDE_LSB) / BENCH_AMPLITUDE_LSB;
+            stats[m].frequency_sum += frequency_error * frequency_error;
+            stats[m].frequency_max = fmax(stats[m].frequency_max, frequency_error);
+            stats[m].amplitude_sum += amplitude_error * amplitude_error;
+            stats[m].amplitude_max = fmax(stats[m].amplitude_max, amplitude_error);
+            stats[m].estimate_sum += (double)peak.error * peak.error;
+        }
+    }
+}
+
+static double BENCH_rms(double sum)
+{
+    return sqrt(sum / BENCH_TRIALS);
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1;
+    uint16_t shortest[BENCH_METHODS] = {0};
+    static BENCH_stats stats[BENCH_LENGTHS][BENCH_METHODS];
+    bool is_failed = false;
+    uint16_t length;
+    uint8_t l, m;
+
+    srand(seed);
+
+    printf("bias: no noise, 12 bit rounding only, %u tones per length\n", BENCH_TRIALS);
+    printf("length  max error [bins] / max amplitude error\n");
+    for (l = 0, length = 32; l < BENCH_LENGTHS; l++, length *= 2)
+    {
+        BENCH_run(length, 0.0, stats[l]);
+        printf("%6u", length);
+        for (m = 0; m < BENCH_METHODS; m++)
+        {
+            printf("  %s %.4f / %.2f%%", bench_method_names[m], stats[l][m].frequency_max,
+                   100.0 * stats[l][m].amplitude_max);
+            if (stats[l][m].frequency_max > bench_bias_tolerance[m])
+                is_failed = true;
+        }
+        printf("\n");
+    }
+
+    for (l = 0, length = 32; l < BENCH_LENGTHS; l++, length *= 2)
+        BENCH_run(length, BENCH_NOISE_LSB, stats[l]);
+
+    printf("\nnoise %.1f LSB rms, amplitude %.0f LSB, fs %.0f Hz\n", BENCH_NOISE_LSB, BENCH_AMPLITUDE_LSB,
+           ACQ_SAMPLE_RATE_HZ);
+    printf("method         length  rms [bins]  max [bins]   rms [Hz]  amplitude rms  estimated / rms\n");
+    for (m = 0; m < BENCH_METHODS; m++)
+    {
+        for (l = 0, length = 32; l < BENCH_LENGTHS; l++, length *= 2)
+        {
+            const BENCH_stats *entry = &stats[l][m];
+            double bin_hz = ACQ_SAMPLE_RATE_HZ / length;
+            double rms = BENCH_rms(entry->frequency_sum);
+
+            printf("%-13s  %6u  %10.4f  %10.4f  %9.1f  %12.3f%%  %15.2f\n", bench_method_names[m], length, rms,
+                   entry->frequency_max, rms * bin_hz, 100.0 * BENCH_rms(entry->amplitude_sum),
+                   BENCH_rms(entry->estimate_sum) / rms);
+            if (shortest[m] == 0 && rms * bin_hz <= BENCH_TARGET_HZ)
+                shortest[m] = length;
+        }
+    }
+
+    printf("\nshortest block for %.0f Hz rms:", BENCH_TARGET_HZ);
+    for (m = 0; m < BENCH_METHODS; m++)
+    {
+        if (shortest[m] > 0)
+            printf("  %s %u (%.2f ms)", bench_method_names[m], shortest[m], 1e3 * shortest[m] / ACQ_SAMPLE_RATE_HZ);
+        else
+            printf("  %s > %u", bench_method_names[m], ACQ_BLOCK_SIZE);
+    }
+    printf("\n%s\n", is_failed ? "FAILED" : "ok");
+    return is_failed ? EXIT_FAILURE : 0;
+}
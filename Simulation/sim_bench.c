@@ -0,0 +1,121 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "afe_sim.h"
+#include "meas_config.h"
+#include "dsp_goertzel.h"
+#include "al_optim2d.h"
+
+/*
+ * Closed loop benchmark of the 2-D varactor searches against the front end
+ * model. Every evaluation costs what it costs on the board: DAC settle time,
+ * the dropped block in flight and one measured block (see al_tuning.c).
+ * Reported are evaluations, simulated search time, distance of the result to
+ * the ideal codes and the remaining notch amplitude.
+ *
+ * The exit code is 1 if coordinate descent or Nelder-Mead leave more than
+ * BENCH_MAX_RESIDUAL_LSB of a reachable notch. The sequential search is the
+ * reference that misses the minimum of a coupled notch and is not checked.
+ */
+
+// ###### defines
+
+#define BENCH_SETTLE_SAMPLES ((uint32_t)(TUNING_DAC_SETTLE_MS * 1e-3 * (80e6 / 653.0) + 0.5))
+#define BENCH_MAX_RESIDUAL_LSB 1.0
+
+// ###### typedefs
+
+typedef struct
+{
+    AFESIM sim;
+    DSP_goertzel goertzel;
+    uint16_t block[ACQ_BLOCK_SIZE];
+} BENCH_context;
+
+static const struct
+{
+    double permittivity_real;
+    double permittivity_imag;
+} bench_snow[] = {
+    {1.0, 0.0},  // air
+    {1.4, 0.01}, // fresh dry snow
+    {1.8, 0.05}, // settled snow
+    {2.2, 0.2},  // wet snow
+    {2.8, 0.4},  // very wet snow
+};
+
+static const char *bench_method_names[] = {"sequential", "coordinate descent", "nelder-mead"};
+
+// ###### private functions
+
+static float BENCH_measure(uint16_t code_d1, uint16_t code_d2, void *context)
+{
+    BENCH_context *bench = (BENCH_context *)context;
+    DSP_tone tone;
+
+    AFESIM_set_dac(&bench->sim, 0, code_d1);
+    AFESIM_set_dac(&bench->sim, 1, code_d2);
+    AFESIM_skip(&bench->sim, BENCH_SETTLE_SAMPLES + ACQ_BLOCK_SIZE);
+    AFESIM_generate(&bench->sim, bench->block, ACQ_BLOCK_SIZE);
+
+    DSP_goertzel_process(&bench->goertzel, bench->block, &tone);
+    return tone.amplitude;
+}
+
+// ###### functions
+
+int main(int argc, char **argv)
+{
+    AFESIM_params params;
+    BENCH_context bench;
+    uint32_t seed = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1;
+    bool is_failed = false;
+    size_t s;
+    int method;
+
+    AFESIM_default_params(&params);
+    params.seed = seed;
+    DSP_goertzel_init(&bench.goertzel, ACQ_ALIAS_BIN, ACQ_BLOCK_SIZE);
+
+    printf("%-8s %-8s %-20s %6s %9s %8s %8s %10s\n", "eps'", "eps''", "method", "evals", "time[ms]", "err D1",
+           "err D2", "ampl[LSB]");
+
+    for (s = 0; s < sizeof(bench_snow) / sizeof(bench_snow[0]); s++)
+    {
+        for (method = OPTIM2D_SEQUENTIAL; method <= OPTIM2D_NELDER_MEAD; method++)
+        {
+            OPTIM2D_params search = {
+                .lower_d1 = TUNING_DAC_CODE_MIN,
+                .upper_d1 = TUNING_DAC_CODE_MAX,
+                .lower_d2 = TUNING_DAC_CODE_MIN,
+                .upper_d2 = TUNING_DAC_CODE_MAX,
+                .start_d1 = (TUNING_DAC_CODE_MIN + TUNING_DAC_CODE_MAX) / 2,
+                .start_d2 = (TUNING_DAC_CODE_MIN + TUNING_DAC_CODE_MAX) / 2,
+                .tolerance_lsb = TUNING_TOLERANCE_LSB,
+            };
+            OPTIM2D_result result;
+            double ideal_d1, ideal_d2;
+            bool reachable, is_missed;
+
+            AFESIM_init(&bench.sim, &params);
+            AFESIM_set_gain_pins(&bench.sim, true, false); // 10x
+            AFESIM_set_snow(&bench.sim, bench_snow[s].permittivity_real, bench_snow[s].permittivity_imag);
+            reachable = AFESIM_ideal_codes(&bench.sim, &ideal_d1, &ideal_d2);
+
+            OPTIM2D_search((OPTIM2D_method)method, &search, BENCH_measure, &bench, NULL, &result);
+
+            is_missed = reachable && method != OPTIM2D_SEQUENTIAL && result.amplitude > BENCH_MAX_RESIDUAL_LSB;
+            if (is_missed)
+                is_failed = true;
+
+            printf("%-8.2f %-8.2f %-20s %6u %9.1f %8.1f %8.1f %10.2f%s%s\n", bench_snow[s].permittivity_real,
+                   bench_snow[s].permittivity_imag, bench_method_names[method], result.evaluations,
+                   AFESIM_elapsed_s(&bench.sim) * 1e3, result.code_d1 - ideal_d1, result.code_d2 - ideal_d2,
+                   result.amplitude, reachable ? "" : "  (notch out of DAC range)", is_missed ? "  MISSED" : "");
+        }
+    }
+    printf("%s\n", is_failed ? "FAILED" : "ok");
+    return is_failed ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "frame_decoder.hpp"
+
+/*
+ * Converts result frames to CSV (default) or JSON lines.
+ *
+ *   frame_cli [-j] [file]
+ *
+ * Reads the file, or stdin if none is given (eg a serial port:
+ * "frame_cli < /dev/rfcomm0"). Every record is printed as soon as its frame
+ * is complete, the decoder statistics go to stderr at the end.
+ */
+
+namespace
+{
+
+const char *const GAIN_NAMES[] = {"1x", "10x", "100x"};
+
+const char *gain_name(uint8_t gain)
+{
+    return gain < sizeof(GAIN_NAMES) / sizeof(GAIN_NAMES[0]) ? GAIN_NAMES[gain] : "?";
+}
+
+void print_csv_header()
+{
+    std::printf("sequence,timestamp_s,eps_real,eps_imag,code_d1,code_d2,amplitude_lsb,temperature_c,gain,"
+                "warm_start,widened,cold_fallback,tracking,overwritten,duration_ms,evaluations\n");
+}
+
+void print_csv(const frame::Record &record)
+{
+    std::printf("%u,%u,", record.sequence, record.timestamp_s);
+    if (record.flags & frame::FLAG_EPS_VALID)
+        std::printf("%.3f,%.4f,", record.permittivity_real, record.permittivity_imag);
+    else
+        std::printf(",,");
+    std::printf("%u,%u,%.2f,", record.code_d1, record.code_d2, record.amplitude_lsb);
+    if (record.flags & frame::FLAG_TEMPERATURE_VALID)
+        std::printf("%.2f,", record.temperature_c);
+    else
+        std::printf(",");
+    std::printf("%s,%d,%d,%d,%d,%d,", gain_name(record.gain), (record.flags & frame::FLAG_WARM_START) != 0,
+                (record.flags & frame::FLAG_WIDENED) != 0, (record.flags & frame::FLAG_COLD_FALLBACK) != 0,
+                (record.flags & frame::FLAG_TRACKING) != 0, (record.flags & frame::FLAG_OVERWRITTEN) != 0);
+    if (record.version >= 2)
+        std::printf("%u,%u\n", record.duration_ms, record.evaluations);
+    else
+        std::printf(",\n");
+}
+
+void print_json(const frame::Record &record)
+{
+    std::printf("{\"sequence\":%u,\"timestamp_s\":%u,", record.sequence, record.timestamp_s);
+    if (record.flags & frame::FLAG_EPS_VALID)
+        std::printf("\"eps_real\":%.3f,\"eps_imag\":%.4f,", record.permittivity_real, record.permittivity_imag);
+    else
+        std::printf("\"eps_real\":null,\"eps_imag\":null,");
+    std::printf("\"code_d1\":%u,\"code_d2\":%u,\"amplitude_lsb\":%.2f,", record.code_d1, record.code_d2,
+                record.amplitude_lsb);
+    if (record.flags & frame::FLAG_TEMPERATURE_VALID)
+        std::printf("\"temperature_c\":%.2f,", record.temperature_c);
+    else
+        std::printf("\"temperature_c\":null,");
+    std::printf("\"gain\":\"%s\",\"warm_start\":%s,\"widened\":%s,\"cold_fallback\":%s,\"tracking\":%s,"
+                "\"overwritten\":%s,",
+                gain_name(record.gain), (record.flags & frame::FLAG_WARM_START) ? "true" : "false",
+                (record.flags & frame::FLAG_WIDENED) ? "true" : "false",
+                (record.flags & frame::FLAG_COLD_FALLBACK) ? "true" : "false",
+                (record.flags & frame::FLAG_TRACKING) ? "true" : "false",
+                (record.flags & frame::FLAG_OVERWRITTEN) ? "true" : "false");
+    if (record.version >= 2)
+        std::printf("\"duration_ms\":%u,\"evaluations\":%u}\n", record.duration_ms, record.evaluations);
+    else
+        std::printf("\"duration_ms\":null,\"evaluations\":null}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    frame::Decoder decoder;
+    std::vector<frame::Record> records;
+    uint8_t buffer[4096];
+    bool json = false;
+    const char *path = nullptr;
+    std::FILE *input = stdin;
+    std::size_t count;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-j") == 0)
+            json = true;
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            std::fprintf(stderr, "usage: %s [-j] [file]\n", argv[0]);
+            return 1;
+        }
+        else
+            path = argv[i];
+    }
+    if (path != nullptr && std::strcmp(path, "-") != 0)
+    {
+        input = std::fopen(path, "rb");
+        if (input == nullptr)
+        {
+            std::perror(path);
+            return 1;
+        }
+    }
+
+    if (!json)
+        print_csv_header();
+    do
+    {
+        count = std::fread(buffer, 1, sizeof(buffer), input);
+        if (count > 0)
+            decoder.push(buffer, count, records);
+        else
+            decoder.flush(records);
+
+        for (const frame::Record &record : records)
+        {
+            if (json)
+                print_json(record);
+            else
+                print_csv(record);
+        }
+        records.clear();
+        std::fflush(stdout);
+    } while (count > 0);
+
+    const frame::Statistics &statistics = decoder.statistics();
+    std::fprintf(stderr, "%llu frames, %llu records, %llu CRC errors, %llu unsupported, %llu bytes skipped\n",
+                 (unsigned long long)statistics.frames, (unsigned long long)statistics.records,
+                 (unsigned long long)statistics.crc_errors, (unsigned long long)statistics.unsupported,
+                 (unsigned long long)statistics.skipped_bytes);
+    if (input != stdin)
+        std::fclose(input);
+    return 0;
+}
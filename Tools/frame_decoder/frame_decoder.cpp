@@ -0,0 +1,133 @@
+#include "frame_decoder.hpp"
+
+#include <algorithm>
+
+namespace frame
+{
+
+namespace
+{
+
+uint16_t get_u16(const uint8_t *in)
+{
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t get_u32(const uint8_t *in)
+{
+    return get_u16(in) | (static_cast<uint32_t>(get_u16(in + 2)) << 16);
+}
+
+} // namespace
+
+uint16_t crc16(const uint8_t *data, std::size_t length, uint16_t crc)
+{
+    for (std::size_t i = 0; i < length; i++)
+    {
+        crc ^= static_cast<uint16_t>(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * Later versions may append fields to a record (larger record size) and
+ * keep the known fields in front, those are decoded as the newest known
+ * version. Version 1 records end after the flags.
+ */
+bool Decoder::decode_frame(const uint8_t *frame, std::vector<Record> &records)
+{
+    uint8_t count = frame[2];
+    uint8_t record_size = frame[3];
+
+    uint8_t version = frame[1];
+
+    if (version < 1 || record_size < RECORD_SIZE_V1 || (version >= 2 && record_size < RECORD_SIZE_V2))
+        return false;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *in = frame + HEADER_SIZE + static_cast<std::size_t>(i) * record_size;
+        Record record;
+
+        record.sequence = get_u32(in);
+        record.timestamp_s = get_u32(in + 4);
+        record.permittivity_real = get_u16(in + 8) / 1000.0;
+        record.permittivity_imag = get_u16(in + 10) / 10000.0;
+        record.code_d1 = get_u16(in + 12);
+        record.code_d2 = get_u16(in + 14);
+        record.amplitude_lsb = get_u16(in + 16) / 100.0;
+        record.temperature_c = static_cast<int16_t>(get_u16(in + 18)) / 100.0;
+        record.gain = in[20];
+        record.flags = in[21];
+        record.version = std::min(version, VERSION);
+        record.duration_ms = record.version >= 2 ? get_u16(in + 22) : 0;
+        record.evaluations = record.version >= 2 ? get_u16(in + 24) : 0;
+        records.push_back(record);
+    }
+    statistics_.records += count;
+    return true;
+}
+
+std::size_t Decoder::push(const uint8_t *data, std::size_t length, std::vector<Record> &records)
+{
+    std::size_t before = records.size();
+    std::size_t position = 0;
+
+    pending_.insert(pending_.end(), data, data + length);
+
+    while (true)
+    {
+        auto magic = std::find(pending_.begin() + position, pending_.end(), MAGIC);
+        std::size_t frame_length;
+
+        statistics_.skipped_bytes += magic - (pending_.begin() + position);
+        position = magic - pending_.begin();
+        if (pending_.size() - position < HEADER_SIZE)
+            break;
+
+        if (pending_[position + 2] == 0 || pending_[position + 2] > MAX_RECORDS ||
+            pending_[position + 3] > MAX_RECORD_SIZE)
+        {
+            statistics_.skipped_bytes++;
+            position++; // not a header
+            continue;
+        }
+        frame_length = HEADER_SIZE + static_cast<std::size_t>(pending_[position + 2]) * pending_[position + 3] + CRC_SIZE;
+        if (pending_.size() - position < frame_length)
+            break; // wait for the rest
+
+        const uint8_t *frame = &pending_[position];
+        if (crc16(frame, frame_length - CRC_SIZE) != get_u16(frame + frame_length - CRC_SIZE))
+        {
+            statistics_.crc_errors++;
+            statistics_.skipped_bytes++;
+            position++; // the magic was a data byte or the frame is damaged
+            continue;
+        }
+        if (decode_frame(frame, records))
+            statistics_.frames++;
+        else
+            statistics_.unsupported++;
+        position += frame_length;
+    }
+
+    pending_.erase(pending_.begin(), pending_.begin() + position);
+    return records.size() - before;
+}
+
+std::size_t Decoder::flush(std::vector<Record> &records)
+{
+    std::size_t before = records.size();
+
+    while (!pending_.empty())
+    {
+        pending_.erase(pending_.begin()); // the magic that waits for its frame
+        statistics_.skipped_bytes++;
+        push(nullptr, 0, records);
+    }
+    return records.size() - before;
+}
+
+} // namespace frame
@@ -0,0 +1,100 @@
+#ifndef FRAME_DECODER_HPP_
+#define FRAME_DECODER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Decoder of the binary result frames the firmware sends over the NINA link
+ * (layout in PermittivityMeterV2/.../Core/Inc/mw_frame.h).
+ *
+ * Bytes are pushed as they come from the serial port. The decoder searches
+ * the magic byte, waits for the complete frame and checks the CRC. A frame
+ * with a wrong CRC is dropped and the search continues one byte after its
+ * magic, so a lost or corrupted byte costs at most one frame.
+ */
+
+namespace frame
+{
+
+constexpr uint8_t MAGIC = 0xA5;
+constexpr uint8_t VERSION = 2; // newest known, version 1 frames are decoded as well
+constexpr std::size_t HEADER_SIZE = 4;
+constexpr std::size_t RECORD_SIZE_V1 = 22;
+constexpr std::size_t RECORD_SIZE_V2 = 26;
+constexpr std::size_t CRC_SIZE = 2;
+// header plausibility, a data byte equal to MAGIC must not stall the decoder for long
+constexpr std::size_t MAX_RECORDS = 64;
+constexpr std::size_t MAX_RECORD_SIZE = 64;
+
+enum Flags : uint8_t
+{
+    FLAG_EPS_VALID = 0x01,
+    FLAG_TEMPERATURE_VALID = 0x02,
+    FLAG_WARM_START = 0x04,
+    FLAG_WIDENED = 0x08,
+    FLAG_COLD_FALLBACK = 0x10,
+    FLAG_TRACKING = 0x20,
+    FLAG_OVERWRITTEN = 0x40,
+};
+
+struct Record
+{
+    uint32_t sequence;
+    uint32_t timestamp_s;
+    double permittivity_real; // valid if FLAG_EPS_VALID
+    double permittivity_imag;
+    uint16_t code_d1;
+    uint16_t code_d2;
+    double amplitude_lsb;
+    double temperature_c; // valid if FLAG_TEMPERATURE_VALID
+    uint8_t gain;         // 0 = 1x, 1 = 10x, 2 = 100x
+    uint8_t flags;
+    uint8_t version;      // of the frame, the fields below need 2
+    uint16_t duration_ms; // search (tracking: period), saturated at 65535
+    uint16_t evaluations; // DAC settle + acquisition cycles (tracking: controller steps)
+};
+
+struct Statistics
+{
+    uint64_t frames = 0;
+    uint64_t records = 0;
+    uint64_t crc_errors = 0;
+    uint64_t unsupported = 0;    // valid CRC, version unknown or record too short
+    uint64_t skipped_bytes = 0; // not part of a valid frame
+};
+
+uint16_t crc16(const uint8_t *data, std::size_t length, uint16_t crc = 0xFFFF);
+
+class Decoder
+{
+public:
+    /**
+     * Appends received bytes and decodes every frame completed by them.
+     * @return number of records appended to records
+     */
+    std::size_t push(const uint8_t *data, std::size_t length, std::vector<Record> &records);
+
+    /**
+     * End of input: a magic byte in the data whose "frame" never completes
+     * does not hide the frames behind it.
+     * @return number of records appended to records
+     */
+    std::size_t flush(std::vector<Record> &records);
+
+    const Statistics &statistics() const
+    {
+        return statistics_;
+    }
+
+private:
+    bool decode_frame(const uint8_t *frame, std::vector<Record> &records);
+
+    std::vector<uint8_t> pending_;
+    Statistics statistics_;
+};
+
+} // namespace frame
+
+#endif /* FRAME_DECODER_HPP_ */